@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "attachment_relay.h"
+#include <curl/curl.h>
+#include <future>
+#include <thread>
+#include <vector>
+#include <rapidxml.hpp>
+#include "byte_ring.h"
+#include "request_governor.h"
+#include "util.h"
+
+struct AttachmentRelay::Attempt {
+    RequestGovernor::Outcome outcome;
+    bool not_sent = false; // the request never reached Odoo
+    bool request_failed = false; // in outcome, rather than the source or an answer
+};
+
+// Escapes text for a <string> value and drops what XML 1.0 does not allow
+// at all, even escaped: the C0 controls other than tab, LF and CR, and the
+// noncharacters U+FFFE and U+FFFF. A file name carrying one would otherwise
+// make Odoo reject the whole request as malformed.
+static std::string xmlEscape(const std::string &text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x20 && c != '\t' && c != '\n' && c != '\r') {
+            continue;
+        }
+        if (c == 0xEF && i + 2 < text.size() && static_cast<unsigned char>(text[i + 1]) == 0xBF
+            && (static_cast<unsigned char>(text[i + 2]) & 0xFE) == 0xBE) {
+            i += 2;
+            continue;
+        }
+        switch (c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '\r': out += "&#13;"; break; // a literal CR would be read back as LF
+        default: out += static_cast<char>(c);
+        }
+    }
+    return out;
+}
+static void addParam(std::string &out, const std::string &value) {
+    out += "<param><value><string>" + xmlEscape(value) + "</string></value></param>";
+}
+static void addMember(std::string &out, const char *name, const std::string &value) {
+    out += std::string("<member><name>") + name + "</name><value><string>" + xmlEscape(value) + "</string></value></member>";
+}
+static void addMember(std::string &out, const char *name, int value) {
+    out += std::string("<member><name>") + name + "</name><value><int>" + std::to_string(value) + "</int></value></member>";
+}
+
+// The request body: head, the base64 text from the ring or from content
+// already held, tail
+struct AttachmentRelay::RequestBody {
+    const std::string &head;
+    const std::string &tail;
+    ByteRing *ring;
+    std::string_view content;
+    size_t head_sent = 0;
+    size_t content_sent = 0;
+    size_t tail_sent = 0;
+    bool ring_drained = false;
+    bool source_failed = false;
+};
+size_t AttachmentRelay::readRequestBody(char *buffer, size_t size, size_t nitems, void *userdata) {
+    RequestBody *body = static_cast<RequestBody*>(userdata);
+    size_t room = size * nitems;
+    if (body->head_sent < body->head.size()) {
+        size_t n = std::min(room, body->head.size() - body->head_sent);
+        memcpy(buffer, body->head.data() + body->head_sent, n);
+        body->head_sent += n;
+        return n;
+    }
+    if (!body->ring) {
+        // straight from the pages of the view
+        if (body->content_sent < body->content.size()) {
+            size_t n = std::min(room, body->content.size() - body->content_sent);
+            memcpy(buffer, body->content.data() + body->content_sent, n);
+            body->content_sent += n;
+            return n;
+        }
+    } else if (!body->ring_drained) {
+        if (size_t n = body->ring->read(buffer, room)) {
+            return n;
+        }
+        if (!body->ring->complete()) {
+            body->source_failed = true;
+            return CURL_READFUNC_ABORT;
+        }
+        body->ring_drained = true;
+    }
+    size_t n = std::min(room, body->tail.size() - body->tail_sent);
+    memcpy(buffer, body->tail.data() + body->tail_sent, n);
+    body->tail_sent += n;
+    return n;
+}
+
+// Id from the methodResponse of a create, -1 with the reason logged
+static int createdId(const std::string &response) {
+    std::vector<char> buffer(response.begin(), response.end());
+    buffer.push_back(0);
+    rapidxml::xml_document<> xml;
+    try {
+        xml.parse<0>(buffer.data());
+    } catch (const rapidxml::parse_error &e) {
+        LOG(ERROR) << "Invalid XML-RPC response: " << e.what();
+        return -1;
+    }
+    rapidxml::xml_node<> *result = xml.first_node("methodResponse");
+    rapidxml::xml_node<> *node = result ? result->first_node("params") : nullptr;
+    node = node ? node->first_node("param") : nullptr;
+    node = node ? node->first_node("value") : nullptr;
+    node = node ? node->first_node() : nullptr;
+    if (node && (strcmp(node->name(), "int") == 0 || strcmp(node->name(), "i4") == 0)) {
+        return atoi(node->value());
+    }
+    std::string fault = "unexpected response";
+    if (rapidxml::xml_node<> *f = result ? result->first_node("fault") : nullptr) {
+        rapidxml::xml_node<> *s = f->first_node("value") ? f->first_node("value")->first_node("struct") : nullptr;
+        for (auto *member = s ? s->first_node("member") : nullptr; member; member = member->next_sibling("member")) {
+            rapidxml::xml_node<> *name = member->first_node("name");
+            rapidxml::xml_node<> *value = member->first_node("value");
+            if (name && value && strcmp(name->value(), "faultString") == 0) {
+                fault = value->first_node("string") ? value->first_node("string")->value() : value->value();
+            }
+        }
+    }
+    LOG(ERROR) << "XML-RPC error: " << fault;
+    return -1;
+}
+
+// The request is not built with xmlrpc-c like the rest of OdooAPI: its
+// values are whole strings in memory and it serializes the call into one
+// buffer, so the datas member could not be fed from the ring while the
+// source is still producing it.
+AttachmentRelay::Outcome AttachmentRelay::create(const FinvoiceAttachment &attachment, const std::string &resModel, int resId, int companyId, int &id) {
+    // execute_kw(db, uid, password, "ir.attachment", "create", [{..., "datas": <streamed>}], {})
+    std::string head = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+                       "<methodCall><methodName>execute_kw</methodName><params>";
+    addParam(head, db_);
+    head += "<param><value><int>" + std::to_string(uid_) + "</int></value></param>";
+    addParam(head, apikey_);
+    addParam(head, "ir.attachment");
+    addParam(head, "create");
+    head += "<param><value><array><data><value><struct>";
+    addMember(head, "name", attachment.AttachmentName);
+    addMember(head, "type", "binary");
+    addMember(head, "res_model", resModel);
+    addMember(head, "res_id", resId);
+    addMember(head, "mimetype", attachment.AttachmentMimeType);
+    addMember(head, "company_id", companyId);
+    head += "<member><name>datas</name><value><string>";
+    const std::string tail = "</string></value></member></struct></value></data></array></value></param>"
+                             "<param><value><struct></struct></value></param></params></methodCall>\r\n";
+
+    RequestGovernor &governor = RequestGovernor::instance();
+    const std::string endpoint = "odoo/object";
+    for (int n = 0; ; n++) {
+        Attempt attempt;
+        Outcome outcome = attachment.contentSource && attachment.AttachmentContent.empty()
+            ? relay(attachment, head, tail, id, attempt)
+            : send(attachment.AttachmentContent, attachment.AttachmentName, head, tail, id, attempt);
+        if (outcome != Failed || !attempt.request_failed) {
+            return outcome;
+        }
+        // A create is repeated only when Odoo cannot have seen it, the
+        // source is read again from the start then
+        if (!governor.shouldRetry(attempt.outcome, attempt.not_sent, n)) {
+            governor.countFailure(endpoint);
+            return Failed;
+        }
+        LOG(INFO) << endpoint << ": transient failure relaying " << attachment.AttachmentName << ", retrying";
+        governor.countRetry(endpoint);
+        governor.backoff(endpoint, attempt.outcome, n);
+    }
+}
+
+AttachmentRelay::Outcome AttachmentRelay::relay(const FinvoiceAttachment &attachment, const std::string &head, const std::string &tail, int &id, Attempt &attempt) {
+    ByteRing ring(ringSize);
+    std::promise<int64_t> announced;
+    std::future<int64_t> announcement = announced.get_future();
+    bool source_ok = false;
+
+    // the source: raw bytes in, base64 into the ring, or into held when it
+    // does not tell its size up front
+    AttachmentContent held;
+    std::thread source([&] {
+        bool sized = false;
+        int64_t expected = -1;
+        uint64_t received = 0;
+        std::string chunk;
+        Base64Encoder encoder(chunk);
+        auto size = [&](int64_t total) {
+            if (!sized && received == 0) {
+                sized = true;
+                expected = total;
+                announced.set_value(total);
+            }
+        };
+        auto data = [&](const char *bytes, size_t length) {
+            received += length;
+            chunk.clear();
+            encoder.update(bytes, length);
+            if (!sized) {
+                held.append(chunk);
+                return true;
+            }
+            return ring.write(chunk.data(), chunk.size());
+        };
+        source_ok = attachment.contentSource(size, data);
+        chunk.clear();
+        encoder.finish();
+        if (!sized) {
+            held.append(chunk);
+            // -1 when all of it is in held
+            announced.set_value(source_ok ? -1 : -2);
+            return;
+        }
+        bool complete = source_ok && received == static_cast<uint64_t>(expected) && ring.write(chunk.data(), chunk.size());
+        ring.closeWrite(complete);
+    });
+
+    const int64_t size = announcement.get();
+    if (size < 0) {
+        source.join();
+        if (size == -1) {
+            return send(held, attachment.AttachmentName, head, tail, id, attempt);
+        }
+        LOG(ERROR) << "Failed to get the content of attachment " << attachment.AttachmentName;
+        return Failed;
+    }
+
+    RequestBody body = { head, tail, &ring, {} };
+    Outcome outcome = post(body, head.size() + (size + 2) / 3 * 4 + tail.size(), id, attempt);
+    // stops the source if the request ended before taking all of it
+    ring.closeRead();
+    source.join();
+
+    if (body.source_failed) {
+        LOG(ERROR) << "Failed to get the content of attachment " << attachment.AttachmentName;
+        return Failed;
+    }
+    return outcome;
+}
+
+AttachmentRelay::Outcome AttachmentRelay::send(const AttachmentContent &held, const std::string &name, const std::string &head, const std::string &tail, int &id, Attempt &attempt) {
+    AttachmentContent::View content = held.view();
+    if (!content.ok()) {
+        LOG(ERROR) << "Attachment " << name << " could not be read";
+        return Failed;
+    }
+    RequestBody body = { head, tail, nullptr, content.text() };
+    return post(body, head.size() + content.size() + tail.size(), id, attempt);
+}
+
+AttachmentRelay::Outcome AttachmentRelay::post(RequestBody &body, size_t length, int &id, Attempt &attempt) {
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        LOG(ERROR) << "Failed to initialize CURL";
+        return Failed;
+    }
+    const std::string url = url_ + "/xmlrpc/2/object";
+    std::string response;
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, readRequestBody);
+    curl_easy_setopt(curl, CURLOPT_READDATA, &body);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(length));
+    struct curl_slist *headers = nullptr;
+    headers = curl_slist_append(headers, "Content-Type: text/xml");
+    // no 100-continue round trip, the body is on its way anyway
+    headers = curl_slist_append(headers, "Expect:");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char *ptr, size_t size, size_t nmemb, void *userdata) -> size_t {
+        static_cast<std::string*>(userdata)->append(ptr, size * nmemb);
+        return size * nmemb;
+    });
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 15L);
+    // the upload runs at the pace of the source, give up on stalled transfers only
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+
+    long http_code = 0;
+    CURLcode res;
+    {
+        GovernedRequest request("odoo/object");
+        res = curl_easy_perform(curl);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        attempt.outcome.http_status = http_code;
+        attempt.outcome.transport_error = res != CURLE_OK;
+        curl_off_t retry_after = -1;
+        if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) {
+            attempt.outcome.retry_after = static_cast<long>(retry_after);
+        }
+        request.done(attempt.outcome);
+    }
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+
+    if (body.source_failed) {
+        // the source's to report, nothing Odoo saw
+        return Failed;
+    }
+    if (res == CURLE_OK && http_code == 200) {
+        // a fault is a valid answer from the server, never retried
+        id = createdId(response);
+        return id > 0 ? Created : Failed;
+    }
+    attempt.request_failed = true;
+    attempt.not_sent = res == CURLE_COULDNT_CONNECT || res == CURLE_COULDNT_RESOLVE_HOST;
+    if (res != CURLE_OK) {
+        LOG(ERROR) << "CURL error: " << curl_easy_strerror(res);
+    } else {
+        LOG(ERROR) << "Odoo answered HTTP " << http_code << " to the attachment upload";
+    }
+    return Failed;
+}
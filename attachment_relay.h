@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <string>
+#include "finvoice_invoice.h"
+
+// Creates an Odoo ir.attachment from content streamed from its origin
+// (FinvoiceAttachment::contentSource) without holding the whole of it:
+// the source runs on a thread of its own, its bytes are base64 encoded into
+// a ByteRing of ringSize bytes, and the XML-RPC create request is written
+// by hand around the ring, read by curl as the request body. The body size
+// is known up front from the size of the source, so the request goes out
+// with a Content-Length. Content already in AttachmentContent is read by
+// curl from its view the same way, spilled content straight from the map.
+class AttachmentRelay {
+public:
+    enum Outcome {
+        Created,
+        Failed,
+    };
+    static constexpr size_t ringSize = 256 * 1024;
+
+    // Endpoint and credentials of execute_kw, as in OdooAPI
+    AttachmentRelay(const std::string &url, const std::string &db, int uid, const std::string &apikey)
+        : url_(url), db_(db), uid_(uid), apikey_(apikey) {}
+
+    // Creates the attachment of resModel record resId, id receives the new
+    // record. A source that does not tell its size is read whole into an
+    // AttachmentContent first, which spills to disk past the store limits,
+    // and sent from there.
+    Outcome create(const FinvoiceAttachment &attachment, const std::string &resModel, int resId, int companyId, int &id);
+private:
+    struct Attempt;
+    struct RequestBody;
+    Outcome relay(const FinvoiceAttachment &attachment, const std::string &head, const std::string &tail, int &id, Attempt &attempt);
+    // content already held, read from its view
+    Outcome send(const AttachmentContent &held, const std::string &name, const std::string &head, const std::string &tail, int &id, Attempt &attempt);
+    Outcome post(RequestBody &body, size_t length, int &id, Attempt &attempt);
+    static size_t readRequestBody(char *buffer, size_t size, size_t nitems, void *userdata);
+
+    std::string url_, db_;
+    int uid_;
+    std::string apikey_;
+};
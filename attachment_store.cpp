@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "attachment_store.h"
+#include "logger.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// small appends (the parser hands content over a text chunk at a time)
+// are collected into writes of this size
+constexpr size_t writeBuffer = 64 * 1024;
+
+AttachmentStoreLimits storeLimits;
+std::atomic<size_t> resident{0};
+std::atomic<size_t> residentPeak{0};
+std::atomic<size_t> spilledTotal{0};
+std::atomic<size_t> spillCount{0};
+
+void notePeak(size_t now) {
+    size_t peak = residentPeak.load(std::memory_order_relaxed);
+    while (now > peak && !residentPeak.compare_exchange_weak(peak, now)) {
+    }
+}
+void charge(size_t len) {
+    notePeak(resident.fetch_add(len) + len);
+}
+// false when len more bytes in memory would go over the cap
+bool reserve(size_t len) {
+    size_t now = resident.fetch_add(len) + len;
+    if (now > storeLimits.residentCap) {
+        resident.fetch_sub(len);
+        return false;
+    }
+    notePeak(now);
+    return true;
+}
+void release(size_t len) {
+    resident.fetch_sub(len);
+}
+
+bool writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+} // namespace
+
+void AttachmentStore::configure(const AttachmentStoreLimits &limits) {
+    storeLimits = limits;
+}
+const AttachmentStoreLimits &AttachmentStore::limits() {
+    return storeLimits;
+}
+size_t AttachmentStore::residentBytes() {
+    return resident.load();
+}
+size_t AttachmentStore::spilledBytes() {
+    return spilledTotal.load();
+}
+std::string AttachmentStore::statistics() {
+    std::ostringstream out;
+    out << "attachments spilled to disk: " << spillCount.load()
+        << ", most attachment bytes in memory: " << residentPeak.load();
+    return out.str();
+}
+
+// Resident content is text, spilled content the bytes written to fd and
+// the ones still pending for it. Only the owner of an unshared blob
+// changes it; views of a shared one may flush it at the same time, under
+// the mutex.
+struct AttachmentContent::Blob {
+    std::string text;
+    size_t size = 0;
+    size_t charged = 0; // bytes of text counted as resident
+    int fd = -1;
+    bool spillFailed = false; // stays in memory, a failing disk fails again
+    std::string pending;
+    std::mutex mutex;
+
+    ~Blob() {
+        release(charged);
+        if (fd >= 0) {
+            spilledTotal.fetch_sub(size);
+            ::close(fd);
+        }
+    }
+
+    void append(std::string_view data) {
+        if (fd < 0) {
+            if (size + data.size() < storeLimits.spillThreshold && reserve(data.size())) {
+                text.append(data);
+                charged += data.size();
+                size += data.size();
+                return;
+            }
+            if (spillFailed || !spill()) {
+                // no file for it, kept in memory over the limits
+                text.append(data);
+                charge(data.size());
+                charged += data.size();
+                size += data.size();
+                return;
+            }
+        }
+        if (pending.size() + data.size() > writeBuffer && !flush()) {
+            unspill();
+            append(data);
+            return;
+        }
+        if (data.size() >= writeBuffer) {
+            if (!writeAll(fd, data.data(), data.size())) {
+                LOG(ERROR) << "Failed to write attachment spill file: " << strerror(errno);
+                unspill();
+                append(data);
+                return;
+            }
+        } else {
+            pending.append(data);
+        }
+        size += data.size();
+        spilledTotal.fetch_add(data.size());
+    }
+    // Moves the resident text into a new spill file
+    bool spill() {
+        std::string path = storeLimits.directory + "/maventa2odoo-attachment-XXXXXX";
+        std::vector<char> name(path.begin(), path.end());
+        name.push_back('\0');
+        fd = mkstemp(name.data());
+        if (fd < 0) {
+            LOG(ERROR) << "Failed to create attachment spill file in " << storeLimits.directory << ": " << strerror(errno);
+            spillFailed = true;
+            return false;
+        }
+        // the file goes away with the descriptor
+        unlink(name.data());
+        if (!writeAll(fd, text.data(), text.size())) {
+            LOG(ERROR) << "Failed to write attachment spill file: " << strerror(errno);
+            ::close(fd);
+            fd = -1;
+            spillFailed = true;
+            return false;
+        }
+        spilledTotal.fetch_add(size);
+        spillCount++;
+        std::string().swap(text);
+        release(charged);
+        charged = 0;
+        return true;
+    }
+    bool flush() {
+        if (!pending.empty()) {
+            if (!writeAll(fd, pending.data(), pending.size())) {
+                LOG(ERROR) << "Failed to write attachment spill file: " << strerror(errno);
+                return false;
+            }
+            pending.clear();
+        }
+        return true;
+    }
+    // Back to memory after the file failed, e.g. when the disk is full
+    void unspill() {
+        size_t written = size - pending.size();
+        text.resize(written);
+        size_t done = 0;
+        while (done < written) {
+            ssize_t n = pread(fd, text.data() + done, written - done, done);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                LOG(ERROR) << "Failed to read attachment spill file back: " << strerror(errno);
+                break;
+            }
+            done += n;
+        }
+        text.append(pending);
+        std::string().swap(pending);
+        spilledTotal.fetch_sub(size);
+        ::close(fd);
+        fd = -1;
+        spillFailed = true;
+        charge(text.size());
+        charged = text.size();
+    }
+};
+
+AttachmentContent::View::~View() {
+    if (mapping_) {
+        munmap(mapping_, mappingSize_);
+    }
+}
+AttachmentContent::View::View(View &&other) noexcept
+    : data_(other.data_), size_(other.size_), mapping_(other.mapping_), mappingSize_(other.mappingSize_),
+      ok_(other.ok_), blob_(std::move(other.blob_)) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.mapping_ = nullptr;
+}
+AttachmentContent::View &AttachmentContent::View::operator=(View &&other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(mapping_, other.mapping_);
+    std::swap(mappingSize_, other.mappingSize_);
+    std::swap(ok_, other.ok_);
+    std::swap(blob_, other.blob_);
+    return *this;
+}
+
+AttachmentContent &AttachmentContent::operator=(std::string text) {
+    blob_.reset();
+    if (text.size() < storeLimits.spillThreshold && reserve(text.size())) {
+        // taken over without a copy
+        blob_ = std::make_shared<Blob>();
+        blob_->size = text.size();
+        blob_->charged = text.size();
+        blob_->text = std::move(text);
+    } else {
+        append(text);
+    }
+    return *this;
+}
+void AttachmentContent::assign(std::string_view text) {
+    blob_.reset();
+    append(text);
+}
+void AttachmentContent::append(std::string_view text) {
+    own().append(text);
+}
+size_t AttachmentContent::size() const {
+    return blob_ ? blob_->size : 0;
+}
+bool AttachmentContent::spilled() const {
+    return blob_ && blob_->fd >= 0;
+}
+AttachmentContent::View AttachmentContent::view() const {
+    View view;
+    if (!blob_ || blob_->size == 0) {
+        return view;
+    }
+    view.blob_ = blob_;
+    if (blob_->fd < 0) {
+        view.data_ = blob_->text.data();
+        view.size_ = blob_->size;
+        return view;
+    }
+    {
+        std::lock_guard<std::mutex> lock(blob_->mutex);
+        if (!blob_->flush()) {
+            view.ok_ = false;
+            return view;
+        }
+    }
+    void *mapping = mmap(nullptr, blob_->size, PROT_READ, MAP_PRIVATE, blob_->fd, 0);
+    if (mapping == MAP_FAILED) {
+        LOG(ERROR) << "Failed to map attachment spill file: " << strerror(errno);
+        view.ok_ = false;
+        return view;
+    }
+    // read front to back by every consumer
+    madvise(mapping, blob_->size, MADV_SEQUENTIAL);
+    view.data_ = static_cast<const char *>(mapping);
+    view.size_ = blob_->size;
+    view.mapping_ = mapping;
+    view.mappingSize_ = blob_->size;
+    return view;
+}
+AttachmentContent::Blob &AttachmentContent::own() {
+    if (!blob_) {
+        blob_ = std::make_shared<Blob>();
+    } else if (blob_.use_count() > 1) {
+        // shared with a copy or a view, changed apart from them
+        AttachmentContent copy;
+        copy.own().append(view().text());
+        blob_ = std::move(copy.blob_);
+    }
+    return *blob_;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Where the content of attachments is kept. Small content lives in memory,
+// content from spillThreshold bytes on, or any that would take the memory
+// held by all attachments over residentCap, is written to an unlinked
+// temporary file and read back through a read-only mapping. File pages are
+// page cache the kernel can drop and reread, so the memory of the process
+// stays bounded however many large invoices are in flight.
+struct AttachmentStoreLimits {
+    size_t spillThreshold = 1 << 20; // bytes of one attachment kept in memory
+    size_t residentCap = 64 << 20;   // bytes of all attachments kept in memory
+    std::string directory = "/tmp";  // of the spill files
+};
+
+class AttachmentStore {
+public:
+    // set up before any attachment is stored
+    static void configure(const AttachmentStoreLimits &limits);
+    static const AttachmentStoreLimits &limits();
+    static size_t residentBytes();
+    static size_t spilledBytes();
+    // One line for the run statistics
+    static std::string statistics();
+};
+
+// The base64 content of an attachment, kept by AttachmentStore. Copies share
+// the content, a copy that is changed gets its own. The content is read
+// through a View, which holds on to it and maps spilled content for as
+// long as it lives.
+class AttachmentContent {
+    struct Blob;
+public:
+    class View {
+    public:
+        View() = default;
+        ~View();
+        View(View &&other) noexcept;
+        View &operator=(View &&other) noexcept;
+        View(const View &) = delete;
+        View &operator=(const View &) = delete;
+
+        const char *data() const { return data_; }
+        size_t size() const { return size_; }
+        std::string_view text() const { return {data_, size_}; }
+        // false when spilled content could not be read back, the view is
+        // then empty though the content is not
+        bool ok() const { return ok_; }
+    private:
+        friend class AttachmentContent;
+        const char *data_ = nullptr;
+        size_t size_ = 0;
+        void *mapping_ = nullptr; // of spilled content, unmapped by the destructor
+        size_t mappingSize_ = 0;
+        bool ok_ = true;
+        std::shared_ptr<Blob> blob_;
+    };
+
+    AttachmentContent() = default;
+    AttachmentContent &operator=(std::string text);
+    void assign(std::string_view text);
+    void append(std::string_view text);
+    void clear() { blob_.reset(); }
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    // Whether the content went to a file
+    bool spilled() const;
+    View view() const;
+private:
+    // the blob appended to, a copy of a shared one
+    Blob &own();
+    std::shared_ptr<Blob> blob_;
+};
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "base64.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+namespace base64 {
+namespace {
+
+constexpr char alphabet[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 6-bit value of each character, 0xff outside the alphabet
+constexpr std::array<uint8_t, 256> makeValues() {
+    std::array<uint8_t, 256> values{};
+    values.fill(0xff);
+    for (int i = 0; i < 64; i++) {
+        values[static_cast<uint8_t>(alphabet[i])] = static_cast<uint8_t>(i);
+    }
+    return values;
+}
+constexpr std::array<uint8_t, 256> values = makeValues();
+
+void encodeScalar(const unsigned char *in, size_t groups, char *out) {
+    for (size_t g = 0; g < groups; ++g, in += 3, out += 4) {
+        out[0] = alphabet[in[0] >> 2];
+        out[1] = alphabet[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+        out[2] = alphabet[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+        out[3] = alphabet[in[2] & 0x3f];
+    }
+}
+
+size_t decodeScalar(const char *in, size_t len, char *out) {
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4, out += 3) {
+        uint32_t a = values[static_cast<uint8_t>(in[i])];
+        uint32_t b = values[static_cast<uint8_t>(in[i + 1])];
+        uint32_t c = values[static_cast<uint8_t>(in[i + 2])];
+        uint32_t d = values[static_cast<uint8_t>(in[i + 3])];
+        if ((a | b | c | d) > 63) {
+            break;
+        }
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = static_cast<char>(v >> 16);
+        out[1] = static_cast<char>(v >> 8);
+        out[2] = static_cast<char>(v);
+    }
+    return i;
+}
+
+#ifdef BASE64_X86
+// The vector kernels follow W. Mula and D. Lemire, "Faster Base64 Encoding
+// and Decoding Using AVX2 Instructions": bytes are spread to 6-bit fields
+// with multiplies and mapped to characters with a pshufb offset table, and
+// back with pshufb range classification and multiply-add packing.
+
+__attribute__((target("sse4.1")))
+__m128i encodeBlock(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    __m128i hi = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    __m128i lo = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(hi, lo);
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+__attribute__((target("sse4.1")))
+void encodeSse41(const unsigned char *in, size_t groups, char *out) {
+    // 4 groups per step, the load reads 4 bytes past them
+    for (; groups >= 6; groups -= 4, in += 12, out += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encodeBlock(block));
+    }
+    encodeScalar(in, groups, out);
+}
+
+// Values of 16 characters, false when one is outside the alphabet
+__attribute__((target("sse4.1")))
+bool decodeValues(__m128i in, __m128i &values) {
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+    __m128i loNibbles = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+    if (!_mm_testz_si128(_mm_shuffle_epi8(lutLo, loNibbles), _mm_shuffle_epi8(lutHi, hiNibbles))) {
+        return false;
+    }
+    __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+    values = _mm_add_epi8(in, _mm_shuffle_epi8(lutRoll, _mm_add_epi8(slash, hiNibbles)));
+    return true;
+}
+
+__attribute__((target("sse4.1")))
+__m128i packValues(__m128i values) {
+    __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i triples = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(triples, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("sse4.1")))
+size_t decodeSse41(const char *in, size_t len, char *out) {
+    size_t i = 0;
+    for (; len - i >= 16; i += 16, out += 12) {
+        __m128i values;
+        if (!decodeValues(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), values)) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), packValues(values));
+    }
+    return i + decodeScalar(in + i, len - i, out);
+}
+
+__attribute__((target("avx2")))
+void encodeAvx2(const unsigned char *in, size_t groups, char *out) {
+    const __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    // 8 groups per step, 12 bytes in each lane, the loads read 4 bytes past them
+    for (; groups >= 10; groups -= 8, in += 24, out += 32) {
+        __m256i block = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12)), 1);
+        block = _mm256_shuffle_epi8(block, spread);
+        __m256i hi = _mm256_mulhi_epu16(_mm256_and_si256(block, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        __m256i lo = _mm256_mullo_epi16(_mm256_and_si256(block, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(hi, lo);
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices));
+    }
+    // the rest runs in legacy SSE encoding, which stalls on dirty upper halves
+    _mm256_zeroupper();
+    encodeSse41(in, groups, out);
+}
+
+__attribute__((target("avx2")))
+size_t decodeAvx2(const char *in, size_t len, char *out) {
+    const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; len - i >= 32; i += 32, out += 24) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(block, 4), _mm256_set1_epi8(0x0f));
+        __m256i loNibbles = _mm256_and_si256(block, _mm256_set1_epi8(0x0f));
+        if (!_mm256_testz_si256(_mm256_shuffle_epi8(lutLo, loNibbles), _mm256_shuffle_epi8(lutHi, hiNibbles))) {
+            break;
+        }
+        __m256i slash = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('/'));
+        __m256i values = _mm256_add_epi8(block, _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(slash, hiNibbles)));
+        __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        __m256i triples = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        triples = _mm256_shuffle_epi8(triples, pack);
+        // the 12 bytes of each lane next to each other
+        triples = _mm256_permutevar8x32_epi32(triples, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), triples);
+    }
+    _mm256_zeroupper();
+    return i + decodeSse41(in + i, len - i, out);
+}
+
+bool supported(Kernel kernel) {
+    __builtin_cpu_init();
+    switch (kernel) {
+        case Kernel::Avx2: return __builtin_cpu_supports("avx2");
+        case Kernel::Sse41: return __builtin_cpu_supports("sse4.1");
+        default: return true;
+    }
+}
+#else
+bool supported(Kernel kernel) {
+    return kernel == Kernel::Scalar;
+}
+#endif
+
+std::atomic<Kernel> &current() {
+    static std::atomic<Kernel> kernel{
+        supported(Kernel::Avx2) ? Kernel::Avx2 : supported(Kernel::Sse41) ? Kernel::Sse41 : Kernel::Scalar};
+    return kernel;
+}
+
+} // namespace
+
+void encodeGroups(const unsigned char *in, size_t groups, char *out) {
+    switch (current().load(std::memory_order_relaxed)) {
+#ifdef BASE64_X86
+        case Kernel::Avx2: encodeAvx2(in, groups, out); break;
+        case Kernel::Sse41: encodeSse41(in, groups, out); break;
+#endif
+        default: encodeScalar(in, groups, out); break;
+    }
+}
+
+size_t decodeGroups(const char *in, size_t len, char *out) {
+    switch (current().load(std::memory_order_relaxed)) {
+#ifdef BASE64_X86
+        case Kernel::Avx2: return decodeAvx2(in, len, out);
+        case Kernel::Sse41: return decodeSse41(in, len, out);
+#endif
+        default: return decodeScalar(in, len, out);
+    }
+}
+
+Kernel activeKernel() {
+    return current().load(std::memory_order_relaxed);
+}
+
+const char *kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Avx2: return "avx2";
+        case Kernel::Sse41: return "sse4.1";
+        default: return "scalar";
+    }
+}
+
+bool useKernel(Kernel kernel) {
+    if (!supported(kernel)) {
+        return false;
+    }
+    current().store(kernel, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace base64
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <cstddef>
+
+// Block kernels behind base64_encode/base64_decode and the incremental
+// Base64Encoder/Base64Decoder of util.h. The widest implementation the CPU
+// supports is picked on first use (CPUID), the scalar one everywhere else.
+namespace base64 {
+
+enum class Kernel {
+    Scalar,
+    Sse41,
+    Avx2,
+};
+
+// Encodes groups 3-byte groups of in, writes exactly 4 * groups characters
+void encodeGroups(const unsigned char *in, size_t groups, char *out);
+
+// Decodes the longest prefix of in made of whole 4-character groups of the
+// alphabet, stopping before the first group holding anything else
+// (whitespace, padding, illegal characters), which the caller handles.
+// Returns the characters consumed, 3 bytes per group are written to out,
+// which must have decodeSlack bytes of room past them.
+size_t decodeGroups(const char *in, size_t len, char *out);
+constexpr size_t decodeSlack = 32;
+
+Kernel activeKernel();
+const char *kernelName(Kernel kernel);
+// Selects a kernel, e.g. to compare them. False when the CPU lacks it.
+bool useKernel(Kernel kernel);
+
+} // namespace base64
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "finvoice_writer.h"
+#include "util.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+INITIALIZE_EASYLOGGINGPP
+
+// Allocations and time to parse a received finvoice of 1000 rows, and to
+// build and render one, with FinvoiceInvoice and ArenaFinvoiceInvoice.
+
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void *operator new(size_t size, std::align_val_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(align);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+const int rows = 1000;
+
+template <typename Invoice>
+static void fill(Invoice &inv, const std::string &text) {
+    auto set = [&](auto &field, const std::string &value) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(field)>, std::string>) {
+            field = value;
+        } else {
+            field = inv.store(value);
+        }
+    };
+    set(inv.messageId, "123456789");
+    set(inv.InvoiceNumber, "INV/2025/00042");
+    set(inv.InvoiceDueDate, "20251031");
+    set(inv.InvoiceTotalVatExcludedAmount, "1000,00");
+    set(inv.InvoiceTotalVatAmount, "255,00");
+    set(inv.InvoiceTotalVatIncludedAmount, "1255,00");
+    set(inv.seller.SellerOrganisationName, "Myyjä & Poika Oy");
+    set(inv.seller.SellerOrganisationTaxCode, "FI12345678");
+    set(inv.seller.SellerStreetName, "Testikatu 1");
+    set(inv.seller.SellerTownName, "Helsinki");
+    set(inv.seller.SellerAccountID, "FI21 1234 5600 0007 85");
+    set(inv.seller.SellerOVT, "003712345678");
+    set(inv.buyer.BuyerOrganisationName, "Ostaja Oy");
+    set(inv.buyer.BuyerOVT, "003787654321");
+    set(inv.EpiRemittanceInfoIdentifier, "12345672");
+    inv.rows.reserve(rows);
+    for (int i = 0; i < rows; i++) {
+        typename Invoice::Row row;
+        set(row.ArticleIdentifier, std::to_string(1000 + i));
+        set(row.ArticleName, text);
+        set(row.DeliveredQuantity, "3");
+        set(row.InvoicedQuantity, "3");
+        set(row.UnitPriceAmount, "12,50");
+        set(row.RowVatRatePercent, "25,5");
+        set(row.RowVatAmount, "9,56");
+        set(row.RowVatExcludedAmount, "37,50");
+        inv.rows.push_back(row);
+    }
+}
+
+template <typename Run>
+static void measure(const char *name, int iterations, Run &&run) {
+    size_t before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        run();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-32s %10.1f us/invoice %10zu allocations/invoice\n", name,
+           seconds * 1e6 / iterations, (allocations.load() - before) / iterations);
+}
+
+int main() {
+    const int iterations = 200;
+    // long enough to leave the small string buffer
+    const std::string text = "Tuote – lisävaruste, pitkä kuvaus <L>";
+    std::string xml;
+    {
+        FinvoiceInvoice inv;
+        fill(inv, text);
+        FinvoiceWriter(xml).finvoiceMessage(inv);
+    }
+    measure("parse FinvoiceInvoice", iterations, [&] {
+        FinvoiceInvoice inv;
+        inv.parseFromXml(std::string(xml));
+    });
+    measure("parse ArenaFinvoiceInvoice", iterations, [&] {
+        ArenaFinvoiceInvoice inv(xml.size());
+        inv.parseFromXml(std::string(xml));
+    });
+    measure("build+render FinvoiceInvoice", iterations, [&] {
+        FinvoiceInvoice inv;
+        fill(inv, text);
+        std::string out;
+        FinvoiceWriter(out).finvoiceMessage(inv);
+    });
+    measure("build+render ArenaFinvoiceInvoice", iterations, [&] {
+        ArenaFinvoiceInvoice inv(xml.size());
+        fill(inv, text);
+        std::string out;
+        FinvoiceWriter(out).finvoiceMessage(inv);
+    });
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "finvoice_writer.h"
+#include "util.h"
+#include <chrono>
+#include <cstdio>
+
+INITIALIZE_EASYLOGGINGPP
+
+// Time to render the outbound finvoice message and envelope for invoices
+// of 1, 100 and 10000 rows.
+static FinvoiceInvoice makeInvoice(int rows) {
+    FinvoiceInvoice inv;
+    inv.messageId = "123456789";
+    inv.InvoiceNumber = "INV/2025/00042";
+    inv.InvoiceDueDate = "20251031";
+    inv.InvoiceTotalVatExcludedAmount = "1000,00";
+    inv.InvoiceTotalVatAmount = "255,00";
+    inv.InvoiceTotalVatIncludedAmount = "1255,00";
+    inv.PaymentOverDueFineFreeText = "Viivästyskorko 16%";
+    inv.PaymentOverDueFinePercent = "16,00";
+    inv.seller.SellerOrganisationName = "Myyjä & Poika Oy";
+    inv.seller.SellerOrganisationTaxCode = "FI12345678";
+    inv.seller.SellerStreetName = "Testikatu 1";
+    inv.seller.SellerTownName = "Helsinki";
+    inv.seller.SellerPostCodeIdentifier = "00100";
+    inv.seller.SellerAccountID = "FI21 1234 5600 0007 85";
+    inv.seller.SellerBic = "MOCKFIHH";
+    inv.seller.SellerOVT = "003712345678";
+    inv.seller.SellerIntermediator = "003721291126";
+    inv.buyer.BuyerOrganisationName = "Ostaja Oy";
+    inv.buyer.BuyerOrganisationTaxCode = "FI87654321";
+    inv.buyer.BuyerOVT = "003787654321";
+    inv.buyer.BuyerIntermediator = "003721291126";
+    inv.EpiRemittanceInfoIdentifier = "12345672";
+    for (int i = 0; i < rows; i++) {
+        InvoiceRow row;
+        row.ArticleIdentifier = std::to_string(1000 + i);
+        row.ArticleName = "Tuote " + std::to_string(i) + " – lisävaruste <L>";
+        row.DeliveredQuantity = row.InvoicedQuantity = "3";
+        row.UnitPriceAmount = "12,50";
+        row.RowVatRatePercent = "25,5";
+        row.RowVatAmount = "9,56";
+        row.RowVatExcludedAmount = "37,50";
+        inv.rows.push_back(row);
+    }
+    return inv;
+}
+
+int main() {
+    for (int rows : {1, 100, 10000}) {
+        FinvoiceInvoice inv = makeInvoice(rows);
+        int iterations = rows >= 10000 ? 20 : rows >= 100 ? 2000 : 20000;
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            std::string xml, soap;
+            FinvoiceWriter(xml).finvoiceMessage(inv);
+            FinvoiceWriter(soap).envelope(inv);
+            bytes += xml.size() + soap.size();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%6d rows: %10.1f us/invoice %8.1f MB/s (%zu bytes)\n", rows,
+               seconds * 1e6 / iterations, bytes / seconds / 1e6, bytes / iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Fixed size byte ring between a producing and a consuming thread, the
+// byte stream counterpart of BoundedQueue. write() blocks while the ring is
+// full and read() while it is empty, so the faster side waits for the
+// slower one and the ring is the only buffer between them.
+// The writer ends the stream with closeWrite(), telling whether it is
+// complete; the reader gives up on it with closeRead(), which fails the
+// writes from then on.
+class ByteRing {
+public:
+    explicit ByteRing(size_t capacity) : buffer_(capacity ? capacity : 1) {}
+
+    // False when the reader closed the ring, the rest of data is dropped
+    bool write(const char* data, size_t size) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (size > 0) {
+            not_full_.wait(lock, [this] { return used_ < buffer_.size() || read_closed_; });
+            if (read_closed_) {
+                return false;
+            }
+            size_t tail = (head_ + used_) % buffer_.size();
+            size_t n = std::min({ size, buffer_.size() - used_, buffer_.size() - tail });
+            memcpy(buffer_.data() + tail, data, n);
+            used_ += n;
+            data += n;
+            size -= n;
+            not_empty_.notify_one();
+        }
+        return true;
+    }
+    // Up to size bytes, 0 only once the writer closed and the ring is drained
+    size_t read(char* out, size_t size) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return used_ > 0 || write_closed_; });
+        size_t n = std::min({ size, used_, buffer_.size() - head_ });
+        memcpy(out, buffer_.data() + head_, n);
+        head_ = (head_ + n) % buffer_.size();
+        used_ -= n;
+        not_full_.notify_one();
+        return n;
+    }
+    void closeWrite(bool complete) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_closed_ = true;
+        complete_ = complete;
+        not_empty_.notify_all();
+    }
+    void closeRead() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        read_closed_ = true;
+        not_full_.notify_all();
+    }
+    // Whether the writer delivered the whole stream, valid after read() returned 0
+    bool complete() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return complete_;
+    }
+private:
+    std::vector<char> buffer_;
+    size_t head_ = 0;
+    size_t used_ = 0;
+    bool write_closed_ = false;
+    bool read_closed_ = false;
+    bool complete_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
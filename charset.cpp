@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "charset.h"
+#include <array>
+#include <vector>
+#include <cstring>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct Utf8Seq {
+    uint8_t len;
+    char bytes[3];
+};
+using Utf8Table = std::array<Utf8Seq, 256>;
+
+constexpr Utf8Seq encode(uint32_t cp) {
+    if (cp < 0x80) {
+        return { 1, { static_cast<char>(cp), 0, 0 } };
+    }
+    if (cp < 0x800) {
+        return { 2, { static_cast<char>(0xC0 | (cp >> 6)), static_cast<char>(0x80 | (cp & 0x3F)), 0 } };
+    }
+    return { 3, { static_cast<char>(0xE0 | (cp >> 12)), static_cast<char>(0x80 | ((cp >> 6) & 0x3F)), static_cast<char>(0x80 | (cp & 0x3F)) } };
+}
+
+// the eight code points where Latin-9 differs from Latin-1
+constexpr std::array<std::pair<uint8_t, uint16_t>, 8> latin9Differences = {{
+    { 0xA4, 0x20AC }, // euro sign
+    { 0xA6, 0x0160 }, // S caron
+    { 0xA8, 0x0161 }, // s caron
+    { 0xB4, 0x017D }, // Z caron
+    { 0xB8, 0x017E }, // z caron
+    { 0xBC, 0x0152 }, // OE
+    { 0xBD, 0x0153 }, // oe
+    { 0xBE, 0x0178 }, // Y diaeresis
+}};
+
+constexpr Utf8Table makeTable(bool latin9) {
+    Utf8Table table{};
+    for (uint32_t b = 0; b < 256; b++) {
+        table[b] = encode(b);
+    }
+    if (latin9) {
+        for (const auto& d : latin9Differences) {
+            table[d.first] = encode(d.second);
+        }
+    }
+    return table;
+}
+constexpr Utf8Table latin1Table = makeTable(false);
+constexpr Utf8Table latin9Table = makeTable(true);
+
+char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+bool startsWithNoCase(std::string_view s, std::string_view prefix) {
+    if (s.size() < prefix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix.size(); i++) {
+        if (lower(s[i]) != prefix[i]) return false;
+    }
+    return true;
+}
+// quoted or bare value that starts at s[pos]
+std::string_view attributeValue(std::string_view s, size_t pos, std::string_view stop) {
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t')) pos++;
+    if (pos < s.size() && (s[pos] == '"' || s[pos] == '\'')) {
+        size_t end = s.find(s[pos], pos + 1);
+        return end == std::string_view::npos ? std::string_view() : s.substr(pos + 1, end - pos - 1);
+    }
+    size_t end = s.find_first_of(stop, pos);
+    return s.substr(pos, end == std::string_view::npos ? std::string_view::npos : end - pos);
+}
+
+const size_t maxXmlDeclaration = 256;
+
+} // namespace
+
+Charset charsetFromName(std::string_view name) {
+    std::string n;
+    for (char c : name) {
+        if (c != '-' && c != '_' && c != ' ') n += lower(c);
+    }
+    if (n == "utf8" || n == "usascii" || n == "ascii") return Charset::Utf8;
+    if (n == "iso885915" || n == "latin9" || n == "l9") return Charset::Latin9;
+    if (n == "iso88591" || n == "latin1" || n == "l1") return Charset::Latin1;
+    return Charset::Unknown;
+}
+
+Charset charsetFromContentType(std::string_view content_type) {
+    for (size_t pos = content_type.find(';'); pos != std::string_view::npos; pos = content_type.find(';', pos + 1)) {
+        size_t p = pos + 1;
+        while (p < content_type.size() && (content_type[p] == ' ' || content_type[p] == '\t')) p++;
+        if (startsWithNoCase(content_type.substr(p), "charset=")) {
+            return charsetFromName(attributeValue(content_type, p + strlen("charset="), "; \t"));
+        }
+    }
+    return Charset::Unknown;
+}
+
+Charset charsetFromXmlDeclaration(std::string_view xml) {
+    if (xml.substr(0, 3) == "\xEF\xBB\xBF") {
+        return Charset::Utf8;
+    }
+    if (xml.substr(0, 5) != "<?xml") {
+        return Charset::Utf8;
+    }
+    size_t end = xml.substr(0, maxXmlDeclaration).find("?>");
+    if (end == std::string_view::npos) {
+        return Charset::Unknown;
+    }
+    std::string_view decl = xml.substr(0, end);
+    size_t enc = decl.find("encoding");
+    if (enc == std::string_view::npos) {
+        return Charset::Utf8;
+    }
+    size_t eq = decl.find('=', enc);
+    if (eq == std::string_view::npos) {
+        return Charset::Unknown;
+    }
+    return charsetFromName(attributeValue(decl, eq + 1, " \t?"));
+}
+
+size_t asciiPrefixLength(const char* data, size_t size) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 32 <= size; i += 32) {
+        int mask = _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if (word & 0x8080808080808080ULL) break;
+    }
+    for (; i < size; i++) {
+        if (static_cast<unsigned char>(data[i]) & 0x80) return i;
+    }
+    return size;
+}
+
+size_t latinToUtf8InPlace(std::string& text, Charset from) {
+    const Utf8Table& table = from == Charset::Latin1 ? latin1Table : latin9Table;
+    // first pass: where the 8-bit bytes are and how much the text grows
+    std::vector<size_t> positions;
+    size_t grow = 0;
+    const char* data = text.data();
+    for (size_t pos = asciiPrefixLength(data, text.size()); pos < text.size();
+         pos += 1 + asciiPrefixLength(data + pos + 1, text.size() - pos - 1)) {
+        positions.push_back(pos);
+        grow += table[static_cast<unsigned char>(data[pos])].len - 1;
+    }
+    if (positions.empty()) {
+        return 0;
+    }
+    // second pass from the back: ASCII runs move as blocks to their final
+    // place, each 8-bit byte is replaced by its sequence
+    size_t old_size = text.size();
+    text.resize(old_size + grow);
+    char* out = text.data();
+    size_t src_end = old_size;
+    size_t dst_end = old_size + grow;
+    for (size_t n = positions.size(); n-- > 0;) {
+        size_t pos = positions[n];
+        size_t run = src_end - pos - 1;
+        dst_end -= run;
+        memmove(out + dst_end, out + pos + 1, run);
+        const Utf8Seq& seq = table[static_cast<unsigned char>(out[pos])];
+        dst_end -= seq.len;
+        memcpy(out + dst_end, seq.bytes, seq.len);
+        src_end = pos;
+    }
+    return positions.size();
+}
+
+bool xmlToUtf8(std::string& xml, std::string_view content_type) {
+    Charset charset = charsetFromContentType(content_type);
+    if (charset == Charset::Unknown) {
+        charset = charsetFromXmlDeclaration(xml);
+    }
+    if (charset == Charset::Utf8) {
+        return true;
+    }
+    if (charset == Charset::Unknown) {
+        return false;
+    }
+    latinToUtf8InPlace(xml, charset);
+    // keep the declaration in line with the content
+    std::string_view prolog = std::string_view(xml).substr(0, maxXmlDeclaration);
+    size_t end = prolog.substr(0, 5) == "<?xml" ? prolog.find("?>") : std::string_view::npos;
+    size_t enc = end == std::string_view::npos ? end : prolog.substr(0, end).find("encoding");
+    size_t eq = enc == std::string_view::npos ? enc : prolog.find('=', enc);
+    if (eq != std::string_view::npos && eq < end) {
+        std::string_view value = attributeValue(prolog.substr(0, end), eq + 1, " \t?");
+        if (!value.empty()) {
+            xml.replace(value.data() - xml.data(), value.size(), "UTF-8");
+        }
+    }
+    return true;
+}
+
+int latin9FromCodepoint(uint32_t cp) {
+    for (const auto& d : latin9Differences) {
+        if (d.second == cp) return d.first;
+        if (d.first == cp) return -1; // replaced in Latin-9
+    }
+    return cp < 256 ? static_cast<int>(cp) : -1;
+}
+
+void Latin9Encoder::put(uint32_t cp) {
+    int b = latin9FromCodepoint(cp);
+    if (b >= 0) {
+        out_ += static_cast<char>(b);
+    } else {
+        out_ += "&#" + std::to_string(cp) + ";";
+    }
+}
+
+void Latin9Encoder::write(const char *data, size_t len) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    size_t i = 0;
+    // complete a sequence left over from the previous call
+    while (npending_ > 0 && i < len) {
+        size_t need = pending_[0] >= 0xF0 ? 4 : pending_[0] >= 0xE0 ? 3 : 2;
+        if ((p[i] & 0xC0) != 0x80) {
+            // broken sequence, the lead byte was Latin-1 after all
+            for (size_t k = 0; k < npending_; k++) put(pending_[k]);
+            npending_ = 0;
+            break;
+        }
+        pending_[npending_++] = p[i++];
+        if (npending_ == need) {
+            uint32_t cp = need == 2 ? ((pending_[0] & 0x1F) << 6) | (pending_[1] & 0x3F)
+                        : need == 3 ? ((pending_[0] & 0x0F) << 12) | ((pending_[1] & 0x3F) << 6) | (pending_[2] & 0x3F)
+                        : ((pending_[0] & 0x07) << 18) | ((pending_[1] & 0x3F) << 12) | ((pending_[2] & 0x3F) << 6) | (pending_[3] & 0x3F);
+            put(cp);
+            npending_ = 0;
+        }
+    }
+    while (i < len) {
+        size_t run = asciiPrefixLength(data + i, len - i);
+        out_.append(data + i, run);
+        i += run;
+        if (i == len) {
+            break;
+        }
+        unsigned char lead = p[i];
+        size_t need = (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 0;
+        if (need == 0 || lead == 0xC0 || lead == 0xC1) {
+            put(lead);
+            i++;
+            continue;
+        }
+        size_t have = 1;
+        while (have < need && i + have < len && (p[i + have] & 0xC0) == 0x80) have++;
+        if (have < need && i + have == len) {
+            // the rest arrives with the next write()
+            memcpy(pending_, p + i, have);
+            npending_ = have;
+            return;
+        }
+        if (have < need) {
+            put(lead);
+            i++;
+            continue;
+        }
+        uint32_t cp = need == 2 ? ((lead & 0x1F) << 6) | (p[i + 1] & 0x3F)
+                    : need == 3 ? ((lead & 0x0F) << 12) | ((p[i + 1] & 0x3F) << 6) | (p[i + 2] & 0x3F)
+                    : ((lead & 0x07) << 18) | ((p[i + 1] & 0x3F) << 12) | ((p[i + 2] & 0x3F) << 6) | (p[i + 3] & 0x3F);
+        put(cp);
+        i += need;
+    }
+}
+
+void Latin9Encoder::finish() {
+    for (size_t k = 0; k < npending_; k++) put(pending_[k]);
+    npending_ = 0;
+}
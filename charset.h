@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// Charset handling of the Finvoice messages. Maventa serves them in the
+// charset they were sent in, mostly ISO-8859-15, while everything after
+// the download works on UTF-8. Conversion is table driven and the plain
+// ASCII runs, most of a Finvoice message, are skipped without per byte work.
+enum class Charset {
+    Unknown,
+    Utf8,   // also US-ASCII
+    Latin1, // ISO-8859-1
+    Latin9, // ISO-8859-15
+};
+
+// "ISO-8859-15", "iso_8859-15", "latin9", "UTF-8" ...
+Charset charsetFromName(std::string_view name);
+// charset parameter of a Content-Type header value, Unknown when absent
+Charset charsetFromContentType(std::string_view content_type);
+// encoding of the <?xml ?> declaration, only the prolog is looked at.
+// UTF-8 when there is a BOM or a declaration without encoding.
+Charset charsetFromXmlDeclaration(std::string_view xml);
+
+// Length of the leading run of 7-bit bytes
+size_t asciiPrefixLength(const char* data, size_t size);
+
+// Converts Latin-1 / Latin-9 text to UTF-8 in place. Text without 8-bit
+// bytes is left untouched, otherwise the string grows once to its exact
+// UTF-8 size. Returns the number of converted characters.
+size_t latinToUtf8InPlace(std::string& text, Charset from);
+
+// Brings a downloaded XML document to UTF-8: the charset comes from the
+// Content-Type when it has one, from the XML declaration otherwise.
+// A converted document also declares encoding="UTF-8".
+// Returns false when the charset is not supported, text is left as is.
+bool xmlToUtf8(std::string& xml, std::string_view content_type = "");
+
+// Latin-9 byte of a unicode code point, -1 when Latin-9 has none
+int latin9FromCodepoint(uint32_t cp);
+
+// Incremental UTF-8 to ISO-8859-15 encoder for generated XML, appends to
+// out while the document is written. ASCII runs are copied as blocks,
+// characters Latin-9 cannot represent become character references
+// (&#8230;). A sequence split between two write() calls is carried over,
+// finish() flushes a truncated one. Bytes that are not valid UTF-8 are
+// taken as Latin-1.
+class Latin9Encoder {
+public:
+    explicit Latin9Encoder(std::string &out) : out_(out) {}
+    void write(const char *data, size_t len);
+    void write(std::string_view text) { write(text.data(), text.size()); }
+    void finish();
+private:
+    void put(uint32_t cp);
+    std::string &out_;
+    unsigned char pending_[4];
+    size_t npending_ = 0;
+};
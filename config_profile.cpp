@@ -67,4 +67,23 @@ ConfigProfile::ConfigProfile(const rapidjson::Value& profile, int i) {
     } else {
         LOG(DEBUG) << "Odoo Company ID not found in profile " << i;
     }
+    // optional, defaults in config_profile.h
+    if (profile.IsObject() && profile.HasMember("maventa_url") && profile["maventa_url"].IsString()) {
+        maventa_url = profile["maventa_url"].GetString();
+    }
+    if (profile.IsObject() && profile.HasMember("outbound_build_workers") && profile["outbound_build_workers"].IsInt()) {
+        outbound_build_workers = profile["outbound_build_workers"].GetInt();
+    }
+    if (profile.IsObject() && profile.HasMember("outbound_zip_workers") && profile["outbound_zip_workers"].IsInt()) {
+        outbound_zip_workers = profile["outbound_zip_workers"].GetInt();
+    }
+    if (profile.IsObject() && profile.HasMember("outbound_upload_workers") && profile["outbound_upload_workers"].IsInt()) {
+        outbound_upload_workers = profile["outbound_upload_workers"].GetInt();
+    }
+    if (profile.IsObject() && profile.HasMember("outbound_write_workers") && profile["outbound_write_workers"].IsInt()) {
+        outbound_write_workers = profile["outbound_write_workers"].GetInt();
+    }
+    if (profile.IsObject() && profile.HasMember("outbound_queue_size") && profile["outbound_queue_size"].IsInt()) {
+        outbound_queue_size = profile["outbound_queue_size"].GetInt();
+    }
 }
\ No newline at end of file
@@ -33,20 +33,35 @@ public:
     std::string getMaventaClientId() const { return maventa_client_id; }
     std::string getMaventaClientSecret() const { return maventa_client_secret; }
     std::string getMaventaVendorApiKey() const { return maventa_vendor_api_key; }
+    std::string getMaventaUrl() const { return maventa_url; }
     std::string getOdooUrl() const { return odoo_url; }
     std::string getOdooDb() const { return odoo_db; }
     std::string getOdooUsername() const { return odoo_username; }
     std::string getOdooApiKey() const { return odoo_api_key; }
     int getOdooCompanyId() const { return odoo_company_id; }
 
+    // Outbound pipeline tuning, optional
+    int getOutboundBuildWorkers() const { return outbound_build_workers; }
+    int getOutboundZipWorkers() const { return outbound_zip_workers; }
+    int getOutboundUploadWorkers() const { return outbound_upload_workers; }
+    int getOutboundWriteWorkers() const { return outbound_write_workers; }
+    int getOutboundQueueSize() const { return outbound_queue_size; }
+
 private:
     std::string name;
     std::string maventa_client_id;
     std::string maventa_client_secret;
     std::string maventa_vendor_api_key;
+    std::string maventa_url = "https://ax.maventa.com";
     std::string odoo_url;
     std::string odoo_db;
     std::string odoo_username;
     std::string odoo_api_key;
     int odoo_company_id;
+
+    int outbound_build_workers = 2;
+    int outbound_zip_workers = 1;
+    int outbound_upload_workers = 2;
+    int outbound_write_workers = 2;
+    int outbound_queue_size = 4;
 };
\ No newline at end of file
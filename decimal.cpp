@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "decimal.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr uint64_t pow10[Decimal::scale + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+bool isDigits(std::string_view text) {
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+    }
+    return true;
+}
+// a / b rounded half away from zero
+int64_t roundedDiv(__int128 a, __int128 b) {
+    __int128 half = b / 2;
+    return int64_t(a < 0 ? (a - half) / b : (a + half) / b);
+}
+
+} // namespace
+
+Decimal Decimal::fromDouble(double value) {
+    return fromUnits(std::llround(value * one));
+}
+
+bool Decimal::parse(std::string_view text, Decimal &value) {
+    while (!text.empty() && isSpace(text.front())) text.remove_prefix(1);
+    while (!text.empty() && isSpace(text.back())) text.remove_suffix(1);
+    bool negative = false;
+    if (!text.empty() && (text.front() == '-' || text.front() == '+')) {
+        negative = text.front() == '-';
+        text.remove_prefix(1);
+    }
+    size_t separator = text.find_first_of(",.");
+    std::string_view integer = text.substr(0, separator);
+    std::string_view fraction = separator == std::string_view::npos ? std::string_view() : text.substr(separator + 1);
+    if ((integer.empty() && fraction.empty()) || !isDigits(integer) || !isDigits(fraction)) {
+        return false;
+    }
+    uint64_t whole = 0;
+    if (!integer.empty()) {
+        auto [end, ec] = std::from_chars(integer.data(), integer.data() + integer.size(), whole);
+        if (ec != std::errc()) return false;
+    }
+    uint64_t frac = 0;
+    if (!fraction.empty()) {
+        size_t digits = std::min<size_t>(fraction.size(), scale);
+        std::from_chars(fraction.data(), fraction.data() + digits, frac);
+        frac *= pow10[scale - digits];
+        if (fraction.size() > size_t(scale) && fraction[scale] >= '5') {
+            frac++;
+        }
+    }
+    const uint64_t max = std::numeric_limits<int64_t>::max();
+    if (whole > max / one || whole * one > max - frac) {
+        return false;
+    }
+    uint64_t units = whole * one + frac;
+    value.units_ = negative ? -int64_t(units) : int64_t(units);
+    return true;
+}
+
+char *Decimal::format(char *first, char *last, int decimals, char separator) const {
+    int places = decimals < 0 || decimals > scale ? scale : decimals;
+    uint64_t magnitude = units_ < 0 ? 0 - uint64_t(units_) : uint64_t(units_);
+    uint64_t unit = pow10[scale - places];
+    uint64_t rounded = (magnitude + unit / 2) / unit;
+    uint64_t whole = rounded / pow10[places];
+    uint64_t frac = rounded % pow10[places];
+    if (decimals == shortest) {
+        while (places > 0 && frac % 10 == 0) {
+            frac /= 10;
+            places--;
+        }
+    }
+    char *p = first;
+    if (units_ < 0 && rounded != 0) {
+        if (p == last) return first;
+        *p++ = '-';
+    }
+    auto [end, ec] = std::to_chars(p, last, whole);
+    if (ec != std::errc()) return first;
+    p = end;
+    if (places > 0) {
+        if (last - p < places + 1) return first;
+        *p++ = separator;
+        for (int i = places - 1; i >= 0; --i) {
+            p[i] = char('0' + frac % 10);
+            frac /= 10;
+        }
+        p += places;
+    }
+    return p;
+}
+
+std::string Decimal::toString(int decimals, char separator) const {
+    char buffer[maxFormatSize];
+    return std::string(buffer, format(buffer, buffer + sizeof(buffer), decimals, separator));
+}
+
+Decimal operator*(Decimal a, Decimal b) {
+    return Decimal::fromUnits(roundedDiv(__int128(a.units_) * b.units_, Decimal::one));
+}
+
+Decimal Decimal::percent(Decimal rate) const {
+    return fromUnits(roundedDiv(__int128(units_) * rate.units_, __int128(one) * 100));
+}
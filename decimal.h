@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <compare>
+#include <string>
+#include <string_view>
+
+// Fixed-point decimal for amounts, quantities and percentages: a 64 bit
+// count of millionths, which covers any invoice total exactly. Text is
+// read and written with std::from_chars/std::to_chars, either comma or
+// dot is accepted as the separator, formatting writes Finvoice's comma
+// unless told otherwise.
+class Decimal {
+public:
+    static constexpr int scale = 6;             // decimals kept
+    static constexpr int64_t one = 1000000;     // 10^scale
+    static constexpr int shortest = -1;         // format with as few decimals as exact
+    static constexpr size_t maxFormatSize = 32; // enough for any value
+
+    constexpr Decimal() = default;
+    static constexpr Decimal fromUnits(int64_t units) {
+        Decimal d;
+        d.units_ = units;
+        return d;
+    }
+    static constexpr Decimal fromInt(int64_t value) {
+        return fromUnits(value * one);
+    }
+    // Rounded to the nearest millionth, for the numbers of the Odoo API
+    static Decimal fromDouble(double value);
+    // "1255,50", "-0.5", "12" ... Whitespace around the number is skipped,
+    // decimals past the scale are rounded. Returns false and leaves value
+    // as it was when text is not a number or does not fit.
+    static bool parse(std::string_view text, Decimal &value);
+    // 0 when text is empty or not a number
+    static Decimal parseOrZero(std::string_view text) {
+        Decimal value;
+        parse(text, value);
+        return value;
+    }
+
+    constexpr int64_t units() const { return units_; }
+    double toDouble() const { return double(units_) / one; }
+
+    // Writes the value rounded half away from zero to decimals (0-6 or
+    // shortest) into [first, last), returns the end of the text or first
+    // when it does not fit. Does not allocate.
+    char *format(char *first, char *last, int decimals = 2, char separator = ',') const;
+    std::string toString(int decimals = 2, char separator = ',') const;
+
+    constexpr Decimal &operator+=(Decimal other) { units_ += other.units_; return *this; }
+    constexpr Decimal &operator-=(Decimal other) { units_ -= other.units_; return *this; }
+    friend constexpr Decimal operator+(Decimal a, Decimal b) { return a += b; }
+    friend constexpr Decimal operator-(Decimal a, Decimal b) { return a -= b; }
+    constexpr Decimal operator-() const { return fromUnits(-units_); }
+    // Products are rounded half away from zero to the scale
+    friend Decimal operator*(Decimal a, Decimal b);
+    // rate percent of this, e.g. the VAT of a net amount
+    Decimal percent(Decimal rate) const;
+
+    friend constexpr auto operator<=>(Decimal, Decimal) = default;
+    friend constexpr bool operator==(Decimal, Decimal) = default;
+
+private:
+    int64_t units_ = 0;
+};
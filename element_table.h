@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Type of the text fields of T: T::string_type when T declares one
+template <typename T, typename = void>
+struct FieldString {
+    using type = std::string;
+};
+template <typename T>
+struct FieldString<T, std::void_t<typename T::string_type>> {
+    using type = typename T::string_type;
+};
+
+// One child element of a section: either a text field assigned straight to
+// a member of T, or (member == nullptr) a tag the parser handles itself.
+template <typename T>
+struct ElementEntry {
+    std::string_view name;
+    typename FieldString<T>::type T::*member = nullptr;
+    int tag = 0;
+};
+
+// Element name -> entry lookup for the children of one section, Entry is
+// any literal type with a std::string_view name. The seed of the hash is
+// searched at compile time so that every name of the table has a slot of
+// its own, find() then costs one hash and one compare.
+template <typename Entry, size_t N>
+class ElementTable {
+public:
+    static_assert(N > 0 && N < 64, "a section is visited with a 64 bit mask of seen entries");
+
+    consteval ElementTable(const Entry (&entries)[N]) {
+        for (size_t i = 0; i < N; ++i) {
+            entries_[i] = entries[i];
+            for (size_t j = 0; j < i; ++j) {
+                if (entries[j].name == entries[i].name) {
+                    throw "duplicate element name in table";
+                }
+            }
+        }
+        while (!place()) {
+            if (++seed_ == (1u << 20)) {
+                throw "no seed places every name of the table";
+            }
+        }
+    }
+    // Index of the entry for name, -1 when the element is not in the table
+    constexpr int find(std::string_view name) const {
+        int slot = slots_[hash(name, seed_) & (Slots - 1)];
+        return (slot && entries_[slot - 1].name == name) ? slot - 1 : -1;
+    }
+    constexpr const Entry& operator[](int index) const {
+        return entries_[index];
+    }
+    static constexpr size_t size() {
+        return N;
+    }
+private:
+    static constexpr size_t Slots = std::bit_ceil(N * 4);
+
+    static constexpr uint32_t hash(std::string_view name, uint32_t seed) {
+        uint32_t h = 2166136261u ^ seed;
+        for (char c : name) {
+            h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+        }
+        // the low bits of FNV only depend on the low bits of the seed and
+        // the name, fold the high ones in so that every seed counts
+        return h ^ (h >> 16);
+    }
+    constexpr bool place() {
+        slots_ = {};
+        for (size_t i = 0; i < N; ++i) {
+            auto& slot = slots_[hash(entries_[i].name, seed_) & (Slots - 1)];
+            if (slot) {
+                return false;
+            }
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        return true;
+    }
+
+    std::array<Entry, N> entries_{};
+    std::array<uint8_t, Slots> slots_{};
+    uint32_t seed_ = 0;
+};
+
+template <typename T, size_t N>
+consteval ElementTable<ElementEntry<T>, N> elementTable(const ElementEntry<T> (&entries)[N]) {
+    return ElementTable<ElementEntry<T>, N>(entries);
+}
+template <typename Entry, size_t N>
+consteval ElementTable<Entry, N> entryTable(const Entry (&entries)[N]) {
+    return ElementTable<Entry, N>(entries);
+}
@@ -23,13 +23,17 @@
 #include <rapidxml.hpp>
 #include <sstream>
 #include "util.h"
-#include <openssl/ssl.h>
-#include <openssl/sha.h>
+#include "finvoice_writer.h"
+#include "element_table.h"
+#include "xml_reader.h"
+#include <functional>
 #include <iomanip>
+#include <cstring>
 
 
-std::string formatTaxCode(const SellerPartyDetails& seller, const std::string& epiBei_) {
-    std::string sellerCountryCode = seller.SellerCountryCode;
+template <typename Seller>
+std::string formatTaxCode(const Seller& seller, const std::string& epiBei_) {
+    std::string sellerCountryCode(seller.SellerCountryCode);
     std::string epiBei = string_trim(epiBei_, " \t\n\r"); // Trim whitespace
 
     //try to extract country code from vat number
@@ -38,13 +42,13 @@ std::string formatTaxCode(const SellerPartyDetails& seller, const std::string& e
     }
     //try to extract country country name
     if(sellerCountryCode == "" && seller.SellerCountryName != "") {
-        sellerCountryCode = getCountryCodeFromName(seller.SellerCountryName);
+        sellerCountryCode = getCountryCodeFromName(std::string(seller.SellerCountryName));
     }
     //try to extract country code from IBAN if available
     if(sellerCountryCode == "" && seller.SellerAccountID != "") {
         // Extract country code from IBAN if available
         if(seller.SellerAccountID.size() >= 2) {
-            sellerCountryCode = getFirstTwoChars(seller.SellerAccountID);
+            sellerCountryCode = getFirstTwoChars(std::string(seller.SellerAccountID));
         }
     }
     // If no country code is available, default to FI
@@ -61,653 +65,648 @@ std::string formatTaxCode(const SellerPartyDetails& seller, const std::string& e
 
     return epiBei;
 }
-bool FinvoiceInvoice::parseFromXml(const std::string& xml) {
-
-    std::string xml_copy2 = xml;
-    WriteFileContent("/tmp/finvoice_invoice.xml", xml_copy2, true);
-    using namespace rapidxml;
-    std::vector<char> xml_copy(xml.begin(), xml.end());
-    xml_copy.push_back('\0');
-    xml_document<> doc;
-    try {
-        doc.parse<0>(&xml_copy[0]);
-        xml_node<>* root = doc.first_node("Finvoice");
-        if (!root) return false;
-
-        if(auto mtd = root->first_node("MessageTransmissionDetails")) {
-            if(auto msd = mtd->first_node("MessageSenderDetails")) {
-                if (auto n1 = msd->first_node("FromIdentifier")) seller.SellerOVT = n1->value();    
-                if (auto n2 = msd->first_node("FromIntermediator")) seller.SellerIntermediator = n2->value();    
+namespace {
+using rapidxml::xml_node;
+
+// Section tables of the received Finvoice 3.0 message. Elements not listed
+// are skipped, the tags mark the ones parseFromXml handles itself.
+enum RootTag { TransmissionDetails = 1, Details, SellerParty, SellerUnitNumber, SellerInformation, BuyerParty, BuyerUnitNumber, Epi, Row, Attachment };
+template <typename Invoice>
+constexpr auto rootElements = elementTable<Invoice>({
+    {"MessageTransmissionDetails", nullptr, TransmissionDetails},
+    {"InvoiceDetails", nullptr, Details},
+    {"SellerPartyDetails", nullptr, SellerParty},
+    {"SellerOrganisationUnitNumber", nullptr, SellerUnitNumber},
+    {"SellerInformationDetails", nullptr, SellerInformation},
+    {"BuyerPartyDetails", nullptr, BuyerParty},
+    {"BuyerOrganisationUnitNumber", nullptr, BuyerUnitNumber},
+    {"EpiDetails", nullptr, Epi},
+    {"InvoiceRow", nullptr, Row},
+    {"AttachmentDetails", nullptr, Attachment},
+});
+
+enum SectionTag { SenderDetails = 1, PaymentTerms, FreeText, PostalAddress, VatRegistration, AccountDetails, CurrencyAmount, SubRow,
+                  EpiIdentification, EpiParty, EpiPayment, EpiBfi, EpiBeneficiary, EpiBeiValue, InlineContent };
+template <typename Seller>
+constexpr auto transmissionElements = elementTable<Seller>({
+    {"MessageSenderDetails", nullptr, SenderDetails},
+});
+template <typename Seller>
+constexpr auto senderElements = elementTable<Seller>({
+    {"FromIdentifier", &Seller::SellerOVT},
+    {"FromIntermediator", &Seller::SellerIntermediator},
+});
+
+template <typename Invoice>
+constexpr auto detailsElements = elementTable<Invoice>({
+    {"InvoiceNumber", &Invoice::InvoiceNumber},
+    {"InvoiceDate", &Invoice::InvoiceDate},
+    {"InvoiceTypeCode", &Invoice::InvoiceTypeCode},
+    {"OriginCode", &Invoice::OriginCode},
+    {"InvoiceTypeText", &Invoice::InvoiceTypeText},
+    {"InvoiceRecipientCode", &Invoice::InvoiceRecipientCode},
+    {"InvoiceRecipientText", &Invoice::InvoiceRecipientText},
+    {"InvoiceRecipientLanguageCode", &Invoice::InvoiceRecipientLanguageCode},
+    {"InvoiceCurrencyCode", &Invoice::InvoiceCurrencyCode},
+    {"InvoiceTotalVatExcludedAmount", &Invoice::InvoiceTotalVatExcludedAmount},
+    {"InvoiceTotalVatAmount", &Invoice::InvoiceTotalVatAmount},
+    {"InvoiceTotalVatIncludedAmount", &Invoice::InvoiceTotalVatIncludedAmount},
+    {"RowsTotalVatExcludedAmount", &Invoice::RowsTotalVatExcludedAmount},
+    {"BuyerReferenceIdentifier", &Invoice::BuyerReferenceIdentifier},
+    {"OrderIdentifier", &Invoice::OrderIdentifier},
+    {"InvoiceUrlText", &Invoice::InvoiceUrlText},
+    {"InvoiceUrlNameText", &Invoice::InvoiceUrlNameText},
+    {"PaymentTermsDetails", nullptr, PaymentTerms},
+    {"InvoiceFreeText", &Invoice::InvoiceFreeText, FreeText},
+});
+template <typename Invoice>
+constexpr auto paymentTermsElements = elementTable<Invoice>({
+    {"PaymentTermsFreeText", &Invoice::PaymentTermsFreeText, FreeText},
+    {"PaymentOverDueFinePercent", &Invoice::PaymentOverDueFinePercent},
+    {"PaymentOverDueFineFreeText", &Invoice::PaymentOverDueFineFreeText},
+    {"InvoiceDueDate", &Invoice::InvoiceDueDate},
+});
+
+template <typename Seller>
+constexpr auto sellerElements = elementTable<Seller>({
+    {"SellerOrganisationName", &Seller::SellerOrganisationName},
+    {"SellerOrganisationTaxCode", &Seller::SellerOrganisationTaxCode},
+    {"SellerOrganisationIdentifier", &Seller::SellerOrganisationIdentifier},
+    {"SellerDepartment", &Seller::SellerDepartment},
+    {"SellerStreetName", &Seller::SellerStreetName},
+    {"SellerTownName", &Seller::SellerTownName},
+    {"SellerPostCodeIdentifier", &Seller::SellerPostCodeIdentifier},
+    {"SellerCountryCode", &Seller::SellerCountryCode},
+    {"SellerPhoneNumberIdentifier", &Seller::SellerPhoneNumberIdentifier},
+    {"SellerEmailaddressIdentifier", &Seller::SellerEmailaddressIdentifier},
+    {"SellerWebaddressIdentifier", &Seller::SellerWebaddressIdentifier},
+    {"SellerPostalAddressDetails", nullptr, PostalAddress},
+    {"SellerVatRegistrationDetails", nullptr, VatRegistration},
+});
+template <typename Seller>
+constexpr auto sellerPostalElements = elementTable<Seller>({
+    {"SellerTownName", &Seller::SellerTownName},
+    {"SellerStreetName", &Seller::SellerStreetName},
+    {"SellerPostCodeIdentifier", &Seller::SellerPostCodeIdentifier},
+    {"SellerCountryCode", &Seller::SellerCountryCode},
+    {"SellerCountryName", &Seller::SellerCountryName},
+});
+template <typename Seller>
+constexpr auto sellerVatElements = elementTable<Seller>({
+    {"SellerVatRegistrationId", &Seller::SellerVatRegistrationId},
+});
+// SellerInformationDetails only fills in what SellerPartyDetails left empty
+template <typename Seller>
+constexpr auto sellerInformationElements = elementTable<Seller>({
+    {"SellerHomeTownName", &Seller::SellerTownName},
+    {"SellerPhoneNumber", &Seller::SellerPhoneNumberIdentifier},
+    {"SellerCommonEmailaddressIdentifier", &Seller::SellerEmailaddressIdentifier},
+    {"SellerWebaddressIdentifier", &Seller::SellerWebaddressIdentifier},
+    {"SellerAccountDetails", nullptr, AccountDetails},
+});
+//TODO add support for many accounts
+template <typename Seller>
+constexpr auto sellerAccountElements = elementTable<Seller>({
+    {"SellerAccountName", &Seller::SellerAccountName},
+    {"SellerAccountID", &Seller::SellerAccountID},
+    {"SellerBic", &Seller::SellerBic},
+});
+
+template <typename Buyer>
+constexpr auto buyerElements = elementTable<Buyer>({
+    {"BuyerOrganisationName", &Buyer::BuyerOrganisationName},
+    {"BuyerOrganisationTaxCode", &Buyer::BuyerOrganisationTaxCode},
+    {"BuyerPartyIdentifier", &Buyer::BuyerPartyIdentifier},
+    {"BuyerOrganisationIdentifier", &Buyer::BuyerOrganisationIdentifier},
+    {"BuyerDepartment", &Buyer::BuyerDepartment},
+    {"BuyerStreetName", &Buyer::BuyerStreetName},
+    {"BuyerTownName", &Buyer::BuyerTownName},
+    {"BuyerPostCodeIdentifier", &Buyer::BuyerPostCodeIdentifier},
+    {"BuyerCountryCode", &Buyer::BuyerCountryCode},
+    {"BuyerPhoneNumberIdentifier", &Buyer::BuyerPhoneNumberIdentifier},
+    {"BuyerEmailaddressIdentifier", &Buyer::BuyerEmailaddressIdentifier},
+    {"BuyerWebaddressIdentifier", &Buyer::BuyerWebaddressIdentifier},
+    {"BuyerAccountDetails", nullptr, AccountDetails},
+    {"BuyerVatRegistrationDetails", nullptr, VatRegistration},
+});
+template <typename Buyer>
+constexpr auto buyerAccountElements = elementTable<Buyer>({
+    {"BuyerAccountID", &Buyer::BuyerAccountID},
+    {"BuyerBic", &Buyer::BuyerBic},
+});
+template <typename Buyer>
+constexpr auto buyerVatElements = elementTable<Buyer>({
+    {"BuyerVatRegistrationId", &Buyer::BuyerVatRegistrationId},
+});
+
+// EpiDetails sections are nested a level or two, the leaves all land in the invoice
+template <typename Invoice>
+constexpr auto epiElements = elementTable<Invoice>({
+    {"EpiIdentificationDetails", nullptr, EpiIdentification},
+    {"EpiPartyDetails", nullptr, EpiParty},
+    {"EpiPaymentInstructionDetails", nullptr, EpiPayment},
+});
+template <typename Invoice>
+constexpr auto epiIdentificationElements = elementTable<Invoice>({
+    {"EpiDate", &Invoice::EpiDate},
+    {"EpiReference", &Invoice::EpiReference},
+});
+template <typename Invoice>
+constexpr auto epiPartyElements = elementTable<Invoice>({
+    {"EpiBfiPartyDetails", nullptr, EpiBfi},
+    {"EpiBeneficiaryPartyDetails", nullptr, EpiBeneficiary},
+});
+template <typename Invoice>
+constexpr auto epiBfiElements = elementTable<Invoice>({
+    {"EpiBfiIdentifier", &Invoice::EpiBfiIdentifier},
+});
+template <typename Invoice>
+constexpr auto epiBeneficiaryElements = elementTable<Invoice>({
+    {"EpiNameAddressDetails", &Invoice::EpiNameAddressDetails},
+    {"EpiBei", &Invoice::EpiBei, EpiBeiValue},
+    {"EpiAccountID", &Invoice::EpiAccountID},
+});
+template <typename Invoice>
+constexpr auto epiPaymentElements = elementTable<Invoice>({
+    {"EpiRemittanceInfoIdentifier", &Invoice::EpiRemittanceInfoIdentifier},
+    {"EpiInstructedAmount", &Invoice::EpiInstructedAmount, CurrencyAmount},
+    {"EpiDateOptionDate", &Invoice::EpiDateOptionDate},
+});
+
+template <typename Row>
+constexpr auto rowElements = elementTable<Row>({
+    {"ArticleIdentifier", &Row::ArticleIdentifier},
+    {"ArticleName", &Row::ArticleName},
+    {"ArticleDescription", &Row::ArticleDescription},
+    {"UnitPriceNetAmount", &Row::UnitPriceNetAmount},
+    {"RowFreeText", &Row::RowFreeText},
+    {"DeliveredQuantity", &Row::DeliveredQuantity},
+    {"InvoicedQuantity", &Row::InvoicedQuantity},
+    {"RowAmount", &Row::RowAmount},
+    {"OrderedQuantity", &Row::OrderedQuantity},
+    {"UnitPriceAmount", &Row::UnitPriceAmount},
+    {"RowVatRatePercent", &Row::RowVatRatePercent},
+    {"RowVatAmount", &Row::RowVatAmount},
+    {"RowVatExcludedAmount", &Row::RowVatExcludedAmount, CurrencyAmount},
+    {"RowVatIncludedAmount", &Row::RowVatIncludedAmount},
+    {"RowDiscountPercent", &Row::RowDiscountPercent},
+    {"RowDiscountAmount", &Row::RowDiscountAmount},
+    {"RowUnitCode", &Row::RowUnitCode},
+    {"RowDescription", &Row::RowDescription},
+    {"RowOrderLineReference", &Row::RowOrderLineReference},
+    {"RowDeliveryDate", &Row::RowDeliveryDate},
+    {"RowBuyerArticleIdentifier", &Row::RowBuyerArticleIdentifier},
+    {"RowSellerArticleIdentifier", &Row::RowSellerArticleIdentifier},
+    {"RowCommentText", &Row::RowCommentText},
+    {"SubInvoiceRow", nullptr, SubRow},
+});
+template <typename Row>
+constexpr auto subRowElements = elementTable<Row>({
+    {"SubRowFreeText", &Row::SubRowFreeText},
+});
+
+// Inline attachments, the base64 content comes before the name in Finvoice
+constexpr auto attachmentElements = elementTable<FinvoiceAttachment>({
+    {"AttachmentContent", nullptr, InlineContent},
+    {"AttachmentName", &FinvoiceAttachment::AttachmentName},
+    {"AttachmentMimeType", &FinvoiceAttachment::AttachmentMimeType},
+});
+
+// The section parser below runs on either of two element types: DomElement,
+// a node of the rapidxml tree, or StreamElement, the element an XmlReader
+// is positioned in. Both read their children in document order.
+class DomElement {
+public:
+    explicit DomElement(xml_node<>* node) : node_(node) {}
+    std::string_view name() const {
+        return std::string_view(node_->name(), node_->name_size());
+    }
+    std::string value() {
+        return std::string(node_->value(), node_->value_size());
+    }
+    std::string attribute(const char* name) const {
+        auto attr = node_->first_attribute(name);
+        return attr ? std::string(attr->value(), attr->value_size()) : std::string();
+    }
+    template <typename Text>
+    void content(Text&& text) {
+        text(std::string_view(node_->value(), node_->value_size()));
+    }
+    template <typename Visit>
+    void children(Visit&& visit) {
+        for (xml_node<>* child = node_->first_node(); child; child = child->next_sibling()) {
+            if (child->type() == rapidxml::node_type::node_element) {
+                DomElement element(child);
+                visit(element);
             }
         }
-        // Parse InvoiceDetails
-        if (auto details = root->first_node("InvoiceDetails")) {
-            
-            
-            if (auto n = details->first_node("InvoiceNumber")) InvoiceNumber = n->value();
-            if (auto d = details->first_node("InvoiceDate")) InvoiceDate = d->value();
-            if (auto t = details->first_node("InvoiceTypeCode")) InvoiceTypeCode = t->value();
-            if (auto c = details->first_node("OriginCode")) OriginCode = c->value();
-            if (auto s = details->first_node("InvoiceTypeText")) InvoiceTypeText = s->value();
-            if (auto r = details->first_node("InvoiceRecipientCode")) InvoiceRecipientCode = r->value();
-            if (auto e = details->first_node("InvoiceRecipientText")) InvoiceRecipientText = e->value();
-            if (auto f = details->first_node("InvoiceRecipientLanguageCode")) InvoiceRecipientLanguageCode = f->value();
-            if (auto g = details->first_node("InvoiceCurrencyCode")) InvoiceCurrencyCode = g->value();
-            if (auto h = details->first_node("InvoiceTotalVatExcludedAmount")) InvoiceTotalVatExcludedAmount = h->value();
-            if (auto i = details->first_node("InvoiceTotalVatAmount")) InvoiceTotalVatAmount = i->value();
-            if (auto j = details->first_node("InvoiceTotalVatIncludedAmount")) InvoiceTotalVatIncludedAmount = j->value();
-            if (auto l = details->first_node("RowsTotalVatExcludedAmount")) RowsTotalVatExcludedAmount = l->value();
-            if (auto n1 = details->first_node("BuyerReferenceIdentifier")) BuyerReferenceIdentifier = n1->value();
-            if (auto n2 = details->first_node("OrderIdentifier")) OrderIdentifier = n2->value();
-            
-            if (auto k = details->first_node("PaymentTermsDetails")) {
-                // Parse all PaymentTermsFreeText nodes
-                for (auto freeTextNode = k->first_node("PaymentTermsFreeText"); 
-                    freeTextNode; 
-                    freeTextNode = freeTextNode->next_sibling("PaymentTermsFreeText")) 
-                {
-                    if (freeTextNode->value()) {
-                        if(PaymentTermsFreeText != "") PaymentTermsFreeText+="\n";
-                        PaymentTermsFreeText+=freeTextNode->value();
-                    }
-                }
-                if (auto m = k->first_node("PaymentOverDueFinePercent")) PaymentOverDueFinePercent = m->value();
-                if (auto l = k->first_node("PaymentOverDueFineFreeText")) PaymentOverDueFineFreeText = l->value();
-                if (auto o = k->first_node("InvoiceDueDate")) InvoiceDueDate = o->value();
-            }
-            
-            // Parse all InvoiceFreeText nodes
-            if (auto details = root->first_node("InvoiceDetails")) {
-                for (auto freeTextNode = details->first_node("InvoiceFreeText"); 
-                    freeTextNode; 
-                    freeTextNode = freeTextNode->next_sibling("InvoiceFreeText")) 
-                {
-                    if (freeTextNode->value()) {
-                        if(InvoiceFreeText != "") InvoiceFreeText+="\n";
-                        InvoiceFreeText+=freeTextNode->value();
-                    }
-                }
-            }
-
-            if (auto o = details->first_node("InvoiceUrlText")) InvoiceUrlText = o->value();
-            if (auto p = details->first_node("InvoiceUrlNameText")) InvoiceUrlNameText = p->value();
-            // Add more fields as needed from the Finvoice 3.0 standard
+    }
+private:
+    xml_node<>* node_;
+};
+
+// Each member function reads the element to its end tag, an element that
+// was not read is skipped by the children() loop of its parent
+class StreamElement {
+public:
+    StreamElement(XmlReader& reader, const XmlReader::StartTag& tag) : reader_(reader), tag_(tag), open_(!tag.empty) {}
+    std::string_view name() const {
+        return tag_.name;
+    }
+    std::string value() {
+        std::string value;
+        content([&value](std::string_view piece) { value.append(piece); });
+        return value;
+    }
+    std::string attribute(const char* name) const {
+        std::string value;
+        XmlReader::attribute(tag_, name, value);
+        return value;
+    }
+    // Text of the element piece by piece, child elements are skipped
+    template <typename Text>
+    void content(Text&& text) {
+        XmlReader::StartTag child;
+        while (open_ && reader_.next(child, text)) {
+            reader_.skip(child);
         }
-
-        // Parse SellerPartyDetails
-        if (auto sellerNode = root->first_node("SellerPartyDetails")) {
-            if (auto n = sellerNode->first_node("SellerOrganisationName")) seller.SellerOrganisationName = n->value();
-            if (auto t = sellerNode->first_node("SellerOrganisationTaxCode")) seller.SellerOrganisationTaxCode = t->value();
-            if (auto a = sellerNode->first_node("SellerOrganisationIdentifier")) seller.SellerOrganisationIdentifier = a->value();
-            if (auto b = sellerNode->first_node("SellerDepartment")) seller.SellerDepartment = b->value();
-            if (auto c = sellerNode->first_node("SellerStreetName")) seller.SellerStreetName = c->value();
-            if (auto d = sellerNode->first_node("SellerTownName")) seller.SellerTownName = d->value();
-            if (auto e = sellerNode->first_node("SellerPostCodeIdentifier")) seller.SellerPostCodeIdentifier = e->value();
-            if (auto f = sellerNode->first_node("SellerCountryCode")) seller.SellerCountryCode = f->value();
-            if (auto g = sellerNode->first_node("SellerPhoneNumberIdentifier")) seller.SellerPhoneNumberIdentifier = g->value();
-            if (auto h = sellerNode->first_node("SellerEmailaddressIdentifier")) seller.SellerEmailaddressIdentifier = h->value();
-            if (auto i = sellerNode->first_node("SellerWebaddressIdentifier")) seller.SellerWebaddressIdentifier = i->value();
-
-            if(seller.SellerStreetName == "") {
-                if (auto j = sellerNode->first_node("SellerPostalAddressDetails")) {
-                    if (auto a1 = j->first_node("SellerTownName")) seller.SellerTownName = a1->value();
-                    if (auto a = j->first_node("SellerStreetName")) seller.SellerStreetName = a->value();
-                    if (auto b = j->first_node("SellerPostCodeIdentifier")) seller.SellerPostCodeIdentifier = b->value();
-                    if (auto c = j->first_node("SellerCountryCode")) seller.SellerCountryCode = c->value();
-                    if (auto d = j->first_node("SellerCountryName")) seller.SellerCountryName = d->value();
-                }
-            }
-            
-            if (auto k = sellerNode->first_node("SellerVatRegistrationDetails")) {
-                if (auto vat = k->first_node("SellerVatRegistrationId")) seller.SellerVatRegistrationId = vat->value();
-            }
-            // Add more SellerPartyDetails fields as needed from the Finvoice 3.0 standard
+        open_ = false;
+    }
+    template <typename Visit>
+    void children(Visit&& visit) {
+        XmlReader::StartTag tag;
+        while (open_ && reader_.next(tag)) {
+            StreamElement child(reader_, tag);
+            visit(child);
+            child.skip();
         }
-        
-
-
-
-        if (auto oun = root->first_node("SellerOrganisationUnitNumber")) seller.SellerOrganisationUnitNumber = oun->value();
-
-        if (auto sid = root->first_node("SellerInformationDetails")) {
-            if(seller.SellerTownName=="") {
-                if (auto n = sid->first_node("SellerHomeTownName")) seller.SellerTownName = n->value();
-            }
-            if(seller.SellerPhoneNumberIdentifier=="") {
-                if (auto n = sid->first_node("SellerPhoneNumber")) seller.SellerPhoneNumberIdentifier = n->value();
-            }
-            if(seller.SellerEmailaddressIdentifier=="") {
-                if (auto n = sid->first_node("SellerCommonEmailaddressIdentifier")) seller.SellerEmailaddressIdentifier = n->value();
-            }
-            if(seller.SellerWebaddressIdentifier=="") {
-                if (auto n = sid->first_node("SellerWebaddressIdentifier")) seller.SellerWebaddressIdentifier = n->value();
-            }   
-            
-            //TODO add support for many accounts
-            if (auto j = sid->first_node("SellerAccountDetails")) {
-                if (auto san = j->first_node("SellerAccountName")) seller.SellerAccountName = san->value();
-                if (auto acc = j->first_node("SellerAccountID")) seller.SellerAccountID = acc->value();
-                if (auto bic = j->first_node("SellerBic")) seller.SellerBic = bic->value();
-            }
+        open_ = false;
+    }
+    void skip() {
+        if (open_) {
+            reader_.skip(tag_);
+            open_ = false;
         }
-
-        // Parse BuyerPartyDetails
-        if (auto buyerNode = root->first_node("BuyerPartyDetails")) {
-            if (auto n = buyerNode->first_node("BuyerOrganisationName")) buyer.BuyerOrganisationName = n->value();
-            if (auto t = buyerNode->first_node("BuyerOrganisationTaxCode")) buyer.BuyerOrganisationTaxCode = t->value();
-            if (auto t = buyerNode->first_node("BuyerPartyIdentifier")) buyer.BuyerPartyIdentifier = t->value();
-            if (auto a = buyerNode->first_node("BuyerOrganisationIdentifier")) buyer.BuyerOrganisationIdentifier = a->value();
-            if (auto b = buyerNode->first_node("BuyerDepartment")) buyer.BuyerDepartment = b->value();
-            if (auto c = buyerNode->first_node("BuyerStreetName")) buyer.BuyerStreetName = c->value();
-            if (auto d = buyerNode->first_node("BuyerTownName")) buyer.BuyerTownName = d->value();
-            if (auto e = buyerNode->first_node("BuyerPostCodeIdentifier")) buyer.BuyerPostCodeIdentifier = e->value();
-            if (auto f = buyerNode->first_node("BuyerCountryCode")) buyer.BuyerCountryCode = f->value();
-            if (auto g = buyerNode->first_node("BuyerPhoneNumberIdentifier")) buyer.BuyerPhoneNumberIdentifier = g->value();
-            if (auto h = buyerNode->first_node("BuyerEmailaddressIdentifier")) buyer.BuyerEmailaddressIdentifier = h->value();
-            if (auto i = buyerNode->first_node("BuyerWebaddressIdentifier")) buyer.BuyerWebaddressIdentifier = i->value();
-            if (auto j = buyerNode->first_node("BuyerAccountDetails")) {
-                if (auto acc = j->first_node("BuyerAccountID")) buyer.BuyerAccountID = acc->value();
-                if (auto bic = j->first_node("BuyerBic")) buyer.BuyerBic = bic->value();
-            }
-            if (auto k = buyerNode->first_node("BuyerVatRegistrationDetails")) {
-                if (auto vat = k->first_node("BuyerVatRegistrationId")) buyer.BuyerVatRegistrationId = vat->value();
+    }
+private:
+    XmlReader& reader_;
+    XmlReader::StartTag tag_;
+    bool open_;
+};
+
+// Where the text of the elements goes: std::string fields take it over,
+// the string_view fields of ArenaFinvoiceInvoice get a copy in its arena
+class TextStore {
+public:
+    explicit TextStore(ArenaFinvoiceInvoice* arena = nullptr) : arena_(arena) {}
+
+    template <typename Element>
+    void assign(std::string& field, Element& element) {
+        field = element.value();
+    }
+    template <typename Element>
+    void assign(std::string_view& field, Element& element) {
+        scratch_.clear();
+        element.content([this](std::string_view piece) { scratch_.append(piece); });
+        field = arena_->store(scratch_);
+    }
+    void set(std::string& field, std::string_view value) {
+        field.assign(value);
+    }
+    void set(std::string_view& field, std::string_view value) {
+        field = arena_->store(value);
+    }
+    // Repeated free text elements are joined with newlines
+    template <typename Element>
+    void appendFreeText(std::string& text, Element& element) {
+        if (!text.empty()) {
+            text += "\n";
+        }
+        element.content([&text](std::string_view piece) { text.append(piece); });
+    }
+    template <typename Element>
+    void appendFreeText(std::string_view& text, Element& element) {
+        scratch_.assign(text);
+        appendFreeText(scratch_, element);
+        text = arena_->store(scratch_);
+    }
+private:
+    ArenaFinvoiceInvoice* arena_;
+    std::string scratch_; // text of a string_view field before it goes to the arena
+};
+
+// Visits the children of parent once. Member entries are assigned the first
+// time their element is seen, like first_node() would find them; the others
+// are handed to special(entry, child, first) together with the target.
+// Returns the entries seen.
+template <typename Element, typename T, size_t N, typename Special>
+uint64_t visitElements(Element& parent, const ElementTable<ElementEntry<T>, N>& table, T& target, TextStore& store, Special&& special) {
+    uint64_t seen = 0;
+    parent.children([&](Element& child) {
+        int i = table.find(child.name());
+        if (i < 0) {
+            return;
+        }
+        bool first = !(seen & (uint64_t(1) << i));
+        seen |= uint64_t(1) << i;
+        const auto& entry = table[i];
+        if (entry.tag == 0) {
+            if (first) {
+                store.assign(target.*entry.member, child);
             }
-           
-            // Add more BuyerPartyDetails fields as needed from the Finvoice 3.0 standard
+        } else {
+            special(entry, child, first);
         }
-        if (auto boun = root->first_node("BuyerOrganisationUnitNumber")) buyer.BuyerOrganisationUnitNumber = boun->value();
-
-        // Parse EpiDetails
-        if (auto epiNode = root->first_node("EpiDetails")) {
-            
-            if (auto epiDate = epiNode->first_node("EpiIdentificationDetails")->first_node("EpiDate")) EpiDate = epiDate->value();
-            if (auto epiRef = epiNode->first_node("EpiIdentificationDetails")->first_node("EpiReference")) EpiReference = epiRef->value();
-
-            if (auto epiBfiIdentifier = epiNode->first_node("EpiPartyDetails")->first_node("EpiBfiPartyDetails")->first_node("EpiBfiIdentifier")) EpiBfiIdentifier = epiBfiIdentifier->value();
-            if (auto epiNameAddressDetails = epiNode->first_node("EpiPartyDetails")->first_node("EpiBeneficiaryPartyDetails")->first_node("EpiNameAddressDetails")) EpiNameAddressDetails = epiNameAddressDetails->value();
-            if (auto epiBei = epiNode->first_node("EpiPartyDetails")->first_node("EpiBeneficiaryPartyDetails")->first_node("EpiBei")) EpiBei = formatTaxCode(seller, epiBei->value());
-            if (auto epiAccountID = epiNode->first_node("EpiPartyDetails")->first_node("EpiBeneficiaryPartyDetails")->first_node("EpiAccountID")) EpiAccountID = epiAccountID->value();
-
-            if (auto epiRemittanceInfoIdentifier = epiNode->first_node("EpiPaymentInstructionDetails")->first_node("EpiRemittanceInfoIdentifier")) EpiRemittanceInfoIdentifier = epiRemittanceInfoIdentifier->value();
-            if (auto epiInstructedAmount = epiNode->first_node("EpiPaymentInstructionDetails")->first_node("EpiInstructedAmount")) EpiInstructedAmount = epiInstructedAmount->value();
-            if (auto epiInstructedAmountCurrencyIdentifier = epiNode->first_node("EpiPaymentInstructionDetails")->first_node("EpiInstructedAmount")->first_attribute("AmountCurrencyIdentifier")) EpiInstructedAmountCurrencyIdentifier = epiInstructedAmountCurrencyIdentifier->value();
-            if (auto epiDateOptionDate = epiNode->first_node("EpiPaymentInstructionDetails")->first_node("EpiDateOptionDate")) EpiDateOptionDate = epiDateOptionDate->value();
-
+    });
+    return seen;
+}
+template <typename Element, typename T, size_t N>
+uint64_t visitElements(Element& parent, const ElementTable<ElementEntry<T>, N>& table, T& target, TextStore& store) {
+    return visitElements(parent, table, target, store, [](const auto&, Element&, bool) {});
+}
+// Moves the fields of the entries seen from one target to another
+template <typename T, size_t N>
+void moveSeen(const ElementTable<ElementEntry<T>, N>& table, uint64_t seen, T& from, T& to) {
+    for (size_t i = 0; i < N; ++i) {
+        if (table[i].member && (seen & (uint64_t(1) << i))) {
+            to.*table[i].member = std::move(from.*table[i].member);
         }
-        // Parse InvoiceRows
-        if (auto rowsNode = root->first_node("InvoiceRow")) {
-            for (auto row = rowsNode; row; row = row->next_sibling("InvoiceRow")) {
-                InvoiceRow invoiceRow;
-
-                if(row->first_node("SubInvoiceRow")) {
-                    if (auto a = row->first_node("SubInvoiceRow")->first_node("SubRowFreeText"))  invoiceRow.SubRowFreeText = a->value();
-                }
-                if (auto a = row->first_node("ArticleIdentifier")) invoiceRow.ArticleIdentifier = a->value();
-                if (auto a = row->first_node("ArticleName")) invoiceRow.ArticleName = a->value();
-                if (auto a = row->first_node("ArticleDescription")) invoiceRow.ArticleDescription = a->value();
-                if (auto a = row->first_node("UnitPriceNetAmount")) invoiceRow.UnitPriceNetAmount = a->value();
-                if (auto a = row->first_node("RowFreeText")) invoiceRow.RowFreeText = a->value();
-
-                if (auto a = row->first_node("DeliveredQuantity")) invoiceRow.DeliveredQuantity = a->value();
-                if (auto a = row->first_node("InvoicedQuantity")) invoiceRow.InvoicedQuantity = a->value();
-                if (auto a = row->first_node("RowAmount")) invoiceRow.RowAmount = a->value();
-
-                
-                
-                
+    }
+}
 
-                if (auto q = row->first_node("OrderedQuantity")) invoiceRow.OrderedQuantity = q->value();
-                if (auto u = row->first_node("UnitPriceAmount")) invoiceRow.UnitPriceAmount = u->value();
-                if (auto v = row->first_node("RowVatRatePercent")) invoiceRow.RowVatRatePercent = v->value();
-                if (auto w = row->first_node("RowVatAmount")) invoiceRow.RowVatAmount = w->value();
-                if (auto x = row->first_node("RowVatExcludedAmount")) invoiceRow.RowVatExcludedAmount = x->value();
-                if(row->first_node("RowVatExcludedAmount") ) {
-                    if(row->first_node("RowVatExcludedAmount")->first_attribute("AmountCurrencyIdentifier")) {
-                        if (auto x = row->first_node("RowVatExcludedAmount")->first_attribute("AmountCurrencyIdentifier")) invoiceRow.AmountCurrencyIdentifier = x->value();
-                    }
+// Fills inv from the children of the Finvoice root element, section by
+// section in document order. Parts that depend on other sections are
+// resolved once the whole document has been read.
+template <typename Element, typename Invoice>
+void parseFinvoice(Invoice& inv, Element& root, TextStore& store, const typename Invoice::RowConsumer& rowConsumer,
+                   const typename Invoice::AttachmentContentSink& attachmentSink) {
+    using Seller = typename Invoice::Seller;
+    using Buyer = typename Invoice::Buyer;
+    using InvoiceRow = typename Invoice::Row;
+    Seller& seller = inv.seller;
+    Seller info;
+    uint64_t infoSeen = 0;
+    std::string epiBei;
+    bool hasEpiBei = false;
+
+    std::function<void (const ElementEntry<Invoice>&, Element&, bool)> epiSection;
+    epiSection = [&](const auto& entry, Element& node, bool first) {
+        if (!first) return;
+        switch (entry.tag) {
+            case EpiIdentification: visitElements(node, epiIdentificationElements<Invoice>, inv, store); break;
+            case EpiParty: visitElements(node, epiPartyElements<Invoice>, inv, store, epiSection); break;
+            case EpiBfi: visitElements(node, epiBfiElements<Invoice>, inv, store); break;
+            case EpiBeneficiary: visitElements(node, epiBeneficiaryElements<Invoice>, inv, store, epiSection); break;
+            case EpiPayment: visitElements(node, epiPaymentElements<Invoice>, inv, store, epiSection); break;
+            case EpiBeiValue:
+                epiBei = node.value();
+                hasEpiBei = true;
+                break;
+            case CurrencyAmount:
+                store.set(inv.EpiInstructedAmountCurrencyIdentifier, node.attribute("AmountCurrencyIdentifier"));
+                store.assign(inv.EpiInstructedAmount, node);
+                break;
+        }
+    };
+
+    visitElements(root, rootElements<Invoice>, inv, store, [&](const auto& entry, Element& node, bool first) {
+        if (entry.tag == Row) {
+            InvoiceRow row;
+            visitElements(node, rowElements<InvoiceRow>, row, store, [&](const auto& e, Element& child, bool first) {
+                if (!first) return;
+                if (e.tag == CurrencyAmount) {
+                    store.set(row.AmountCurrencyIdentifier, child.attribute("AmountCurrencyIdentifier"));
+                    store.assign(row.*e.member, child);
+                } else if (e.tag == SubRow) {
+                    visitElements(child, subRowElements<InvoiceRow>, row, store);
                 }
-
-                if (auto y = row->first_node("RowVatIncludedAmount")) invoiceRow.RowVatIncludedAmount = y->value();
-                if (auto z = row->first_node("RowDiscountPercent")) invoiceRow.RowDiscountPercent = z->value();
-                if (auto aa = row->first_node("RowDiscountAmount")) invoiceRow.RowDiscountAmount = aa->value();
-                if (auto ab = row->first_node("RowUnitCode")) invoiceRow.RowUnitCode = ab->value();
-                if (auto ac = row->first_node("RowDescription")) invoiceRow.RowDescription = ac->value();
-                if (auto ad = row->first_node("RowOrderLineReference")) invoiceRow.RowOrderLineReference = ad->value();
-                if (auto ae = row->first_node("RowDeliveryDate")) invoiceRow.RowDeliveryDate = ae->value();
-                if (auto af = row->first_node("RowBuyerArticleIdentifier")) invoiceRow.RowBuyerArticleIdentifier = af->value();
-                if (auto ag = row->first_node("RowSellerArticleIdentifier")) invoiceRow.RowSellerArticleIdentifier = ag->value();
-                if (auto ah = row->first_node("RowCommentText")) invoiceRow.RowCommentText = ah->value();
-                // Add more fields as needed from the Finvoice 3.0 standard
-
-                rows.push_back(invoiceRow);
+            });
+            if (rowConsumer) {
+                rowConsumer(std::move(row));
+            } else {
+                inv.rows.push_back(std::move(row));
             }
+            return;
         }
-        
-        // ...parse all other Finvoice fields
-        if(EpiBei.empty()) {
-            EpiBei = seller.SellerOrganisationTaxCode;
+        if (entry.tag == Attachment) {
+            FinvoiceAttachment attachment;
+            visitElements(node, attachmentElements, attachment, store, [&](const auto&, Element& content, bool first) {
+                if (!first) return;
+                if (attachmentSink) {
+                    content.content([&](std::string_view base64) { attachmentSink(attachment, base64); });
+                } else {
+                    content.content([&](std::string_view base64) { attachment.AttachmentContent.append(base64); });
+                }
+            });
+            inv.attachments.push_back(std::move(attachment));
+            return;
         }
-        //fix 
-        std::string sellerCountryCode = seller.SellerCountryCode;
-        if(sellerCountryCode == ""){
-            sellerCountryCode = getFirstTwoChars(EpiBei);
-            seller.SellerCountryCode= sellerCountryCode;
+        if (!first) return;
+        switch (entry.tag) {
+            case TransmissionDetails:
+                visitElements(node, transmissionElements<Seller>, seller, store, [&](const auto&, Element& msd, bool first) {
+                    if (first) visitElements(msd, senderElements<Seller>, seller, store);
+                });
+                break;
+            case Details:
+                visitElements(node, detailsElements<Invoice>, inv, store, [&](const auto& e, Element& child, bool first) {
+                    if (e.tag == FreeText) {
+                        store.appendFreeText(inv.*e.member, child);
+                    } else if (first) {
+                        visitElements(child, paymentTermsElements<Invoice>, inv, store, [&](const auto& pe, Element& text, bool) {
+                            store.appendFreeText(inv.*pe.member, text);
+                        });
+                    }
+                });
+                break;
+            case SellerParty: {
+                Seller postal;
+                uint64_t postalSeen = 0;
+                visitElements(node, sellerElements<Seller>, seller, store, [&](const auto& e, Element& child, bool first) {
+                    if (!first) return;
+                    if (e.tag == PostalAddress) {
+                        postalSeen = visitElements(child, sellerPostalElements<Seller>, postal, store);
+                    } else {
+                        visitElements(child, sellerVatElements<Seller>, seller, store);
+                    }
+                });
+                // the postal address is used when there is no plain street name
+                if (seller.SellerStreetName == "") {
+                    moveSeen(sellerPostalElements<Seller>, postalSeen, postal, seller);
+                }
+                break;
+            }
+            case SellerUnitNumber:
+                store.assign(seller.SellerOrganisationUnitNumber, node);
+                break;
+            case SellerInformation:
+                infoSeen = visitElements(node, sellerInformationElements<Seller>, info, store, [&](const auto&, Element& account, bool first) {
+                    if (first) visitElements(account, sellerAccountElements<Seller>, seller, store);
+                });
+                break;
+            case BuyerParty:
+                visitElements(node, buyerElements<Buyer>, inv.buyer, store, [&](const auto& e, Element& child, bool first) {
+                    if (!first) return;
+                    if (e.tag == AccountDetails) {
+                        visitElements(child, buyerAccountElements<Buyer>, inv.buyer, store);
+                    } else {
+                        visitElements(child, buyerVatElements<Buyer>, inv.buyer, store);
+                    }
+                });
+                break;
+            case BuyerUnitNumber:
+                store.assign(inv.buyer.BuyerOrganisationUnitNumber, node);
+                break;
+            case Epi:
+                visitElements(node, epiElements<Invoice>, inv, store, epiSection);
+                break;
         }
-        std::string sellerCountryName =seller.SellerCountryName;
-        if(sellerCountryName == "") {
-            sellerCountryName = getCountryNameForCode(sellerCountryCode);
-            seller.SellerCountryName=sellerCountryName;
+    });
+
+    // SellerInformationDetails only fills in what SellerPartyDetails left empty
+    const auto& infoElements = sellerInformationElements<Seller>;
+    for (size_t i = 0; i < infoElements.size(); ++i) {
+        auto member = infoElements[i].member;
+        if (member && (infoSeen & (uint64_t(1) << i)) && seller.*member == "") {
+            seller.*member = std::move(info.*member);
         }
+    }
+    // formatted once the seller country is known
+    if (hasEpiBei) {
+        store.set(inv.EpiBei, formatTaxCode(seller, epiBei));
+    }
+    // Add more fields as needed from the Finvoice 3.0 standard
+    // ...parse all other Finvoice fields
+    if(inv.EpiBei.empty()) {
+        inv.EpiBei = seller.SellerOrganisationTaxCode;
+    }
+    //fix 
+    std::string sellerCountryCode(seller.SellerCountryCode);
+    if(sellerCountryCode == ""){
+        sellerCountryCode = getFirstTwoChars(std::string(inv.EpiBei));
+        store.set(seller.SellerCountryCode, sellerCountryCode);
+    }
+    std::string sellerCountryName(seller.SellerCountryName);
+    if(sellerCountryName == "") {
+        sellerCountryName = getCountryNameForCode(sellerCountryCode);
+        store.set(seller.SellerCountryName, sellerCountryName);
+    }
+}
+
+template <typename Invoice>
+bool parseDocument(Invoice& inv, std::string_view xml, TextStore& store, const typename Invoice::RowConsumer& rowConsumer,
+                   const typename Invoice::AttachmentContentSink& attachmentSink) {
+    XmlReader reader(xml);
+    try {
+        XmlReader::StartTag tag;
+        reader.root(tag);
+        if (tag.name != "Finvoice") return false;
+        StreamElement element(reader, tag);
+        parseFinvoice(inv, element, store, rowConsumer, attachmentSink);
         return true;
     } catch (...) {
         return false;
     }
 }
-std::string FinvoiceInvoice::getXmlMessageTransmissionDetails() {
-    return formattedString(R"(<MessageTransmissionDetails>
-	<MessageSenderDetails>
-		<FromIdentifier SchemeID="0037">%s</FromIdentifier>
-		<FromIntermediator>%s</FromIntermediator>
-	</MessageSenderDetails>
-	<MessageReceiverDetails>
-		<ToIdentifier SchemeID="0037">%s</ToIdentifier>
-		<ToIntermediator>%s</ToIntermediator>
-	</MessageReceiverDetails>
-    <MessageDetails>
-      <MessageIdentifier>M2O0002%s</MessageIdentifier>
-      <MessageTimeStamp>%s</MessageTimeStamp>
-    </MessageDetails>
-  </MessageTransmissionDetails>)",
-    seller.SellerOVT.c_str(),
-    seller.SellerIntermediator.c_str(),
-    buyer.BuyerOVT.c_str(),
-    buyer.BuyerIntermediator.c_str(),
-    messageId.c_str(),
-    getTimestamp("").c_str()
-    );
-}
-std::string FinvoiceInvoice::getXmlSellerPartyDetails() {
-    return formattedString(R"(<SellerPartyDetails>
-    <SellerPartyIdentifier>%s</SellerPartyIdentifier>
-    <SellerOrganisationName>%s</SellerOrganisationName>
-    <SellerOrganisationTaxCode>%s</SellerOrganisationTaxCode>
-    <SellerPostalAddressDetails>
-      <SellerStreetName>%s</SellerStreetName>
-      <SellerTownName>%s</SellerTownName>
-      <SellerPostCodeIdentifier>%s</SellerPostCodeIdentifier>
-    </SellerPostalAddressDetails>
-  </SellerPartyDetails>)",
-    seller.SellerOrganisationTaxCode.c_str(),
-    seller.SellerOrganisationName.c_str(),
-    seller.SellerOrganisationTaxCode.c_str(),
-    seller.SellerStreetName.c_str(),
-    seller.SellerTownName.c_str(),
-    seller.SellerPostCodeIdentifier.c_str()
-);
-}
-std::string FinvoiceInvoice::getXmlSellerComdetails() {
-    
-    return formattedString(R"(<SellerContactPersonName>%s</SellerContactPersonName>
-  <SellerCommunicationDetails>
-    <SellerPhoneNumberIdentifier>%s</SellerPhoneNumberIdentifier>
-    <SellerEmailaddressIdentifier>%s</SellerEmailaddressIdentifier>
-  </SellerCommunicationDetails>)",
-    
-    seller.SellerContactPersonName.c_str(),
-    seller.SellerPhoneNumberIdentifier.c_str(),
-    seller.SellerEmailaddressIdentifier.c_str()
-    );
-}
-std::string FinvoiceInvoice::getXmlSellerInformationDetails() {
-    std::string selleraccountid = seller.SellerAccountID;
-    string_replaceall(selleraccountid, " ", "");
-    return formattedString(R"(<SellerInformationDetails>
-    <SellerCommonEmailaddressIdentifier>%s</SellerCommonEmailaddressIdentifier>
-    <SellerAccountDetails>
-      <SellerAccountID IdentificationSchemeName="IBAN">%s</SellerAccountID>
-      <SellerBic IdentificationSchemeName="BIC">%s</SellerBic>
-      <SellerAccountName>%s</SellerAccountName>
-    </SellerAccountDetails>
-  </SellerInformationDetails>)",
-    
-  seller.SellerEmailaddressIdentifier.c_str(),
-  selleraccountid.c_str(),
-  seller.SellerBic.c_str(),
-  seller.SellerAccountName.c_str()
-    );
+// rapidxml parses in place: the downloaded buffer is taken over and
+// terminated/unescaped where it is, node values point into it until
+// they are assigned to the fields
+template <typename Invoice>
+bool parseDocument(Invoice& inv, std::string&& xml, TextStore& store, const typename Invoice::RowConsumer& rowConsumer,
+                   const typename Invoice::AttachmentContentSink& attachmentSink) {
+    std::string buffer = std::move(xml);
+    if (buffer.size() >= FinvoiceInvoice::streamingParseThreshold) {
+        return parseDocument(inv, std::string_view(buffer), store, rowConsumer, attachmentSink);
+    }
+    using namespace rapidxml;
+    xml_document<> doc;
+    try {
+        doc.parse<parse_no_data_nodes>(buffer.data());
+        xml_node<>* root = doc.first_node("Finvoice");
+        if (!root) return false;
+        DomElement element(root);
+        parseFinvoice(inv, element, store, rowConsumer, attachmentSink);
+        return true;
+    } catch (...) {
+        return false;
+    }
 }
-std::string FinvoiceInvoice::getXmlBuyerPartyDetails() {
-    return formattedString(R"(<BuyerPartyDetails>
-    <BuyerPartyIdentifier>%s</BuyerPartyIdentifier>
-    <BuyerOrganisationName>%s</BuyerOrganisationName>
-    <BuyerOrganisationTaxCode>%s</BuyerOrganisationTaxCode>
-    <BuyerPostalAddressDetails>
-      <BuyerStreetName>%s</BuyerStreetName>
-      <BuyerTownName>%s</BuyerTownName>
-      <BuyerPostCodeIdentifier>%s</BuyerPostCodeIdentifier>
-    </BuyerPostalAddressDetails>
-  </BuyerPartyDetails>
-  <BuyerOrganisationUnitNumber/>
-  <BuyerContactPersonName/>)",
-    buyer.BuyerOrganisationTaxCode.c_str(),
-    buyer.BuyerOrganisationName.c_str(),
-    buyer.BuyerOrganisationTaxCode.c_str(),
-    buyer.BuyerStreetName.c_str(),
-    buyer.BuyerTownName.c_str(),
-    buyer.BuyerPostCodeIdentifier.c_str()
-    );
 }
-std::string FinvoiceInvoice::getXmlDeliveryDetails() {
-    return formattedString(R"(<DeliveryDetails>
-    <DeliveryDate Format="CCYYMMDD">%s</DeliveryDate>
-  </DeliveryDetails>)",
-        getTimestamp("YYYYMMDD").c_str()
-    );
+
+bool FinvoiceInvoice::parseFromXml(const std::string& xml) {
+    return parseFromXml(std::string(xml));
 }
-std::string FinvoiceInvoice::getXmlInvoiceDetails() {
-    //<SellersBuyerIdentifier>1001</SellersBuyerIdentifier>
-    return formattedString(R"(<InvoiceDetails>
-    <InvoiceTypeCode>INV01</InvoiceTypeCode>
-    <InvoiceTypeText>INVOICE</InvoiceTypeText>
-    <OriginCode>Original</OriginCode>
-    <InvoiceNumber>%s</InvoiceNumber>
-    <InvoiceDate Format="CCYYMMDD">%s</InvoiceDate>
-    <OrderIdentifier>%s</OrderIdentifier>
-    <AgreementIdentifier></AgreementIdentifier>
-    <BuyerReferenceIdentifier>%s</BuyerReferenceIdentifier>
-    <InvoiceTotalVatExcludedAmount AmountCurrencyIdentifier="EUR">%s</InvoiceTotalVatExcludedAmount>
-    <InvoiceTotalVatAmount AmountCurrencyIdentifier="EUR">%s</InvoiceTotalVatAmount>
-    <InvoiceTotalVatIncludedAmount AmountCurrencyIdentifier="EUR">%s</InvoiceTotalVatIncludedAmount>
-    <VatSpecificationDetails/>
-    <PaymentTermsDetails>
-      <PaymentTermsFreeText/>
-      <InvoiceDueDate Format="CCYYMMDD">%s</InvoiceDueDate>
-      <PaymentOverDueFineDetails>
-        <PaymentOverDueFineFreeText>%s</PaymentOverDueFineFreeText>
-        <PaymentOverDueFinePercent>%s</PaymentOverDueFinePercent>
-      </PaymentOverDueFineDetails>
-    </PaymentTermsDetails>
-  </InvoiceDetails>)",
-    InvoiceNumber.c_str(),
-    getTimestamp("YYYYMMDD").c_str(),
-    OrderIdentifier.c_str(),
-    BuyerReferenceIdentifier.c_str(),
-    InvoiceTotalVatExcludedAmount.c_str(),
-    InvoiceTotalVatAmount.c_str(),
-    InvoiceTotalVatIncludedAmount.c_str(),
-    InvoiceDueDate.c_str(),
-    PaymentOverDueFineFreeText.c_str(),
-    PaymentOverDueFinePercent.c_str()   
-    );
+bool FinvoiceInvoice::parseFromXml(std::string&& xml, const RowConsumer& rowConsumer, const AttachmentContentSink& attachmentSink) {
+    TextStore store;
+    return parseDocument(*this, std::move(xml), store, rowConsumer, attachmentSink);
 }
-std::string FinvoiceInvoice::getXmlFactoringAgreementDetails() {
-    return "";
-    /*TODO factoring
-    return formattedString(R"(<FactoringAgreementDetails>
-    <FactoringAgreementIdentifier>011</FactoringAgreementIdentifier>
-    <TransmissionListIdentifier>1</TransmissionListIdentifier>
-    <EndorsementClauseCode>F</EndorsementClauseCode>
-    <FactoringFreeText>Tämä laskusaatava on siirretty Noja Rahoitus Oy:lle ja voidaan pätevä</FactoringFreeText>
-    <FactoringFreeText>sti maksaa vain tilille:&#13;</FactoringFreeText>
-    <FactoringFreeText>BIC: NDEAFIHH IBAN: FI67 1733 3000 0145 69&#13;</FactoringFreeText>
-    <FactoringPartyIdentifier>2597279-7</FactoringPartyIdentifier>
-    <FactoringPartyName>Noja Rahoitus Oy</FactoringPartyName>
-    <FactoringPartyPostalAddressDetails>
-      <FactoringPartyStreetName>Aurakatu 12 b</FactoringPartyStreetName>
-      <FactoringPartyTownName>Turku</FactoringPartyTownName>
-      <FactoringPartyPostCodeIdentifier>20100</FactoringPartyPostCodeIdentifier>
-    </FactoringPartyPostalAddressDetails>
-  </FactoringAgreementDetails>)");
-  */
+bool FinvoiceInvoice::parseFromXmlStream(std::string_view xml, const RowConsumer& rowConsumer, const AttachmentContentSink& attachmentSink) {
+    TextStore store;
+    return parseDocument(*this, xml, store, rowConsumer, attachmentSink);
 }
-std::string FinvoiceInvoice::getXmlInvoiceRows() {
-    std::string rows_xml;
-    for (const auto& row : rows) {
-        rows_xml += formattedString(R"(<InvoiceRow>
-    <ArticleIdentifier>%s</ArticleIdentifier>
-    <ArticleName>%s</ArticleName>
-    <DeliveredQuantity QuantityUnitCode="kpl">%s</DeliveredQuantity>
-    <InvoicedQuantity QuantityUnitCode="kpl">%s</InvoicedQuantity>
-    <UnitPriceAmount AmountCurrencyIdentifier="EUR">%s</UnitPriceAmount>
-    <RowPositionIdentifier/>
-    <RowProposedAccountText/>
-    <RowFreeText>%s</RowFreeText>
-    <RowVatRatePercent>%s</RowVatRatePercent>
-    <RowVatAmount AmountCurrencyIdentifier="EUR">%s</RowVatAmount>
-    <RowVatExcludedAmount AmountCurrencyIdentifier="EUR">%s</RowVatExcludedAmount>
-  </InvoiceRow>)",
-    row.ArticleIdentifier.c_str(),
-    row.ArticleName.c_str(),
-    row.DeliveredQuantity.c_str(),
-    row.InvoicedQuantity.c_str(),
-        row.UnitPriceAmount.c_str(),
-        row.RowFreeText.c_str(),
-        row.RowVatRatePercent.c_str(),
-        row.RowVatAmount.c_str(),
-        row.RowVatExcludedAmount.c_str()
-        );
-        
-    }
-    return rows_xml;
+
+std::string_view ArenaFinvoiceInvoice::store(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    char* p = static_cast<char*>(arena.allocate(text.size(), 1));
+    std::memcpy(p, text.data(), text.size());
+    return std::string_view(p, text.size());
 }
-std::string FinvoiceInvoice::getXmlEpiDetails() {
-    return formattedString(R"(<EpiDetails>
-    <EpiIdentificationDetails>
-      <EpiDate Format="CCYYMMDD">%s</EpiDate>
-      <EpiReference/>
-    </EpiIdentificationDetails>
-    <EpiPartyDetails>
-      <EpiBfiPartyDetails>
-        <EpiBfiIdentifier IdentificationSchemeName="BIC">%s</EpiBfiIdentifier>
-      </EpiBfiPartyDetails>
-      <EpiBeneficiaryPartyDetails>
-        <EpiNameAddressDetails>%s</EpiNameAddressDetails>
-        <EpiAccountID IdentificationSchemeName="IBAN">%s</EpiAccountID>
-      </EpiBeneficiaryPartyDetails>
-    </EpiPartyDetails>
-    <EpiPaymentInstructionDetails>
-      <EpiRemittanceInfoIdentifier IdentificationSchemeName="SPY">%s</EpiRemittanceInfoIdentifier>
-      <EpiInstructedAmount AmountCurrencyIdentifier="EUR">%s</EpiInstructedAmount>
-      <EpiCharge ChargeOption="SLEV"/>
-      <EpiDateOptionDate Format="CCYYMMDD">%s</EpiDateOptionDate>
-    </EpiPaymentInstructionDetails>
-  </EpiDetails>)",
-    EpiDate.c_str(),
-    EpiBfiIdentifier.c_str(),
-    EpiNameAddressDetails.c_str(),
-    EpiAccountID.c_str(),
-    EpiRemittanceInfoIdentifier.c_str(),
-    EpiInstructedAmount.c_str(),
-    EpiDateOptionDate.c_str());
+bool ArenaFinvoiceInvoice::parseFromXml(std::string&& xml, const RowConsumer& rowConsumer, const AttachmentContentSink& attachmentSink) {
+    TextStore store(this);
+    return parseDocument(*this, std::move(xml), store, rowConsumer, attachmentSink);
 }
-std::string FinvoiceInvoice::getXmlAttachmentsDetails(std::vector<FinvoiceAttachment> &attachments) {
-    if(attachments.size()==0)  {
-        return "";
-    }
-    std::string attachments_xml="<AttachmentMessageDetails>";
-    
-    /*
-    for(int i=0; i<attachments.size(); i++) {
-        const auto& attachment = attachments[i];
-        attachments_xml += formattedString(R"(
-            <AttachmentMessageIdentifier>ATTM2O0002%s::attachments</AttachmentMessageIdentifier>
-)",
-        messageId.c_str()
-        );
-    }
-        */
-
-    attachments_xml += formattedString(R"(
-        <AttachmentMessageIdentifier>ATTM2O0002%s::attachments</AttachmentMessageIdentifier>
-)",
-    messageId.c_str()
-    );
-    attachments_xml +="</AttachmentMessageDetails>";
-    return attachments_xml;
+bool ArenaFinvoiceInvoice::parseFromXmlStream(std::string_view xml, const RowConsumer& rowConsumer, const AttachmentContentSink& attachmentSink) {
+    TextStore store(this);
+    return parseDocument(*this, xml, store, rowConsumer, attachmentSink);
 }
-std::string FinvoiceInvoice::getXmlAttachmentMessageTransmissionDetails(std::vector<FinvoiceAttachment> &attachments) {
-    /*RefToMessageIdentifier contains the identifier (MessageId) of the invoice
-    message that is linked to the attachment message.
-    */
-    std::string xml=formattedString(R"(<MessageTransmissionDetails>
-	<MessageSenderDetails>
-		<FromIdentifier SchemeID="0037">%s</FromIdentifier>
-		<FromIntermediator>%s</FromIntermediator>
-	</MessageSenderDetails>
-	<MessageReceiverDetails>
-		<ToIdentifier SchemeID="0037">%s</ToIdentifier>
-		<ToIntermediator>%s</ToIntermediator>
-	</MessageReceiverDetails>
-        <MessageDetails>
-            <MessageIdentifier>ATTM2O0002%s::attachments</MessageIdentifier>
-            <MessageTimeStamp>%s</MessageTimeStamp>
-            <RefToMessageIdentifier>M2O0002%s</RefToMessageIdentifier>
-        </MessageDetails>
-    </MessageTransmissionDetails>)",
-    seller.SellerOVT.c_str(),
-    seller.SellerIntermediator.c_str(),
-    buyer.BuyerOVT.c_str(),
-    buyer.BuyerIntermediator.c_str(),
-    messageId.c_str(),
-    getTimestamp("").c_str(),
-    messageId.c_str()
-    );
+std::string ArenaFinvoiceInvoice::getXmlFinvoiceMessage() {
+    std::string xml;
+    FinvoiceWriter(xml).finvoiceMessage(*this);
     return xml;
 }
-std::string calculate_sha1(std::string input){
-    unsigned char hash[SHA_DIGEST_LENGTH];
-    SHA1(reinterpret_cast<const unsigned char*>(input.c_str()), input.size(), hash);
-    std::stringstream ss;
-    for(int i = 0; i < SHA_DIGEST_LENGTH; i++) {
-        ss << std::hex << std::setw(2) << std::setfill('0') << (int)hash[i];
-    }
-    return ss.str();
+std::string ArenaFinvoiceInvoice::getXmlFinvoiceEnvelopeHeader() {
+    std::string soap;
+    FinvoiceWriter(soap).envelope(*this);
+    return soap;
 }
-std::string FinvoiceInvoice::getXmlAttachmentDetails(std::vector<FinvoiceAttachment> &attachments) {
-    std::string attachment_details_xml;
-    for(int i=0; i<attachments.size(); i++) {
-        const auto& attachment = attachments[i];
-        std::string sha1 = calculate_sha1(attachment.AttachmentContent);
-        
-        //YV1199015::attachments::
-        attachment_details_xml += formattedString(R"(<AttachmentDetails>
-        <AttachmentIdentifier>ATTM2O0002%s::attachments::%s</AttachmentIdentifier>
-        <AttachmentContent>%s</AttachmentContent>
-        <AttachmentName>%s</AttachmentName>
-        <AttachmentMimeType>%s</AttachmentMimeType>
-        <AttachmentSecureHash>%s</AttachmentSecureHash>
-    </AttachmentDetails>)",
-            messageId.c_str(),
-            sha1.c_str(),
-            attachment.AttachmentContent.c_str(),
-            attachment.AttachmentName.c_str(),  
-            attachment.AttachmentMimeType.c_str(),
-            sha1.c_str()
-                );
-    }
-    LOG(INFO) << "Attachment details xml: " << attachment_details_xml;
-    return attachment_details_xml;
+Decimal setRowVatAmounts(InvoiceRow &row, Decimal vatExcluded, Decimal vatRatePercent) {
+    Decimal vat = vatRatePercent > Decimal() ? vatExcluded.percent(vatRatePercent) : Decimal();
+    row.RowVatRatePercent = string_fmt_money(vatRatePercent);
+    row.RowVatAmount = vatRatePercent > Decimal() ? string_fmt_money(vat) : "0";
+    row.RowVatExcludedAmount = string_fmt_money(vatExcluded);
+    row.RowVatIncludedAmount = string_fmt_money(vatExcluded + vat);
+    return vatExcluded + vat;
 }
-std::string FinvoiceInvoice::getXmlAttachmentMessage(std::vector<FinvoiceAttachment> &attachments, bool includetransmissiondetails) {
-
-    if(attachments.size()==0)  {
-        return "";
-    }
-    if(includetransmissiondetails == false){
-        std::string attachment_xml=formattedString(R"(<FinvoiceAttachments xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance" xsi:noNamespaceSchemaLocation="FinvoiceAttachments.xsd" Version="1.0">
-    %s
-</FinvoiceAttachments>)",
-        getXmlAttachmentDetails(attachments).c_str()
-        );
-        return attachment_xml;
-
+const std::string &FinvoiceAttachment::secureHash(SecureHash::Algorithm algorithm) const {
+    if (contentHash.empty() || contentHashAlgorithm != algorithm) {
+        ::AttachmentContent::View content = AttachmentContent.view();
+        if (!content.ok()) {
+            // not kept, the hash of what could not be read means nothing
+            static const std::string none;
+            return none;
+        }
+        SecureHash hash(algorithm);
+        hash.update(content.data(), content.size());
+        contentHash = hash.hexDigest();
+        contentHashAlgorithm = algorithm;
     }
-    std::string attachment_xml=formattedString(R"(<?xml version="1.0" encoding="ISO-8859-15"?>
-<FinvoiceAttachments xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance" xsi:noNamespaceSchemaLocation="FinvoiceAttachments.xsd" Version="1.0">
-    %s
-    %s
-</FinvoiceAttachments>)",
-    getXmlAttachmentMessageTransmissionDetails(attachments).c_str(),
-    getXmlAttachmentDetails(attachments).c_str()
-    );
-    return attachment_xml;
+    return contentHash;
 }
-std::string FinvoiceInvoice::getXmlFinvoiceMessage(std::vector<FinvoiceAttachment> &attachments) {
-   std::string invoice_xml=formattedString(R"(<?xml version="1.0" encoding="ISO-8859-15"?>
-<?xml-stylesheet type="text/xsl" href="Finvoice.xsl"?>
-<Finvoice xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance" xsi:noNamespaceSchemaLocation="Finvoice3.0.xsd" Version="3.0">
-  %s
-  %s
-  %s
-  %s
-  %s
-  %s
-  %s
-  %s
-  %s
-  %s
-</Finvoice>   
-)",
-    getXmlMessageTransmissionDetails().c_str(),
-    getXmlSellerPartyDetails().c_str(),
-    getXmlSellerComdetails().c_str(),
-    getXmlSellerInformationDetails().c_str(),
-    getXmlBuyerPartyDetails().c_str(),
-    getXmlDeliveryDetails().c_str(),
-    getXmlInvoiceDetails().c_str(),
-    getXmlFactoringAgreementDetails().c_str(),
-    getXmlInvoiceRows().c_str(),
-    getXmlEpiDetails().c_str()
-    //getXmlAttachmentsDetails(attachments).c_str()
-    //getXmlAttachmentMessage(attachments, false).c_str()
-);
-
-    //WriteFileContent("/tmp/finvoice.xml", invoice_xml, true);
-   return invoice_xml;
+std::string FinvoiceInvoice::getXmlAttachmentMessage(std::vector<FinvoiceAttachment> &attachments, bool includetransmissiondetails) {
+    std::string xml;
+    FinvoiceWriter(xml).attachmentMessage(*this, attachments, includetransmissiondetails);
+    return xml;
+}
+std::string FinvoiceInvoice::getXmlFinvoiceMessage(std::vector<FinvoiceAttachment> & /*attachments: in the attachment message*/) {
+    std::string xml;
+    FinvoiceWriter(xml).finvoiceMessage(*this);
+    //WriteFileContent("/tmp/finvoice.xml", xml, true);
+    return xml;
 }
-
 std::string FinvoiceInvoice::getXmlFinvoiceEnvelopeHeader() {
-
-    std::string sb;
-    sb.append("<SOAP-ENV:Envelope xmlns:SOAP-ENV=\"http://schemas.xmlsoap.org/soap/envelope/\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" xmlns:eb=\"http://www.oasis-open.org/committees/ebxml-msg/schema/msg-header-2_0.xsd\">\n");
-    sb.append("<SOAP-ENV:Header>\n");
-    sb.append("<eb:MessageHeader xmlns:eb=\"http://www.oasis-open.org/committees/ebxml-msg/schema/msg-header-2_0.xsd\" SOAP-ENV:mustUnderstand=\"1\">\n");
-    sb.append("<eb:From>\n");
-    sb.append("<eb:PartyId>" + seller.SellerOVT+ "</eb:PartyId>\n"); //+*/OVT tunnus
-    sb.append("<eb:Role>Sender</eb:Role>\n");
-    sb.append("</eb:From>\n");
-    sb.append("<eb:From>\n");
-    sb.append("<eb:PartyId>" + seller.SellerIntermediator+ "</eb:PartyId>\n");
-    sb.append("<eb:Role>Intermediator</eb:Role>\n");
-    sb.append("</eb:From>\n");
-    sb.append("<eb:To>\n");
-    sb.append("<eb:PartyId>" + buyer.BuyerOVT+"</eb:PartyId>\n"); // FI1783093710005039
-    sb.append("<eb:Role>Receiver</eb:Role>\n");
-    sb.append("</eb:To>\n");
-    sb.append("<eb:To>\n");
-    sb.append("<eb:PartyId>" + buyer.BuyerIntermediator +"</eb:PartyId>\n"); // DABAFIHH
-    sb.append("<eb:Role>Intermediator</eb:Role>\n");
-    sb.append("</eb:To>\n");
-    sb.append("<eb:CPAId>yoursandmycpa</eb:CPAId>\n");
-    sb.append("<eb:ConversationId>1231235</eb:ConversationId>\n");
-    sb.append("<eb:Service>Routing</eb:Service>\n");
-    sb.append("<eb:Action>ProcessInvoice</eb:Action>\n");
-    sb.append("<eb:MessageData>\n");
-
-    sb.append("<eb:MessageId>M2O0002" + EpiRemittanceInfoIdentifier+"</eb:MessageId>\n");
-    sb.append("<eb:Timestamp>" + getTimestamp("") + "</eb:Timestamp>\n"); // 2017-09-11T09:13:26
-    sb.append("<eb:RefToMessageId/>\n");
-    sb.append("</eb:MessageData>\n");
-    sb.append("</eb:MessageHeader>\n");
-    sb.append("</SOAP-ENV:Header>\n");
-    sb.append("<SOAP-ENV:Body>\n");
-    sb.append("<eb:Manifest eb:id=\"Manifest\" eb:version=\"2.0\">\n");
-    sb.append("<eb:Reference eb:id=\"Finvoice\" xlink:href=\"" + EpiRemittanceInfoIdentifier+ "\">\n");
-    sb.append("<eb:Schema eb:location=\"http://www.finvoice.info/finvoice.xsd\" eb:version=\"2.0\"/>\n");
-    sb.append("</eb:Reference>\n");
-    sb.append("</eb:Manifest>\n");
-    sb.append("</SOAP-ENV:Body>\n");
-    sb.append("</SOAP-ENV:Envelope>\n");
-
-    return sb;
-}
\ No newline at end of file
+    std::string soap;
+    FinvoiceWriter(soap).envelope(*this);
+    return soap;
+}
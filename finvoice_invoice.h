@@ -20,152 +20,206 @@
  * IN THE SOFTWARE.
  */
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <functional>
+#include <memory_resource>
+#include "secure_hash.h"
+#include "attachment_store.h"
+#include "decimal.h"
 
-struct SellerPartyDetails {
-    std::string SellerOrganisationName;
-    std::string SellerOrganisationTaxCode;
-    std::string SellerOrganisationIdentifier;
-    std::string SellerDepartment;
-    std::string SellerStreetName;
-    std::string SellerTownName;
-    std::string SellerPostCodeIdentifier;
-    std::string SellerCountryCode;
-    std::string SellerCountryName;
-    std::string SellerPhoneNumberIdentifier;
-    std::string SellerEmailaddressIdentifier;
-    std::string SellerWebaddressIdentifier;
-    std::string SellerAccountID;
-    std::string SellerAccountName;
-    std::string SellerBic;
-    std::string SellerVatRegistrationId;
-    std::string SellerOrganisationUnitNumber;
-    std::string SellerOVT; ///OVT tunnus
-    std::string SellerIntermediator; //välittäjätunnus
-
-    std::string SellerContactPersonName;
+// The text fields of an invoice are of type String: std::string in
+// FinvoiceInvoice, std::string_view into the arena of the invoice in
+// ArenaFinvoiceInvoice.
+template <typename String>
+struct BasicSellerPartyDetails {
+    using string_type = String;
+    String SellerOrganisationName;
+    String SellerOrganisationTaxCode;
+    String SellerOrganisationIdentifier;
+    String SellerDepartment;
+    String SellerStreetName;
+    String SellerTownName;
+    String SellerPostCodeIdentifier;
+    String SellerCountryCode;
+    String SellerCountryName;
+    String SellerPhoneNumberIdentifier;
+    String SellerEmailaddressIdentifier;
+    String SellerWebaddressIdentifier;
+    String SellerAccountID;
+    String SellerAccountName;
+    String SellerBic;
+    String SellerVatRegistrationId;
+    String SellerOrganisationUnitNumber;
+    String SellerOVT; ///OVT tunnus
+    String SellerIntermediator; //välittäjätunnus
+
+    String SellerContactPersonName;
 
 };
 
-struct BuyerPartyDetails {
-    std::string BuyerOrganisationName;
-    std::string BuyerOrganisationTaxCode;
-    std::string BuyerPartyIdentifier; 
-    std::string BuyerOrganisationIdentifier;
-    std::string BuyerDepartment;
-    std::string BuyerStreetName;
-    std::string BuyerTownName;
-    std::string BuyerPostCodeIdentifier;
-    std::string BuyerCountryCode;
-    std::string BuyerPhoneNumberIdentifier;
-    std::string BuyerEmailaddressIdentifier;
-    std::string BuyerWebaddressIdentifier;
-    std::string BuyerAccountID;
-    std::string BuyerBic;
-    std::string BuyerVatRegistrationId;
-    std::string BuyerOrganisationUnitNumber;
-    std::string BuyerOVT; ///OVT tunnus
-    std::string BuyerIntermediator; //välittäjätunnus
+template <typename String>
+struct BasicBuyerPartyDetails {
+    using string_type = String;
+    String BuyerOrganisationName;
+    String BuyerOrganisationTaxCode;
+    String BuyerPartyIdentifier; 
+    String BuyerOrganisationIdentifier;
+    String BuyerDepartment;
+    String BuyerStreetName;
+    String BuyerTownName;
+    String BuyerPostCodeIdentifier;
+    String BuyerCountryCode;
+    String BuyerPhoneNumberIdentifier;
+    String BuyerEmailaddressIdentifier;
+    String BuyerWebaddressIdentifier;
+    String BuyerAccountID;
+    String BuyerBic;
+    String BuyerVatRegistrationId;
+    String BuyerOrganisationUnitNumber;
+    String BuyerOVT; ///OVT tunnus
+    String BuyerIntermediator; //välittäjätunnus
 };
 
-struct InvoiceRow {
-    std::string ArticleIdentifier;
-    std::string ArticleName;
-    std::string ArticleDescription;
-    std::string RowFreeText;
-    std::string SubRowFreeText;
-    std::string UnitPriceNetAmount;
-    std::string DeliveredQuantity;
-    std::string InvoicedQuantity;
-    std::string RowAmount;
-    std::string AmountCurrencyIdentifier;
-
-
-    std::string OrderedQuantity;
-    std::string UnitPriceAmount;
-    std::string RowVatRatePercent;
-    std::string RowVatAmount;
-    std::string RowVatExcludedAmount;
-    std::string RowVatIncludedAmount;
-    std::string RowDiscountPercent;
-    std::string RowDiscountAmount;
-    std::string RowUnitCode;
-    std::string RowDescription;
-    std::string RowOrderLineReference;
-    std::string RowDeliveryDate;
-    std::string RowBuyerArticleIdentifier;
-    std::string RowSellerArticleIdentifier;
-    std::string RowCommentText;
+template <typename String>
+struct BasicInvoiceRow {
+    using string_type = String;
+    String ArticleIdentifier;
+    String ArticleName;
+    String ArticleDescription;
+    String RowFreeText;
+    String SubRowFreeText;
+    String UnitPriceNetAmount;
+    String DeliveredQuantity;
+    String InvoicedQuantity;
+    String RowAmount;
+    String AmountCurrencyIdentifier;
+
+
+    String OrderedQuantity;
+    String UnitPriceAmount;
+    String RowVatRatePercent;
+    String RowVatAmount;
+    String RowVatExcludedAmount;
+    String RowVatIncludedAmount;
+    String RowDiscountPercent;
+    String RowDiscountAmount;
+    String RowUnitCode;
+    String RowDescription;
+    String RowOrderLineReference;
+    String RowDeliveryDate;
+    String RowBuyerArticleIdentifier;
+    String RowSellerArticleIdentifier;
+    String RowCommentText;
 };
+using SellerPartyDetails = BasicSellerPartyDetails<std::string>;
+using BuyerPartyDetails = BasicBuyerPartyDetails<std::string>;
+using InvoiceRow = BasicInvoiceRow<std::string>;
+
+// Sets the VAT fields of a row of vatExcluded at vatRatePercent (no VAT
+// unless above 0), returns the VAT included amount, exact to be summed
+Decimal setRowVatAmounts(InvoiceRow &row, Decimal vatExcluded, Decimal vatRatePercent);
+
 struct FinvoiceAttachment {
     std::string AttachmentName;
     std::string AttachmentMimeType;
-    std::string AttachmentContent;
+    ::AttachmentContent AttachmentContent; // base64, large content is spilled to disk
     int odooAttachmentId = 0; // id in odoo system
+
+    // Content left at its origin (a received attachment still on the
+    // operator's server), streamed where it is needed instead of being held
+    // in AttachmentContent, which stays empty. The source calls size once
+    // with the byte count, -1 if unknown, before handing the raw bytes to
+    // data piece by piece; data returns false to stop the transfer. True
+    // when all of the content was delivered.
+    using ContentSize = std::function<void (int64_t size)>;
+    using ContentData = std::function<bool (const char *data, size_t size)>;
+    std::function<bool (const ContentSize &size, const ContentData &data)> contentSource;
+
+    // Hex digest of the base64 AttachmentContent, hashed once in the life
+    // of the attachment: by a pass that reads the content anyway (zipping)
+    // or by the first secureHash(). Whoever replaces the content clears it.
+    mutable std::string contentHash;
+    mutable SecureHash::Algorithm contentHashAlgorithm = SecureHash::Sha1;
+    const std::string &secureHash(SecureHash::Algorithm algorithm = SecureHash::Sha1) const;
 };
-class FinvoiceInvoice {
-    std::string getXmlMessageTransmissionDetails();
-    std::string getXmlSellerPartyDetails();
-    std::string getXmlSellerComdetails();
-    std::string getXmlSellerInformationDetails();
-    std::string getXmlBuyerPartyDetails();
-    std::string getXmlDeliveryDetails();
-    std::string getXmlInvoiceDetails();
-    std::string getXmlFactoringAgreementDetails();
-    std::string getXmlInvoiceRows();
-    std::string getXmlEpiDetails();
-    std::string getXmlAttachmentsDetails(std::vector<FinvoiceAttachment> &attachments);
-    std::string getXmlAttachmentMessageTransmissionDetails(std::vector<FinvoiceAttachment> &attachments);
-    std::string getXmlAttachmentDetails(std::vector<FinvoiceAttachment> &attachments);
-public:
+// The fields of an invoice, common to both models
+template <typename String, typename RowAllocator = std::allocator<BasicInvoiceRow<String>>>
+struct BasicFinvoiceFields {
+    using string_type = String;
+    using Seller = BasicSellerPartyDetails<String>;
+    using Buyer = BasicBuyerPartyDetails<String>;
+    using Row = BasicInvoiceRow<String>;
+
+    BasicFinvoiceFields() = default;
+    explicit BasicFinvoiceFields(const RowAllocator &allocator) : rows(allocator) {}
+
     // InvoiceDetails fields
-    std::string messageId; // Unique message identifier for the invoice message (when sending)
-    std::string InvoiceNumber;
-    std::string InvoiceDate; //format: YYYYMMDD
-    std::string InvoiceTypeCode;
-    std::string OriginCode;
-    std::string InvoiceTypeText;
-    std::string InvoiceRecipientCode;
-    std::string InvoiceRecipientText;
-    std::string InvoiceRecipientLanguageCode;
-    std::string InvoiceCurrencyCode;
-    std::string InvoiceTotalVatExcludedAmount;
-    std::string InvoiceTotalVatAmount;
-    std::string InvoiceTotalVatIncludedAmount;
-    std::string RowsTotalVatExcludedAmount;
-    std::string InvoiceFreeText;
-    std::string PaymentTermsFreeText;
-    std::string PaymentOverDueFinePercent;
-    std::string PaymentOverDueFineFreeText;
-    std::string InvoiceDueDate;
-    std::string InvoiceUrlText;
-    std::string InvoiceUrlNameText;
-
-    std::string OrderIdentifier;
-    std::string BuyerReferenceIdentifier;
+    String messageId; // Unique message identifier for the invoice message (when sending)
+    String InvoiceNumber;
+    String InvoiceDate; //format: YYYYMMDD
+    String InvoiceTypeCode;
+    String OriginCode;
+    String InvoiceTypeText;
+    String InvoiceRecipientCode;
+    String InvoiceRecipientText;
+    String InvoiceRecipientLanguageCode;
+    String InvoiceCurrencyCode;
+    String InvoiceTotalVatExcludedAmount;
+    String InvoiceTotalVatAmount;
+    String InvoiceTotalVatIncludedAmount;
+    String RowsTotalVatExcludedAmount;
+    String InvoiceFreeText;
+    String PaymentTermsFreeText;
+    String PaymentOverDueFinePercent;
+    String PaymentOverDueFineFreeText;
+    String InvoiceDueDate;
+    String InvoiceUrlText;
+    String InvoiceUrlNameText;
+
+    String OrderIdentifier;
+    String BuyerReferenceIdentifier;
     
-    std::string EpiDate; //e.g. 20250814, format: YYYYMMDD
-    std::string EpiReference;
-    std::string EpiBfiIdentifier; //e.g DABAFIHH
-    std::string EpiNameAddressDetails; //eg. Elisa Oyj
-    std::string EpiBei; //Tax number
-    std::string EpiAccountID; //IBAN
-
-    std::string EpiRemittanceInfoIdentifier; //viitenumero
-    std::string EpiInstructedAmount;
-    std::string EpiDateOptionDate;
-    std::string EpiInstructedAmountCurrencyIdentifier; //e.g. EUR
-
-    std::string eio_invoice_identifier; // Unique identifier for the invoice in Maventa (einvoice operator invoice identifier)
-
-    SellerPartyDetails seller;
-    BuyerPartyDetails buyer;
-    std::vector<InvoiceRow> rows;
+    String EpiDate; //e.g. 20250814, format: YYYYMMDD
+    String EpiReference;
+    String EpiBfiIdentifier; //e.g DABAFIHH
+    String EpiNameAddressDetails; //eg. Elisa Oyj
+    String EpiBei; //Tax number
+    String EpiAccountID; //IBAN
+
+    String EpiRemittanceInfoIdentifier; //viitenumero
+    String EpiInstructedAmount;
+    String EpiDateOptionDate;
+    String EpiInstructedAmountCurrencyIdentifier; //e.g. EUR
+
+    String eio_invoice_identifier; // Unique identifier for the invoice in Maventa (einvoice operator invoice identifier)
+
+    Seller seller;
+    Buyer buyer;
+    std::vector<Row, RowAllocator> rows;
     std::vector<FinvoiceAttachment> attachments;
     // ... all other Finvoice fields
 
+    // Receivers for the bulky parts of a received invoice. Without them the
+    // rows and inline attachment content are kept in rows and attachments.
+    // The sink gets the base64 text piece by piece, before the name and
+    // mime type of the attachment, which come after it in the document.
+    using RowConsumer = std::function<void (Row &&row)>;
+    using AttachmentContentSink = std::function<void (FinvoiceAttachment &attachment, std::string_view base64)>;
+};
+
+class FinvoiceInvoice : public BasicFinvoiceFields<std::string> {
+public:
+    // Documents from this size on are read with the streaming parser, which
+    // keeps no tree of the document in memory
+    static constexpr size_t streamingParseThreshold = 1 << 20;
+
     bool parseFromXml(const std::string& xml);
+    // Parses in place, the buffer is consumed
+    bool parseFromXml(std::string&& xml, const RowConsumer &rowConsumer = nullptr, const AttachmentContentSink &attachmentSink = nullptr);
+    bool parseFromXmlStream(std::string_view xml, const RowConsumer &rowConsumer = nullptr, const AttachmentContentSink &attachmentSink = nullptr);
     void setEIOInvoiceIdentifier(const std::string& identifier) {
         eio_invoice_identifier = identifier;
     }
@@ -173,8 +227,48 @@ public:
         return eio_invoice_identifier;
     }
 
+    // Rendered by FinvoiceWriter, see finvoice_writer.h
     std::string getXmlFinvoiceMessage(std::vector<FinvoiceAttachment> &attachments);
     std::string getXmlAttachmentMessage(std::vector<FinvoiceAttachment> &attachments, bool includetransmissiondetails=true);
     std::string getXmlFinvoiceEnvelopeHeader();
 
-};
\ No newline at end of file
+};
+
+using ArenaInvoiceRow = BasicInvoiceRow<std::string_view>;
+
+namespace detail {
+// constructed before the fields, whose rows live in the arena
+struct InvoiceArena {
+    explicit InvoiceArena(size_t initialSize) : arena(initialSize) {}
+    std::pmr::monotonic_buffer_resource arena;
+};
+}
+
+// Invoice model for bulk processing. The text of every field lives in a
+// monotonic arena owned by the invoice and the rows are one array in it,
+// so that building an invoice costs a few block allocations instead of
+// one per field, and destroying it frees them all at once. The fields
+// are views into the arena: text from elsewhere goes in through store().
+// Attachments keep their own buffers, their content is too large for an
+// arena that is never reused.
+class ArenaFinvoiceInvoice : private detail::InvoiceArena,
+                             public BasicFinvoiceFields<std::string_view, std::pmr::polymorphic_allocator<ArenaInvoiceRow>> {
+public:
+    explicit ArenaFinvoiceInvoice(size_t initialSize = 16 * 1024)
+        : InvoiceArena(initialSize), BasicFinvoiceFields(&arena) {}
+    // the views point into this invoice's own arena
+    ArenaFinvoiceInvoice(const ArenaFinvoiceInvoice&) = delete;
+    ArenaFinvoiceInvoice& operator=(const ArenaFinvoiceInvoice&) = delete;
+
+    // Copies text into the arena
+    std::string_view store(std::string_view text);
+    std::pmr::memory_resource *resource() {
+        return &arena;
+    }
+
+    bool parseFromXml(std::string&& xml, const RowConsumer &rowConsumer = nullptr, const AttachmentContentSink &attachmentSink = nullptr);
+    bool parseFromXmlStream(std::string_view xml, const RowConsumer &rowConsumer = nullptr, const AttachmentContentSink &attachmentSink = nullptr);
+
+    std::string getXmlFinvoiceMessage();
+    std::string getXmlFinvoiceEnvelopeHeader();
+};
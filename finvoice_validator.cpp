@@ -0,0 +1,694 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "finvoice_validator.h"
+#include "element_table.h"
+#include "xml_reader.h"
+#include "charset.h"
+#include <cstdint>
+
+namespace {
+
+enum class Value : uint8_t {
+    Section,   // children checked against a table of their own
+    Any,       // content not checked
+    Text,
+    Amount,    // -1234,56 with AmountCurrencyIdentifier
+    Quantity,
+    Percent,
+    Date,      // CCYYMMDD with Format="CCYYMMDD"
+    Iban,      // checked when IdentificationSchemeName is IBAN or absent
+    Bic,
+    Reference, // Finnish reference number or RF creditor reference
+    TypeCode,  // INV01
+    Origin,    // Original, Copy, Cancel
+    Charge,    // EpiCharge ChargeOption
+};
+
+constexpr uint16_t Many = 0xFFFF;
+
+struct Section;
+struct Rule {
+    std::string_view name;
+    Value value = Value::Text;
+    uint16_t minOccurs = 0;
+    uint16_t maxOccurs = 1;
+    uint16_t minLength = 0;
+    uint16_t maxLength = 0; // 0: not limited
+    const Section *section = nullptr;
+};
+
+struct Section {
+    int (*find)(std::string_view name);
+    const Rule *rules;
+    size_t size;
+};
+template <const auto &Table>
+constexpr Section section() {
+    return {[](std::string_view name) { return Table.find(name); }, &Table[0], Table.size()};
+}
+
+constexpr Rule text(std::string_view name, uint16_t minOccurs, uint16_t maxOccurs, uint16_t minLength, uint16_t maxLength) {
+    return {name, Value::Text, minOccurs, maxOccurs, minLength, maxLength};
+}
+constexpr Rule value(std::string_view name, Value value, uint16_t minOccurs = 0, uint16_t maxOccurs = 1) {
+    return {name, value, minOccurs, maxOccurs};
+}
+constexpr Rule any(std::string_view name, uint16_t maxOccurs = 1) {
+    return {name, Value::Any, 0, maxOccurs};
+}
+constexpr Rule nested(std::string_view name, const Section &section, uint16_t minOccurs = 0, uint16_t maxOccurs = 1) {
+    return {name, Value::Section, minOccurs, maxOccurs, 0, 0, &section};
+}
+
+// Finvoice 3.0, the entries of each table in schema order. Sections the
+// writer does not produce are listed so that their place is known, their
+// content is not checked.
+constexpr auto senderRules = entryTable<Rule>({
+    text("FromIdentifier", 1, 1, 2, 35),
+    text("FromIntermediator", 0, 1, 2, 35),
+});
+constexpr Section senderSection = section<senderRules>();
+constexpr auto receiverRules = entryTable<Rule>({
+    text("ToIdentifier", 1, 1, 2, 35),
+    text("ToIntermediator", 0, 1, 2, 35),
+});
+constexpr Section receiverSection = section<receiverRules>();
+constexpr auto messageRules = entryTable<Rule>({
+    text("MessageIdentifier", 1, 1, 2, 48),
+    text("MessageTimeStamp", 1, 1, 1, 35),
+    text("RefToMessageIdentifier", 0, 1, 0, 48),
+    text("ImplementationCode", 0, 1, 0, 35),
+    text("SpecificationIdentifier", 0, 1, 0, 35),
+});
+constexpr Section messageSection = section<messageRules>();
+constexpr auto transmissionRules = entryTable<Rule>({
+    nested("MessageSenderDetails", senderSection, 1),
+    nested("MessageReceiverDetails", receiverSection, 1),
+    nested("MessageDetails", messageSection, 1),
+});
+constexpr Section transmissionSection = section<transmissionRules>();
+
+constexpr auto sellerPostalRules = entryTable<Rule>({
+    text("SellerStreetName", 1, 3, 2, 35),
+    text("SellerTownName", 1, 1, 2, 35),
+    text("SellerPostCodeIdentifier", 1, 1, 2, 9),
+    text("CountryCode", 0, 1, 2, 2),
+    text("CountryName", 0, 1, 0, 35),
+    text("SellerPostOfficeBoxIdentifier", 0, 1, 0, 35),
+});
+constexpr Section sellerPostalSection = section<sellerPostalRules>();
+constexpr auto sellerPartyRules = entryTable<Rule>({
+    text("SellerPartyIdentifier", 0, 1, 0, 35),
+    text("SellerPartyIdentifierUrlText", 0, 1, 0, 512),
+    text("SellerOrganisationName", 1, Many, 2, 70),
+    text("SellerOrganisationDepartment", 0, 2, 0, 35),
+    text("SellerOrganisationTaxCode", 0, 1, 0, 35),
+    text("SellerOrganisationTaxCodeUrlText", 0, 1, 0, 512),
+    text("SellerCode", 0, Many, 0, 35),
+    nested("SellerPostalAddressDetails", sellerPostalSection),
+});
+constexpr Section sellerPartySection = section<sellerPartyRules>();
+constexpr auto sellerCommunicationRules = entryTable<Rule>({
+    text("SellerPhoneNumberIdentifier", 0, 1, 0, 35),
+    text("SellerEmailaddressIdentifier", 0, 1, 0, 70),
+});
+constexpr Section sellerCommunicationSection = section<sellerCommunicationRules>();
+constexpr auto sellerAccountRules = entryTable<Rule>({
+    value("SellerAccountID", Value::Iban, 1),
+    value("SellerBic", Value::Bic, 1),
+    text("SellerAccountName", 0, 1, 0, 70),
+});
+constexpr Section sellerAccountSection = section<sellerAccountRules>();
+constexpr auto sellerInformationRules = entryTable<Rule>({
+    text("SellerHomeTownName", 0, 1, 0, 35),
+    text("SellerVatRegistrationText", 0, 1, 0, 35),
+    value("SellerVatRegistrationDate", Value::Date),
+    text("SellerTaxRegistrationText", 0, 1, 0, 35),
+    text("SellerPhoneNumber", 0, 1, 0, 35),
+    text("SellerFaxNumber", 0, 1, 0, 35),
+    text("SellerCommonEmailaddressIdentifier", 0, 1, 0, 70),
+    text("SellerWebaddressIdentifier", 0, 1, 0, 512),
+    text("SellerFreeText", 0, Many, 0, 512),
+    nested("SellerAccountDetails", sellerAccountSection, 0, Many),
+    any("SellerInvoiceDetails"),
+});
+constexpr Section sellerInformationSection = section<sellerInformationRules>();
+
+constexpr auto buyerPostalRules = entryTable<Rule>({
+    text("BuyerStreetName", 1, 3, 2, 35),
+    text("BuyerTownName", 1, 1, 2, 35),
+    text("BuyerPostCodeIdentifier", 1, 1, 2, 9),
+    text("CountryCode", 0, 1, 2, 2),
+    text("CountryName", 0, 1, 0, 35),
+    text("BuyerPostOfficeBoxIdentifier", 0, 1, 0, 35),
+});
+constexpr Section buyerPostalSection = section<buyerPostalRules>();
+constexpr auto buyerPartyRules = entryTable<Rule>({
+    text("BuyerPartyIdentifier", 0, 1, 0, 35),
+    text("BuyerOrganisationName", 1, Many, 2, 70),
+    text("BuyerOrganisationDepartment", 0, 2, 0, 35),
+    text("BuyerOrganisationTaxCode", 0, 1, 0, 35),
+    text("BuyerCode", 0, Many, 0, 35),
+    nested("BuyerPostalAddressDetails", buyerPostalSection),
+});
+constexpr Section buyerPartySection = section<buyerPartyRules>();
+
+constexpr auto vatSpecificationRules = entryTable<Rule>({
+    value("VatBaseAmount", Value::Amount),
+    value("VatRatePercent", Value::Percent),
+    text("VatCode", 0, 1, 0, 10),
+    value("VatRateAmount", Value::Amount),
+    text("VatFreeText", 0, Many, 0, 70),
+    text("VatExemptionReasonCode", 0, 1, 0, 35),
+});
+constexpr Section vatSpecificationSection = section<vatSpecificationRules>();
+constexpr auto overDueFineRules = entryTable<Rule>({
+    text("PaymentOverDueFineFreeText", 0, Many, 0, 70),
+    value("PaymentOverDueFinePercent", Value::Percent),
+    value("PaymentOverDueFixedAmount", Value::Amount),
+});
+constexpr Section overDueFineSection = section<overDueFineRules>();
+constexpr auto paymentTermsRules = entryTable<Rule>({
+    text("PaymentTermsFreeText", 0, Many, 0, 70),
+    value("InvoiceDueDate", Value::Date),
+    value("CashDiscountDate", Value::Date),
+    value("CashDiscountBaseAmount", Value::Amount),
+    value("CashDiscountPercent", Value::Percent),
+    value("CashDiscountAmount", Value::Amount),
+    value("CashDiscountExcludingVatAmount", Value::Amount),
+    any("CashDiscountVatDetails", Many),
+    value("ReducedInvoiceVatIncludedAmount", Value::Amount),
+    nested("PaymentOverDueFineDetails", overDueFineSection),
+});
+constexpr Section paymentTermsSection = section<paymentTermsRules>();
+constexpr auto invoiceDetailsRules = entryTable<Rule>({
+    value("InvoiceTypeCode", Value::TypeCode, 1),
+    text("InvoiceTypeCodeUN", 0, 1, 0, 3),
+    text("InvoiceTypeText", 1, 1, 1, 35),
+    value("OriginCode", Value::Origin, 1),
+    text("OriginalInvoiceNumber", 0, 1, 0, 20),
+    value("OriginalInvoiceDate", Value::Date),
+    value("OriginalDueDate", Value::Date),
+    text("OriginalInvoiceReference", 0, 1, 0, 35),
+    value("InvoicingPeriodStartDate", Value::Date),
+    value("InvoicingPeriodEndDate", Value::Date),
+    text("InvoiceNumber", 1, 1, 1, 20),
+    value("InvoiceDate", Value::Date, 1),
+    text("SellerReferenceIdentifier", 0, 1, 0, 70),
+    text("SellerReferenceIdentifierUrlText", 0, 1, 0, 512),
+    text("BuyersSellerIdentifier", 0, 1, 0, 35),
+    text("SellersBuyerIdentifier", 0, 1, 0, 35),
+    text("OrderIdentifier", 0, 1, 0, 70),
+    text("OrderIdentifierUrlText", 0, 1, 0, 512),
+    value("OrderDate", Value::Date),
+    text("OrdererName", 0, 1, 0, 70),
+    text("SalesPersonName", 0, 1, 0, 70),
+    text("OrderConfirmationIdentifier", 0, 1, 0, 70),
+    value("OrderConfirmationDate", Value::Date),
+    text("AgreementIdentifier", 0, 1, 0, 70),
+    text("AgreementIdentifierUrlText", 0, 1, 0, 512),
+    text("AgreementTypeText", 0, 1, 0, 35),
+    text("AgreementTypeCode", 0, 1, 0, 35),
+    value("AgreementDate", Value::Date),
+    text("NotificationIdentifier", 0, 1, 0, 35),
+    value("NotificationDate", Value::Date),
+    text("RegistrationNumberIdentifier", 0, 1, 0, 35),
+    text("ControllerIdentifier", 0, 1, 0, 35),
+    text("ControllerName", 0, 1, 0, 35),
+    value("ControlDate", Value::Date),
+    text("BuyerReferenceIdentifier", 0, 1, 0, 70),
+    text("ProjectReferenceIdentifier", 0, 1, 0, 70),
+    any("DefinitionDetails", Many),
+    value("RowsTotalVatExcludedAmount", Value::Amount),
+    value("InvoiceTotalVatExcludedAmount", Value::Amount),
+    value("InvoiceTotalVatAmount", Value::Amount),
+    value("InvoiceTotalVatIncludedAmount", Value::Amount, 1),
+    value("InvoiceTotalRoundoffAmount", Value::Amount),
+    nested("VatSpecificationDetails", vatSpecificationSection, 0, Many),
+    text("InvoiceFreeText", 0, Many, 0, 512),
+    text("InvoiceVatFreeText", 0, 1, 0, 70),
+    nested("PaymentTermsDetails", paymentTermsSection, 0, Many),
+    text("ShortProposedAccountIdentifier", 0, 1, 0, 4),
+    text("NormalProposedAccountIdentifier", 0, 1, 0, 35),
+    text("ProposedAccountText", 0, 1, 0, 35),
+    text("AccountDimensionText", 0, Many, 0, 35),
+    text("SellerAccountText", 0, 1, 0, 18),
+});
+constexpr Section invoiceDetailsSection = section<invoiceDetailsRules>();
+
+constexpr auto invoiceRowRules = entryTable<Rule>({
+    text("ArticleIdentifier", 0, 1, 0, 35),
+    text("ArticleGroupIdentifier", 0, Many, 0, 35),
+    text("ArticleName", 0, 1, 0, 100),
+    text("ArticleInfoUrlText", 0, 1, 0, 512),
+    text("BuyerArticleIdentifier", 0, 1, 0, 35),
+    text("EanCode", 0, 1, 0, 14),
+    text("RowRegistrationNumberIdentifier", 0, 1, 0, 35),
+    text("SerialNumberIdentifier", 0, 1, 0, 35),
+    text("RowActionCode", 0, 1, 0, 35),
+    any("RowDefinitionDetails", Many),
+    value("OfferedQuantity", Value::Quantity, 0, Many),
+    value("DeliveredQuantity", Value::Quantity, 0, Many),
+    value("OrderedQuantity", Value::Quantity, 0, Many),
+    value("ConfirmedQuantity", Value::Quantity, 0, Many),
+    value("PostDeliveredQuantity", Value::Quantity, 0, Many),
+    value("InvoicedQuantity", Value::Quantity, 0, Many),
+    value("CreditRequestedQuantity", Value::Quantity, 0, Many),
+    value("ReturnedQuantity", Value::Quantity, 0, Many),
+    value("StartDate", Value::Date),
+    value("EndDate", Value::Date),
+    value("UnitPriceAmount", Value::Amount),
+    value("UnitPriceDiscountAmount", Value::Amount),
+    value("UnitPriceNetAmount", Value::Amount),
+    value("UnitPriceVatIncludedAmount", Value::Amount),
+    value("UnitPriceBaseQuantity", Value::Quantity),
+    text("RowIdentifier", 0, 1, 0, 70),
+    text("RowIdentifierUrlText", 0, 1, 0, 512),
+    text("RowOrderPositionIdentifier", 0, 1, 0, 35),
+    value("RowIdentifierDate", Value::Date),
+    text("RowPositionIdentifier", 0, 1, 0, 35),
+    text("OriginalInvoiceNumber", 0, 1, 0, 20),
+    text("RowOrdererName", 0, 1, 0, 70),
+    text("RowSalesPersonName", 0, 1, 0, 70),
+    text("RowOrderConfirmationIdentifier", 0, 1, 0, 70),
+    text("RowDeliveryIdentifier", 0, 1, 0, 70),
+    text("RowAgreementIdentifier", 0, 1, 0, 70),
+    text("RowBuyerReferenceIdentifier", 0, 1, 0, 70),
+    text("RowProjectReferenceIdentifier", 0, 1, 0, 70),
+    any("RowDeliveryDetails"),
+    text("RowShortProposedAccountIdentifier", 0, 1, 0, 4),
+    text("RowNormalProposedAccountIdentifier", 0, 1, 0, 35),
+    text("RowProposedAccountText", 0, 1, 0, 35),
+    text("RowAccountDimensionText", 0, Many, 0, 35),
+    text("RowSellerReferenceIdentifier", 0, 1, 0, 70),
+    text("RowFreeText", 0, Many, 0, 512),
+    value("RowDiscountPercent", Value::Percent),
+    value("RowDiscountAmount", Value::Amount),
+    any("RowChargeDetails", Many),
+    value("RowVatRatePercent", Value::Percent),
+    text("RowVatCode", 0, 1, 0, 10),
+    value("RowVatAmount", Value::Amount),
+    value("RowVatExcludedAmount", Value::Amount),
+    value("RowAmount", Value::Amount),
+    any("SubInvoiceRow", Many),
+});
+constexpr Section invoiceRowSection = section<invoiceRowRules>();
+
+constexpr auto epiIdentificationRules = entryTable<Rule>({
+    value("EpiDate", Value::Date, 1),
+    text("EpiReference", 1, 1, 0, 35),
+});
+constexpr Section epiIdentificationSection = section<epiIdentificationRules>();
+constexpr auto epiBfiRules = entryTable<Rule>({
+    value("EpiBfiIdentifier", Value::Bic),
+    text("EpiBfiName", 0, 1, 0, 35),
+});
+constexpr Section epiBfiSection = section<epiBfiRules>();
+constexpr auto epiBeneficiaryRules = entryTable<Rule>({
+    text("EpiNameAddressDetails", 1, 1, 2, 35),
+    text("EpiBei", 0, 1, 0, 35),
+    value("EpiAccountID", Value::Iban, 1),
+});
+constexpr Section epiBeneficiarySection = section<epiBeneficiaryRules>();
+constexpr auto epiPartyRules = entryTable<Rule>({
+    nested("EpiBfiPartyDetails", epiBfiSection, 1),
+    nested("EpiBeneficiaryPartyDetails", epiBeneficiarySection, 1),
+});
+constexpr Section epiPartySection = section<epiPartyRules>();
+constexpr auto epiPaymentRules = entryTable<Rule>({
+    text("EpiPaymentInstructionId", 0, 1, 0, 35),
+    text("EpiTransactionTypeCode", 0, 1, 0, 35),
+    text("EpiInstructionCode", 0, 1, 0, 35),
+    value("EpiRemittanceInfoIdentifier", Value::Reference),
+    value("EpiInstructedAmount", Value::Amount, 1),
+    value("EpiCharge", Value::Charge, 1),
+    value("EpiDateOptionDate", Value::Date, 1),
+    text("EpiPaymentMeansCode", 0, 1, 0, 35),
+});
+constexpr Section epiPaymentSection = section<epiPaymentRules>();
+constexpr auto epiRules = entryTable<Rule>({
+    nested("EpiIdentificationDetails", epiIdentificationSection, 1),
+    nested("EpiPartyDetails", epiPartySection, 1),
+    nested("EpiPaymentInstructionDetails", epiPaymentSection, 1),
+});
+constexpr Section epiSection = section<epiRules>();
+
+constexpr auto finvoiceRules = entryTable<Rule>({
+    nested("MessageTransmissionDetails", transmissionSection),
+    nested("SellerPartyDetails", sellerPartySection, 1),
+    text("SellerOrganisationUnitNumber", 0, 1, 0, 35),
+    text("SellerSiteCode", 0, 1, 0, 35),
+    text("SellerContactPersonName", 0, 1, 0, 70),
+    text("SellerContactPersonFunction", 0, Many, 0, 35),
+    text("SellerContactPersonDepartment", 0, Many, 0, 35),
+    nested("SellerCommunicationDetails", sellerCommunicationSection),
+    nested("SellerInformationDetails", sellerInformationSection),
+    any("InvoiceSenderPartyDetails"),
+    any("InvoiceRecipientPartyDetails"),
+    text("InvoiceRecipientOrganisationUnitNumber", 0, 1, 0, 35),
+    text("InvoiceRecipientSiteCode", 0, 1, 0, 35),
+    text("InvoiceRecipientContactPersonName", 0, 1, 0, 70),
+    text("InvoiceRecipientContactPersonFunction", 0, Many, 0, 35),
+    text("InvoiceRecipientContactPersonDepartment", 0, Many, 0, 35),
+    text("InvoiceRecipientLanguageCode", 0, 1, 0, 3),
+    any("InvoiceRecipientCommunicationDetails"),
+    nested("BuyerPartyDetails", buyerPartySection, 1),
+    text("BuyerOrganisationUnitNumber", 0, 1, 0, 35),
+    text("BuyerSiteCode", 0, 1, 0, 35),
+    text("BuyerContactPersonName", 0, 1, 0, 70),
+    text("BuyerContactPersonFunction", 0, Many, 0, 35),
+    text("BuyerContactPersonDepartment", 0, Many, 0, 35),
+    any("BuyerCommunicationDetails"),
+    any("DeliveryPartyDetails"),
+    text("DeliveryOrganisationUnitNumber", 0, 1, 0, 35),
+    text("DeliverySiteCode", 0, 1, 0, 35),
+    text("DeliveryContactPersonName", 0, 1, 0, 70),
+    text("DeliveryContactPersonFunction", 0, Many, 0, 35),
+    text("DeliveryContactPersonDepartment", 0, Many, 0, 35),
+    any("DeliveryCommunicationDetails"),
+    any("DeliveryDetails"),
+    any("AnyPartyDetails", Many),
+    nested("InvoiceDetails", invoiceDetailsSection, 1),
+    any("PaymentStatusDetails"),
+    any("PartialPaymentDetails", Many),
+    any("FactoringAgreementDetails"),
+    text("VirtualBankBarcode", 0, 1, 0, 54),
+    nested("InvoiceRow", invoiceRowSection, 0, Many),
+    any("SpecificationDetails"),
+    nested("EpiDetails", epiSection, 1),
+    text("InvoiceUrlNameText", 0, Many, 0, 512),
+    text("InvoiceUrlText", 0, Many, 0, 512),
+    text("StorageUrlText", 0, 1, 0, 512),
+    text("LayOutIdentifier", 0, 1, 0, 35),
+    text("InvoiceSegmentIdentifier", 0, Many, 0, 35),
+});
+constexpr Section finvoiceSection = section<finvoiceRules>();
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+bool isUpper(char c) {
+    return c >= 'A' && c <= 'Z';
+}
+bool isAlnum(char c) {
+    return isDigit(c) || isUpper(c);
+}
+
+// [-]digits[,decimals], Finvoice uses a decimal comma
+bool isDecimal(std::string_view s, bool negative, size_t maxDigits, size_t maxDecimals) {
+    if (negative && !s.empty() && s[0] == '-') {
+        s.remove_prefix(1);
+    }
+    size_t comma = s.find(',');
+    std::string_view digits = s.substr(0, comma);
+    std::string_view decimals = comma == std::string_view::npos ? std::string_view() : s.substr(comma + 1);
+    if (digits.empty() || digits.size() > maxDigits || decimals.size() > maxDecimals) {
+        return false;
+    }
+    if (comma != std::string_view::npos && decimals.empty()) {
+        return false;
+    }
+    for (char c : digits) if (!isDigit(c)) return false;
+    for (char c : decimals) if (!isDigit(c)) return false;
+    return true;
+}
+
+bool isDate(std::string_view s) {
+    if (s.size() != 8) return false;
+    for (char c : s) if (!isDigit(c)) return false;
+    int year = (s[0] - '0') * 1000 + (s[1] - '0') * 100 + (s[2] - '0') * 10 + (s[3] - '0');
+    int month = (s[4] - '0') * 10 + (s[5] - '0');
+    int day = (s[6] - '0') * 10 + (s[7] - '0');
+    static const int days[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12 || day < 1 || day > days[month - 1]) return false;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month != 2 || day <= 28 || leap;
+}
+
+// ISO 7064 mod 97-10 over text rearranged as IBAN / RF references are:
+// the first four characters moved to the end, letters as 10..35
+bool mod97(std::string_view s) {
+    unsigned remainder = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[(i + 4) % s.size()];
+        if (isDigit(c)) {
+            remainder = (remainder * 10 + (c - '0')) % 97;
+        } else if (isUpper(c)) {
+            remainder = (remainder * 100 + (c - 'A' + 10)) % 97;
+        } else {
+            return false;
+        }
+    }
+    return remainder == 1;
+}
+
+bool isIban(std::string_view s) {
+    if (s.size() < 15 || s.size() > 34 || !isUpper(s[0]) || !isUpper(s[1]) || !isDigit(s[2]) || !isDigit(s[3])) {
+        return false;
+    }
+    return mod97(s);
+}
+
+bool isBic(std::string_view s) {
+    if (s.size() != 8 && s.size() != 11) return false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (i < 6 ? !isUpper(s[i]) : !isAlnum(s[i])) return false;
+    }
+    return true;
+}
+
+// Finnish reference number (check digit with weights 7, 3, 1 from the
+// right) or an RF creditor reference, spaces as printed are allowed
+bool isReference(std::string_view text) {
+    char buf[40];
+    size_t n = 0;
+    for (char c : text) {
+        if (c == ' ') continue;
+        if (n == sizeof(buf)) return false;
+        buf[n++] = c;
+    }
+    std::string_view s(buf, n);
+    if (s.starts_with("RF")) {
+        return s.size() >= 5 && s.size() <= 25 && mod97(s);
+    }
+    if (s.size() < 4 || s.size() > 20) return false;
+    static const int weights[] = {7, 3, 1};
+    int sum = 0;
+    for (size_t i = 0; i + 1 < s.size(); ++i) {
+        char c = s[s.size() - 2 - i];
+        if (!isDigit(c)) return false;
+        sum += (c - '0') * weights[i % 3];
+    }
+    return isDigit(s.back()) && (10 - sum % 10) % 10 == s.back() - '0';
+}
+
+class Validation {
+public:
+    Validation(std::string_view xml, std::vector<std::string> &errors, size_t maxErrors)
+        : reader_(xml), errors_(errors), maxErrors_(maxErrors),
+          utf8_(charsetFromXmlDeclaration(xml) == Charset::Utf8) {}
+
+    void run() {
+        XmlReader::StartTag root;
+        reader_.root(root);
+        if (root.name != "Finvoice") {
+            error(root.name, "root element is not Finvoice");
+            return;
+        }
+        std::string version;
+        if (!XmlReader::attribute(root, "Version", version) || version != "3.0") {
+            error(root.name, "Version is not 3.0");
+        }
+        path_.push_back(root.name);
+        section(root, finvoiceSection);
+    }
+private:
+    void error(std::string_view name, std::string_view message) {
+        if (errors_.size() >= maxErrors_) {
+            return;
+        }
+        std::string line;
+        for (auto part : path_) {
+            line.append(part).append("/");
+        }
+        line.append(name).append(": ").append(message);
+        errors_.push_back(std::move(line));
+    }
+
+    void section(const XmlReader::StartTag &tag, const Section &s) {
+        uint16_t counts[64] = {};
+        int last = -1;
+        XmlReader::StartTag child;
+        while (!tag.empty && reader_.next(child)) {
+            int i = s.find(child.name);
+            if (i < 0) {
+                error(child.name, "element not allowed here");
+                reader_.skip(child);
+                continue;
+            }
+            const Rule &rule = s.rules[i];
+            if (i < last) {
+                error(child.name, std::string("must come before ") + std::string(s.rules[last].name));
+            }
+            last = std::max(last, i);
+            if (counts[i]++ == rule.maxOccurs) {
+                error(child.name, "occurs more than " + std::to_string(rule.maxOccurs) + " times");
+            }
+            element(child, rule);
+        }
+        for (size_t i = 0; i < s.size; ++i) {
+            if (counts[i] < s.rules[i].minOccurs) {
+                error(s.rules[i].name, "required element is missing");
+            }
+        }
+    }
+
+    void element(const XmlReader::StartTag &tag, const Rule &rule) {
+        if (rule.value == Value::Any) {
+            reader_.skip(tag);
+            return;
+        }
+        if (rule.value == Value::Section) {
+            path_.push_back(tag.name);
+            section(tag, *rule.section);
+            path_.pop_back();
+            return;
+        }
+        text_.clear();
+        if (!tag.empty) {
+            XmlReader::StartTag child;
+            while (reader_.next(child, [this](std::string_view piece) { text_.append(piece); })) {
+                error(child.name, "element not allowed in text content");
+                reader_.skip(child);
+            }
+        }
+        if (text_.empty()) {
+            if (rule.value == Value::Charge) {
+                // the charge is given by the attribute alone
+                checkAttribute(tag, "ChargeOption", {"SHA", "SLEV"}, true);
+            } else if (rule.minOccurs > 0 && (rule.value != Value::Text || rule.minLength > 0)) {
+                error(tag.name, "required element is empty");
+            }
+            return;
+        }
+        std::string_view v = text_;
+        switch (rule.value) {
+            case Value::Text: {
+                size_t length = utf8_ ? utf8Length(v) : v.size();
+                if (length < rule.minLength || (rule.maxLength && length > rule.maxLength)) {
+                    error(tag.name, "length " + std::to_string(length) + " is not within " +
+                                    std::to_string(rule.minLength) + ".." + std::to_string(rule.maxLength));
+                }
+                break;
+            }
+            case Value::Amount:
+                if (!isDecimal(v, true, 15, 5)) invalid(tag, "amount");
+                currency(tag);
+                break;
+            case Value::Quantity:
+                if (!isDecimal(v, true, 14, 6)) invalid(tag, "quantity");
+                break;
+            case Value::Percent:
+                if (!isDecimal(v, false, 3, 4)) invalid(tag, "percentage");
+                break;
+            case Value::Date:
+                if (!isDate(v)) invalid(tag, "CCYYMMDD date");
+                checkAttribute(tag, "Format", {"CCYYMMDD"}, true);
+                break;
+            case Value::Iban: {
+                std::string scheme;
+                if (!XmlReader::attribute(tag, "IdentificationSchemeName", scheme) || scheme == "IBAN") {
+                    if (!isIban(v)) invalid(tag, "IBAN");
+                }
+                break;
+            }
+            case Value::Bic:
+                if (!isBic(v)) invalid(tag, "BIC");
+                break;
+            case Value::Reference:
+                if (!isReference(v)) invalid(tag, "payment reference");
+                break;
+            case Value::TypeCode:
+                if (v.size() != 5 || !isUpper(v[0]) || !isUpper(v[1]) || !isUpper(v[2]) || !isDigit(v[3]) || !isDigit(v[4])) {
+                    invalid(tag, "type code");
+                }
+                break;
+            case Value::Origin:
+                if (v != "Original" && v != "Copy" && v != "Cancel") invalid(tag, "origin code");
+                break;
+            case Value::Charge:
+                checkAttribute(tag, "ChargeOption", {"SHA", "SLEV"}, true);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void invalid(const XmlReader::StartTag &tag, const char *what) {
+        error(tag.name, "'" + text_ + "' is not a valid " + what);
+    }
+    void currency(const XmlReader::StartTag &tag) {
+        std::string code;
+        if (!XmlReader::attribute(tag, "AmountCurrencyIdentifier", code)) {
+            error(tag.name, "AmountCurrencyIdentifier is missing");
+        } else if (code.size() != 3 || !isUpper(code[0]) || !isUpper(code[1]) || !isUpper(code[2])) {
+            error(tag.name, "AmountCurrencyIdentifier '" + code + "' is not a currency code");
+        }
+    }
+    void checkAttribute(const XmlReader::StartTag &tag, const char *name, std::initializer_list<std::string_view> codes, bool required) {
+        std::string value;
+        if (!XmlReader::attribute(tag, name, value)) {
+            if (required) error(tag.name, std::string(name) + " is missing");
+            return;
+        }
+        for (auto code : codes) {
+            if (value == code) return;
+        }
+        error(tag.name, std::string(name) + " '" + value + "' is not allowed");
+    }
+    static size_t utf8Length(std::string_view s) {
+        size_t n = 0;
+        for (unsigned char c : s) {
+            n += (c & 0xC0) != 0x80;
+        }
+        return n;
+    }
+
+    XmlReader reader_;
+    std::vector<std::string> &errors_;
+    size_t maxErrors_;
+    bool utf8_;
+    std::vector<std::string_view> path_;
+    std::string text_;
+};
+
+} // namespace
+
+bool FinvoiceValidator::validate(std::string_view xml, std::vector<std::string> &errors, size_t maxErrors) {
+    size_t before = errors.size();
+    try {
+        Validation(xml, errors, before + maxErrors).run();
+    } catch (const std::exception &e) {
+        errors.push_back(std::string("not well-formed XML: ") + e.what());
+    }
+    return errors.size() == before;
+}
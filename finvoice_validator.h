@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Offline check of generated Finvoice 3.0 messages, run before they are
+// uploaded. The schema rules Maventa rejects on are compiled into static
+// tables: element order and occurrence per section, required elements,
+// text lengths, code lists, and the formats of amounts, quantities,
+// percentages, dates, IBAN, BIC and payment references. The document is
+// checked in one streaming pass without building a tree.
+//
+// Optional elements that are present but empty are taken as absent, the
+// writer emits a few of those and Maventa accepts them.
+class FinvoiceValidator {
+public:
+    // Returns false when the message breaks a rule, errors then holds one
+    // line per problem (up to maxErrors) with the path of the element
+    static bool validate(std::string_view xml, std::vector<std::string> &errors, size_t maxErrors = 20);
+};
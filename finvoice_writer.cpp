@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "finvoice_writer.h"
+#include "util.h"
+#include <array>
+#include <cstring>
+
+namespace {
+
+// bytes that cannot go into text content as they are
+constexpr std::array<bool, 256> makeSpecial() {
+    std::array<bool, 256> special{};
+    for (int c = 0; c < 0x20; c++) {
+        special[c] = c != '\t' && c != '\n' && c != '\r';
+    }
+    special['&'] = special['<'] = special['>'] = special['"'] = true;
+    return special;
+}
+constexpr std::array<bool, 256> special = makeSpecial();
+
+const size_t fixedSize = 6 * 1024;  // everything but rows and attachments
+const size_t rowSize = 1024;
+const size_t attachmentSize = 1024; // attachment markup without the content
+
+} // namespace
+
+template <typename Invoice>
+size_t FinvoiceWriter::estimateSize(const Invoice &inv) {
+    size_t size = fixedSize + inv.rows.size() * rowSize;
+    for (const auto &row : inv.rows) {
+        size += row.ArticleName.size() + row.RowFreeText.size();
+    }
+    return size;
+}
+
+void FinvoiceWriter::indent() {
+    out_ += '\n';
+    out_.append(2 * depth_, ' ');
+}
+void FinvoiceWriter::open(const char *name) {
+    indent();
+    out_ += '<';
+    out_ += name;
+    out_ += '>';
+    depth_++;
+}
+void FinvoiceWriter::close(const char *name) {
+    depth_--;
+    indent();
+    out_ += "</";
+    out_ += name;
+    out_ += '>';
+}
+void FinvoiceWriter::empty(const char *name, const char *attr, const char *attr_value) {
+    indent();
+    out_ += '<';
+    out_ += name;
+    if (attr) {
+        out_ += ' ';
+        out_ += attr;
+        out_ += "=\"";
+        out_ += attr_value;
+        out_ += '"';
+    }
+    out_ += "/>";
+}
+void FinvoiceWriter::element(const char *name, std::string_view value, const char *attr, const char *attr_value) {
+    indent();
+    out_ += '<';
+    out_ += name;
+    if (attr) {
+        out_ += ' ';
+        out_ += attr;
+        out_ += "=\"";
+        out_ += attr_value;
+        out_ += '"';
+    }
+    out_ += '>';
+    text(value);
+    out_ += "</";
+    out_ += name;
+    out_ += '>';
+}
+void FinvoiceWriter::text(std::string_view value) {
+    size_t start = 0;
+    for (size_t i = 0; i < value.size(); i++) {
+        unsigned char c = value[i];
+        if (!special[c]) {
+            continue;
+        }
+        encoder_.write(value.data() + start, i - start);
+        encoder_.finish();
+        switch (c) {
+            case '&': out_ += "&amp;"; break;
+            case '<': out_ += "&lt;"; break;
+            case '>': out_ += "&gt;"; break;
+            case '"': out_ += "&quot;"; break;
+            default: out_ += ' '; break; // control characters are not allowed in XML 1.0
+        }
+        start = i + 1;
+    }
+    encoder_.write(value.data() + start, value.size() - start);
+    encoder_.finish();
+}
+
+template <typename Invoice>
+void FinvoiceWriter::messageTransmissionDetails(const Invoice &inv, bool attachment_message) {
+    open("MessageTransmissionDetails");
+    open("MessageSenderDetails");
+    element("FromIdentifier", inv.seller.SellerOVT, "SchemeID", "0037");
+    element("FromIntermediator", inv.seller.SellerIntermediator);
+    close("MessageSenderDetails");
+    open("MessageReceiverDetails");
+    element("ToIdentifier", inv.buyer.BuyerOVT, "SchemeID", "0037");
+    element("ToIntermediator", inv.buyer.BuyerIntermediator);
+    close("MessageReceiverDetails");
+    open("MessageDetails");
+    if (attachment_message) {
+        element("MessageIdentifier", "ATTM2O0002" + std::string(inv.messageId) + "::attachments");
+        element("MessageTimeStamp", now_);
+        element("RefToMessageIdentifier", "M2O0002" + std::string(inv.messageId));
+    } else {
+        element("MessageIdentifier", "M2O0002" + std::string(inv.messageId));
+        element("MessageTimeStamp", now_);
+    }
+    close("MessageDetails");
+    close("MessageTransmissionDetails");
+}
+template <typename Seller>
+void FinvoiceWriter::sellerPartyDetails(const Seller &seller) {
+    open("SellerPartyDetails");
+    element("SellerPartyIdentifier", seller.SellerOrganisationTaxCode);
+    element("SellerOrganisationName", seller.SellerOrganisationName);
+    element("SellerOrganisationTaxCode", seller.SellerOrganisationTaxCode);
+    open("SellerPostalAddressDetails");
+    element("SellerStreetName", seller.SellerStreetName);
+    element("SellerTownName", seller.SellerTownName);
+    element("SellerPostCodeIdentifier", seller.SellerPostCodeIdentifier);
+    close("SellerPostalAddressDetails");
+    close("SellerPartyDetails");
+}
+template <typename Seller>
+void FinvoiceWriter::sellerComDetails(const Seller &seller) {
+    element("SellerContactPersonName", seller.SellerContactPersonName);
+    open("SellerCommunicationDetails");
+    element("SellerPhoneNumberIdentifier", seller.SellerPhoneNumberIdentifier);
+    element("SellerEmailaddressIdentifier", seller.SellerEmailaddressIdentifier);
+    close("SellerCommunicationDetails");
+}
+template <typename Seller>
+void FinvoiceWriter::sellerInformationDetails(const Seller &seller) {
+    std::string selleraccountid(seller.SellerAccountID);
+    string_replaceall(selleraccountid, " ", "");
+    open("SellerInformationDetails");
+    element("SellerCommonEmailaddressIdentifier", seller.SellerEmailaddressIdentifier);
+    open("SellerAccountDetails");
+    element("SellerAccountID", selleraccountid, "IdentificationSchemeName", "IBAN");
+    element("SellerBic", seller.SellerBic, "IdentificationSchemeName", "BIC");
+    element("SellerAccountName", seller.SellerAccountName);
+    close("SellerAccountDetails");
+    close("SellerInformationDetails");
+}
+template <typename Buyer>
+void FinvoiceWriter::buyerPartyDetails(const Buyer &buyer) {
+    open("BuyerPartyDetails");
+    element("BuyerPartyIdentifier", buyer.BuyerOrganisationTaxCode);
+    element("BuyerOrganisationName", buyer.BuyerOrganisationName);
+    element("BuyerOrganisationTaxCode", buyer.BuyerOrganisationTaxCode);
+    open("BuyerPostalAddressDetails");
+    element("BuyerStreetName", buyer.BuyerStreetName);
+    element("BuyerTownName", buyer.BuyerTownName);
+    element("BuyerPostCodeIdentifier", buyer.BuyerPostCodeIdentifier);
+    close("BuyerPostalAddressDetails");
+    close("BuyerPartyDetails");
+    empty("BuyerOrganisationUnitNumber");
+    empty("BuyerContactPersonName");
+}
+void FinvoiceWriter::deliveryDetails() {
+    open("DeliveryDetails");
+    element("DeliveryDate", today_, "Format", "CCYYMMDD");
+    close("DeliveryDetails");
+}
+template <typename Invoice>
+void FinvoiceWriter::invoiceDetails(const Invoice &inv) {
+    //<SellersBuyerIdentifier>1001</SellersBuyerIdentifier>
+    open("InvoiceDetails");
+    element("InvoiceTypeCode", "INV01");
+    element("InvoiceTypeText", "INVOICE");
+    element("OriginCode", "Original");
+    element("InvoiceNumber", inv.InvoiceNumber);
+    element("InvoiceDate", today_, "Format", "CCYYMMDD");
+    element("OrderIdentifier", inv.OrderIdentifier);
+    element("AgreementIdentifier", "");
+    element("BuyerReferenceIdentifier", inv.BuyerReferenceIdentifier);
+    element("InvoiceTotalVatExcludedAmount", inv.InvoiceTotalVatExcludedAmount, "AmountCurrencyIdentifier", "EUR");
+    element("InvoiceTotalVatAmount", inv.InvoiceTotalVatAmount, "AmountCurrencyIdentifier", "EUR");
+    element("InvoiceTotalVatIncludedAmount", inv.InvoiceTotalVatIncludedAmount, "AmountCurrencyIdentifier", "EUR");
+    empty("VatSpecificationDetails");
+    open("PaymentTermsDetails");
+    empty("PaymentTermsFreeText");
+    element("InvoiceDueDate", inv.InvoiceDueDate, "Format", "CCYYMMDD");
+    open("PaymentOverDueFineDetails");
+    element("PaymentOverDueFineFreeText", inv.PaymentOverDueFineFreeText);
+    element("PaymentOverDueFinePercent", inv.PaymentOverDueFinePercent);
+    close("PaymentOverDueFineDetails");
+    close("PaymentTermsDetails");
+    close("InvoiceDetails");
+    //TODO factoring, FactoringAgreementDetails
+}
+template <typename Row>
+void FinvoiceWriter::invoiceRow(const Row &row) {
+    open("InvoiceRow");
+    element("ArticleIdentifier", row.ArticleIdentifier);
+    element("ArticleName", row.ArticleName);
+    element("DeliveredQuantity", row.DeliveredQuantity, "QuantityUnitCode", "kpl");
+    element("InvoicedQuantity", row.InvoicedQuantity, "QuantityUnitCode", "kpl");
+    element("UnitPriceAmount", row.UnitPriceAmount, "AmountCurrencyIdentifier", "EUR");
+    empty("RowPositionIdentifier");
+    empty("RowProposedAccountText");
+    element("RowFreeText", row.RowFreeText);
+    element("RowVatRatePercent", row.RowVatRatePercent);
+    element("RowVatAmount", row.RowVatAmount, "AmountCurrencyIdentifier", "EUR");
+    element("RowVatExcludedAmount", row.RowVatExcludedAmount, "AmountCurrencyIdentifier", "EUR");
+    close("InvoiceRow");
+}
+template <typename Invoice>
+void FinvoiceWriter::epiDetails(const Invoice &inv) {
+    open("EpiDetails");
+    open("EpiIdentificationDetails");
+    element("EpiDate", inv.EpiDate, "Format", "CCYYMMDD");
+    empty("EpiReference");
+    close("EpiIdentificationDetails");
+    open("EpiPartyDetails");
+    open("EpiBfiPartyDetails");
+    element("EpiBfiIdentifier", inv.EpiBfiIdentifier, "IdentificationSchemeName", "BIC");
+    close("EpiBfiPartyDetails");
+    open("EpiBeneficiaryPartyDetails");
+    element("EpiNameAddressDetails", inv.EpiNameAddressDetails);
+    element("EpiAccountID", inv.EpiAccountID, "IdentificationSchemeName", "IBAN");
+    close("EpiBeneficiaryPartyDetails");
+    close("EpiPartyDetails");
+    open("EpiPaymentInstructionDetails");
+    element("EpiRemittanceInfoIdentifier", inv.EpiRemittanceInfoIdentifier, "IdentificationSchemeName", "SPY");
+    element("EpiInstructedAmount", inv.EpiInstructedAmount, "AmountCurrencyIdentifier", "EUR");
+    empty("EpiCharge", "ChargeOption", "SLEV");
+    element("EpiDateOptionDate", inv.EpiDateOptionDate, "Format", "CCYYMMDD");
+    close("EpiPaymentInstructionDetails");
+    close("EpiDetails");
+}
+void FinvoiceWriter::attachmentDetails(std::string_view messageId, const FinvoiceAttachment &attachment) {
+    const std::string &sha1 = attachment.secureHash();
+    //YV1199015::attachments::
+    open("AttachmentDetails");
+    element("AttachmentIdentifier", "ATTM2O0002" + std::string(messageId) + "::attachments::" + sha1);
+    // base64, nothing to escape or encode
+    indent();
+    out_ += "<AttachmentContent>";
+    out_ += attachment.AttachmentContent.view().text();
+    out_ += "</AttachmentContent>";
+    element("AttachmentName", attachment.AttachmentName);
+    element("AttachmentMimeType", attachment.AttachmentMimeType);
+    element("AttachmentSecureHash", sha1);
+    close("AttachmentDetails");
+}
+
+template <typename Invoice>
+void FinvoiceWriter::finvoiceMessage(const Invoice &inv) {
+    out_.reserve(out_.size() + estimateSize(inv));
+    now_ = getTimestamp("");
+    today_ = getTimestamp("YYYYMMDD");
+    out_ += R"(<?xml version="1.0" encoding="ISO-8859-15"?>
+<?xml-stylesheet type="text/xsl" href="Finvoice.xsl"?>
+<Finvoice xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance" xsi:noNamespaceSchemaLocation="Finvoice3.0.xsd" Version="3.0">)";
+    depth_ = 1;
+    messageTransmissionDetails(inv, false);
+    sellerPartyDetails(inv.seller);
+    sellerComDetails(inv.seller);
+    sellerInformationDetails(inv.seller);
+    buyerPartyDetails(inv.buyer);
+    deliveryDetails();
+    invoiceDetails(inv);
+    for (const auto &row : inv.rows) {
+        invoiceRow(row);
+    }
+    epiDetails(inv);
+    depth_ = 0;
+    out_ += "\n</Finvoice>\n";
+}
+
+template <typename Invoice>
+void FinvoiceWriter::attachmentMessage(const Invoice &inv, const std::vector<FinvoiceAttachment> &attachments, bool includetransmissiondetails) {
+    if (attachments.empty()) {
+        return;
+    }
+    size_t size = fixedSize;
+    for (const auto &attachment : attachments) {
+        size += attachmentSize + attachment.AttachmentContent.size();
+    }
+    out_.reserve(out_.size() + size);
+    now_ = getTimestamp("");
+    if (includetransmissiondetails) {
+        out_ += "<?xml version=\"1.0\" encoding=\"ISO-8859-15\"?>\n";
+    }
+    out_ += R"(<FinvoiceAttachments xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance" xsi:noNamespaceSchemaLocation="FinvoiceAttachments.xsd" Version="1.0">)";
+    depth_ = 1;
+    if (includetransmissiondetails) {
+        messageTransmissionDetails(inv, true);
+    }
+    size_t details = out_.size();
+    for (const auto &attachment : attachments) {
+        attachmentDetails(inv.messageId, attachment);
+    }
+    LOG_CATEGORY(DEBUG, LogCategory::Attachment) << "Attachment details xml: "
+        << logPayload(LogCategory::Attachment, std::string_view(out_).substr(details));
+    depth_ = 0;
+    out_ += "\n</FinvoiceAttachments>";
+}
+
+template <typename Invoice>
+void FinvoiceWriter::envelope(const Invoice &inv) {
+    out_.reserve(out_.size() + 4096);
+    now_ = getTimestamp("");
+    out_ += R"(<SOAP-ENV:Envelope xmlns:SOAP-ENV="http://schemas.xmlsoap.org/soap/envelope/" xmlns:xlink="http://www.w3.org/1999/xlink" xmlns:eb="http://www.oasis-open.org/committees/ebxml-msg/schema/msg-header-2_0.xsd">)";
+    depth_ = 1;
+    open("SOAP-ENV:Header");
+    indent();
+    out_ += R"(<eb:MessageHeader xmlns:eb="http://www.oasis-open.org/committees/ebxml-msg/schema/msg-header-2_0.xsd" SOAP-ENV:mustUnderstand="1">)";
+    depth_++;
+    open("eb:From");
+    element("eb:PartyId", inv.seller.SellerOVT); // OVT tunnus
+    element("eb:Role", "Sender");
+    close("eb:From");
+    open("eb:From");
+    element("eb:PartyId", inv.seller.SellerIntermediator);
+    element("eb:Role", "Intermediator");
+    close("eb:From");
+    open("eb:To");
+    element("eb:PartyId", inv.buyer.BuyerOVT); // FI1783093710005039
+    element("eb:Role", "Receiver");
+    close("eb:To");
+    open("eb:To");
+    element("eb:PartyId", inv.buyer.BuyerIntermediator); // DABAFIHH
+    element("eb:Role", "Intermediator");
+    close("eb:To");
+    element("eb:CPAId", "yoursandmycpa");
+    element("eb:ConversationId", "1231235");
+    element("eb:Service", "Routing");
+    element("eb:Action", "ProcessInvoice");
+    open("eb:MessageData");
+    element("eb:MessageId", "M2O0002" + std::string(inv.EpiRemittanceInfoIdentifier));
+    element("eb:Timestamp", now_); // 2017-09-11T09:13:26
+    empty("eb:RefToMessageId");
+    close("eb:MessageData");
+    close("eb:MessageHeader");
+    close("SOAP-ENV:Header");
+    open("SOAP-ENV:Body");
+    indent();
+    out_ += R"(<eb:Manifest eb:id="Manifest" eb:version="2.0">)";
+    depth_++;
+    indent();
+    out_ += "<eb:Reference eb:id=\"Finvoice\" xlink:href=\"";
+    text(inv.EpiRemittanceInfoIdentifier);
+    out_ += "\">";
+    depth_++;
+    indent();
+    out_ += R"(<eb:Schema eb:location="http://www.finvoice.info/finvoice.xsd" eb:version="2.0"/>)";
+    close("eb:Reference");
+    close("eb:Manifest");
+    close("SOAP-ENV:Body");
+    depth_ = 0;
+    out_ += "\n</SOAP-ENV:Envelope>\n";
+}
+
+// the invoice models
+template void FinvoiceWriter::finvoiceMessage(const FinvoiceInvoice &inv);
+template void FinvoiceWriter::attachmentMessage(const FinvoiceInvoice &inv, const std::vector<FinvoiceAttachment> &attachments, bool includetransmissiondetails);
+template void FinvoiceWriter::envelope(const FinvoiceInvoice &inv);
+template size_t FinvoiceWriter::estimateSize(const FinvoiceInvoice &inv);
+template void FinvoiceWriter::finvoiceMessage(const ArenaFinvoiceInvoice &inv);
+template void FinvoiceWriter::attachmentMessage(const ArenaFinvoiceInvoice &inv, const std::vector<FinvoiceAttachment> &attachments, bool includetransmissiondetails);
+template void FinvoiceWriter::envelope(const ArenaFinvoiceInvoice &inv);
+template size_t FinvoiceWriter::estimateSize(const ArenaFinvoiceInvoice &inv);
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "finvoice_invoice.h"
+#include "charset.h"
+
+// Writes the outbound Finvoice documents straight into one caller owned
+// buffer. Text content is XML escaped and encoded to ISO-8859-15 on the
+// way, the buffer is reserved once from the size of the invoice.
+class FinvoiceWriter {
+public:
+    explicit FinvoiceWriter(std::string &out) : out_(out), encoder_(out) {}
+
+    // Invoice is FinvoiceInvoice or ArenaFinvoiceInvoice
+    template <typename Invoice>
+    void finvoiceMessage(const Invoice &inv);
+    template <typename Invoice>
+    void attachmentMessage(const Invoice &inv, const std::vector<FinvoiceAttachment> &attachments, bool includetransmissiondetails = true);
+    template <typename Invoice>
+    void envelope(const Invoice &inv);
+
+    // Upper estimate of the finvoice message. The attachment content goes
+    // into the attachment message, which sizes itself.
+    template <typename Invoice>
+    static size_t estimateSize(const Invoice &inv);
+
+private:
+    template <typename Invoice>
+    void messageTransmissionDetails(const Invoice &inv, bool attachment_message);
+    template <typename Seller>
+    void sellerPartyDetails(const Seller &seller);
+    template <typename Seller>
+    void sellerComDetails(const Seller &seller);
+    template <typename Seller>
+    void sellerInformationDetails(const Seller &seller);
+    template <typename Buyer>
+    void buyerPartyDetails(const Buyer &buyer);
+    void deliveryDetails();
+    template <typename Invoice>
+    void invoiceDetails(const Invoice &inv);
+    template <typename Row>
+    void invoiceRow(const Row &row);
+    template <typename Invoice>
+    void epiDetails(const Invoice &inv);
+    void attachmentDetails(std::string_view messageId, const FinvoiceAttachment &attachment);
+
+    void indent();
+    void open(const char *name);
+    void close(const char *name);
+    void empty(const char *name, const char *attr = nullptr, const char *attr_value = nullptr);
+    void element(const char *name, std::string_view value, const char *attr = nullptr, const char *attr_value = nullptr);
+    void text(std::string_view value);
+
+    std::string &out_;
+    Latin9Encoder encoder_;
+    int depth_ = 0;
+    std::string now_;   // MessageTimeStamp, the same in every part of a message
+    std::string today_; // YYYYMMDD
+};
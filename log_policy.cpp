@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "log_policy.h"
+#include "secure_hash.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+constexpr size_t categoryCount = static_cast<size_t>(LogCategory::Count);
+
+// budgets are charged from the pipeline workers, the policies themselves
+// are set up before any of them starts
+LogCategoryPolicy policies[categoryCount];
+std::atomic<size_t> spent[categoryCount];
+std::atomic<bool> exhaustedReported[categoryCount];
+
+const char *categoryName(LogCategory category) {
+    switch (category) {
+        case LogCategory::Http: return "http";
+        case LogCategory::Finvoice: return "finvoice";
+        case LogCategory::Attachment: return "attachment";
+        default: return "general";
+    }
+}
+
+} // namespace
+
+void LogPolicy::configure(LogCategory category, const LogCategoryPolicy &policy) {
+    policies[static_cast<size_t>(category)] = policy;
+}
+const LogCategoryPolicy &LogPolicy::policy(LogCategory category) {
+    return policies[static_cast<size_t>(category)];
+}
+bool LogPolicy::enabled(LogCategory category) {
+    size_t i = static_cast<size_t>(category);
+    if (policies[i].muted) {
+        return false;
+    }
+    if (withinBudget(category)) {
+        return true;
+    }
+    if (!exhaustedReported[i].exchange(true)) {
+        LOG(WARNING) << "Log budget of " << policies[i].budget << " bytes for "
+                     << categoryName(category) << " payloads spent, they are not logged for the rest of the run";
+    }
+    return false;
+}
+bool LogPolicy::withinBudget(LogCategory category) {
+    size_t i = static_cast<size_t>(category);
+    return policies[i].budget == 0 || spent[i].load(std::memory_order_relaxed) < policies[i].budget;
+}
+void LogPolicy::charge(LogCategory category, size_t len) {
+    spent[static_cast<size_t>(category)].fetch_add(len, std::memory_order_relaxed);
+}
+void LogPolicy::reset() {
+    for (size_t i = 0; i < categoryCount; ++i) {
+        spent[i] = 0;
+        exhaustedReported[i] = false;
+    }
+}
+
+std::ostream &operator<<(std::ostream &os, const LogPayload &payload) {
+    const LogCategoryPolicy &policy = LogPolicy::policy(payload.category);
+    std::string_view value = payload.value;
+    if (policy.muted) {
+        return os << "[" << value.size() << " bytes]";
+    }
+    // a payload logged after the budget ran out is reduced to its size.
+    // Nothing may be logged from here, this runs inside a LOG statement.
+    size_t len = LogPolicy::withinBudget(payload.category) ? std::min(value.size(), policy.maxValue) : 0;
+    LogPolicy::charge(payload.category, len);
+    os.write(value.data(), len);
+    if (len < value.size()) {
+        os << "... [" << value.size() << " bytes";
+        if (policy.hash) {
+            SecureHash hash;
+            hash.update(value.data(), value.size());
+            os << ", sha1 " << hash.hexDigest();
+        }
+        os << "]";
+    }
+    return os;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include "logger.h"
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+
+// Payloads (http bodies, documents, attachments) are logged through a
+// policy of their category, so that what reaches the log does not grow
+// with the size of the data: long values are cut to their head, and each
+// category has a byte budget for the run after which it goes quiet.
+enum class LogCategory {
+    General,
+    Http,       // request and response bodies
+    Finvoice,   // generated and received documents
+    Attachment, // attachment content and the markup around it
+    Count
+};
+
+struct LogCategoryPolicy {
+    bool muted = false;
+    size_t maxValue = 512;      // longer values are cut to this many bytes
+    size_t budget = 256 * 1024; // payload bytes per run, 0: not limited
+    bool hash = false;          // a cut value is followed by its sha1
+};
+
+class LogPolicy {
+public:
+    static void configure(LogCategory category, const LogCategoryPolicy &policy);
+    static const LogCategoryPolicy &policy(LogCategory category);
+    // false when the category is muted or its budget is spent
+    static bool enabled(LogCategory category);
+    static bool withinBudget(LogCategory category);
+    // Counts len payload bytes against the budget of the category
+    static void charge(LogCategory category, size_t len);
+    // Starts a new run, budgets are full again
+    static void reset();
+};
+
+// A value written under the policy of its category:
+// LOG(INFO) << "Response: " << logPayload(LogCategory::Http, response);
+struct LogPayload {
+    LogCategory category;
+    std::string_view value;
+};
+inline LogPayload logPayload(LogCategory category, std::string_view value) {
+    return {category, value};
+}
+std::ostream &operator<<(std::ostream &os, const LogPayload &payload);
+
+// LOG(LEVEL) for a message of a category. When the category is muted the
+// message is not built at all, the operands of << are not evaluated.
+#define LOG_CATEGORY(LEVEL, category) \
+    if (!LogPolicy::enabled(category)) {} else LOG(LEVEL)
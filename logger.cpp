@@ -2191,10 +2191,21 @@ void Storage::setApplicationArguments(int argc, char** argv) {
 } // namespace base
 
 // LogDispatchCallback
+// With ELPP_NO_LOG_TO_FILE no filename is configured and looking it up
+// dereferences a missing entry, all output then shares a single lock
+static std::string dispatchFileName(const LogDispatchData* data) {
+#if defined(ELPP_NO_LOG_TO_FILE)
+  ELPP_UNUSED(data);
+  return std::string();
+#else
+  return data->logMessage()->logger()->typedConfigurations()->filename(data->logMessage()->level());
+#endif
+}
+
 #if defined(ELPP_THREAD_SAFE)
 void LogDispatchCallback::handle(const LogDispatchData* data) {
   base::threading::ScopedLock scopedLock(m_fileLocksMapLock);
-  std::string filename = data->logMessage()->logger()->typedConfigurations()->filename(data->logMessage()->level());
+  std::string filename = dispatchFileName(data);
   auto lock = m_fileLocks.find(filename);
   if (lock == m_fileLocks.end()) {
     m_fileLocks.emplace(std::make_pair(filename, std::unique_ptr<base::threading::Mutex>(new base::threading::Mutex)));
@@ -2205,7 +2216,8 @@ void LogDispatchCallback::handle(const LogDispatchData* /*data*/) {}
 #endif
 
 base::threading::Mutex& LogDispatchCallback::fileHandle(const LogDispatchData* data) {
-  auto it = m_fileLocks.find(data->logMessage()->logger()->typedConfigurations()->filename(data->logMessage()->level()));
+  base::threading::ScopedLock scopedLock(m_fileLocksMapLock);
+  auto it = m_fileLocks.find(dispatchFileName(data));
   return *(it->second.get());
 }
 
@@ -24,6 +24,7 @@
 #include <xmlrpc-c/client_simple.hpp>
 #include <iostream>
 #include <map>
+#include <curl/curl.h>
 #include "maventa_api.h"
 #include "odoo_api.h"
 
@@ -38,6 +39,9 @@
 #include <xml2json.hpp>
 #include <rapidjson/error/en.h>
 #include "config_profile.h"
+#include "request_governor.h"
+#include "outbound_pipeline.h"
+#include "attachment_store.h"
 
 
 INITIALIZE_EASYLOGGINGPP
@@ -102,6 +106,8 @@ int main(int argc, char *argv[]) {
         return -1;  
     }
     LOG(INFO) << "Starting " << serverName << " version " << versionNumber; 
+    // before any worker thread starts, curl_global_init is not thread safe
+    curl_global_init(CURL_GLOBAL_DEFAULT);
     #ifdef _DEBUG
         configFile += ".debug";
     #endif
@@ -129,6 +135,20 @@ int main(int argc, char *argv[]) {
         LOG(ERROR) << "Invalid config file format: 'profiles' array not found";
         return -1;
     }
+    if (layout.HasMember("attachment_store") && layout["attachment_store"].IsObject()) {
+        const rapidjson::Value& store = layout["attachment_store"];
+        AttachmentStoreLimits limits;
+        if (store.HasMember("spill_threshold_kb") && store["spill_threshold_kb"].IsUint()) {
+            limits.spillThreshold = size_t(store["spill_threshold_kb"].GetUint()) * 1024;
+        }
+        if (store.HasMember("resident_cap_mb") && store["resident_cap_mb"].IsUint()) {
+            limits.residentCap = size_t(store["resident_cap_mb"].GetUint()) * 1024 * 1024;
+        }
+        if (store.HasMember("directory") && store["directory"].IsString()) {
+            limits.directory = store["directory"].GetString();
+        }
+        AttachmentStore::configure(limits);
+    }
     const rapidjson::Value& profiles = layout["profiles"];
     //LOG(DEBUG) << "Found " << profiles.Size() << " profiles";
     for (rapidjson::SizeType i = 0; i < profiles.Size(); ++i) {
@@ -147,7 +167,7 @@ int main(int argc, char *argv[]) {
         if(odooApi.authenticate()){
             //LOG(INFO) << "Odoo authentication successful for profile " << i  << ": " << configProfile.getName();
             
-            MaventaAPI maventaApi(configProfile.getName());
+            MaventaAPI maventaApi(configProfile.getName(), configProfile.getMaventaUrl());
             if(!maventaApi.tokenValid()) {
                 //LOG(INFO) << "Maventa token not valid for profile " << i << ", authenticating...";
                 bool authok = maventaApi.authenticate(
@@ -160,92 +180,56 @@ int main(int argc, char *argv[]) {
                     continue;       
                 }
             }
-            int senttomaventa = odooApi.processUnsentInvoices([&odooApi, &maventaApi, &configProfile](const rapidjson::Value& entry, std::string odoo_maventa_status, std::string maventa_invoice_identifier, FinvoiceInvoice &invoice, bool &send_confirmed, std::string &send_error_msg) {
-                    // In draft
-                    // "state": "draft", // "posted", "cancelled"
-                    // "status_in_payment": "draft", //"in_payment", "paid", "partial", "reversed", "blocked", "invoicing_legacy", "draft", "cancelled"
-                    // "is_move_sent": false  -> It indicates that the invoice/payment has been sent or the PDF has been generated."
-                    // "is_being_sent": false, -> Is the move being sent asynchronously"
-                    // "move_sent_values": "not_sent", //"sent"
+            // In draft
+            // "state": "draft", // "posted", "cancelled"
+            // "status_in_payment": "draft", //"in_payment", "paid", "partial", "reversed", "blocked", "invoicing_legacy", "draft", "cancelled"
+            // "is_move_sent": false  -> It indicates that the invoice/payment has been sent or the PDF has been generated."
+            // "is_being_sent": false, -> Is the move being sent asynchronously"
+            // "move_sent_values": "not_sent", //"sent"
 
-                    // after verified
-                    // "state": "posted",
-                    // "status_in_payment": "not_paid",
-                    // "is_move_sent": false,
-                    // "is_being_sent": false, 
-                    // "move_sent_values": "not_sent",
+            // after verified
+            // "state": "posted",
+            // "status_in_payment": "not_paid",
+            // "is_move_sent": false,
+            // "is_being_sent": false, 
+            // "move_sent_values": "not_sent",
 
-                    // after sending
-                    // "state": "posted",
-                    // "status_in_payment": "not_paid",
-                    // "is_move_sent": true,
-                    // "move_sent_values": "sent",
+            // after sending
+            // "state": "posted",
+            // "status_in_payment": "not_paid",
+            // "is_move_sent": true,
+            // "move_sent_values": "sent",
 
-                    //SendMaventaInvoice Contexctual action
-                    //record['x_studio_maventa_status']='sending'
-                    //maventa_status:
-                    //"draft" -> "None"  or cannot send, missing information"
-                    //"sending" -> "Waiting to send" (Invoice will be sent via maventa)
-                    
-                    //"senddone" -> "Sent" (Invoice has been sent via maventa)
-                    //"senderror" -> "Send resulted in error" -> more info from invoice.maventa_error
-                    //"missinginfo" -> "Send resulted in missing information check" -> more info from invoice.maventa_error
+            //SendMaventaInvoice Contexctual action
+            //record['x_studio_maventa_status']='sending'
+            //maventa_status:
+            //"draft" -> "None"  or cannot send, missing information"
+            //"sending" -> "Waiting to send" (Invoice will be sent via maventa)
+            
+            //"senddone" -> "Sent" (Invoice has been sent via maventa)
+            //"senderror" -> "Send resulted in error" -> more info from invoice.maventa_error
+            //"missinginfo" -> "Send resulted in missing information check" -> more info from invoice.maventa_error
 
-                    //
-                    //    Initial status="draft"
-                    //   Press send via Maventa ->
-                    //       internal check to see that all info exists
-                    //       if ok, status will be "sending"
-                    //       else alert dialog and status will go back to "draft"
-                    //   once maventa2odoo has picked it up status will be
-                    //       senddone -> if all was ok
-                    //       senderror -> if some error occured
-                    //               -> from here you can go back to draft fix error and resend,
-                    //               -> but how to change maventa_status back to "draft" ????
-                    
-                    if(odoo_maventa_status == "sending" && !maventa_invoice_identifier.empty()){
-                        //means we have sent to maventa but we have not get confirmation yet
-                        std::string status = maventaApi.getInvoiceStatus(maventa_invoice_identifier);
-                        rapidjson::Document stat;
-                        rapidjson::ParseResult iok = stat.Parse(status.c_str());
-                        
-                        //rapidjson::StringBuffer buffer;
-                        //rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-                        //stat.Accept(writer);
-                        //LOG(INFO)<< "buff:" << buffer.GetString();
+            //
+            //    Initial status="draft"
+            //   Press send via Maventa ->
+            //       internal check to see that all info exists
+            //       if ok, status will be "sending"
+            //       else alert dialog and status will go back to "draft"
+            //   once maventa2odoo has picked it up status will be
+            //       senddone -> if all was ok
+            //       senderror -> if some error occured
+            //               -> from here you can go back to draft fix error and resend,
+            //               -> but how to change maventa_status back to "draft" ????
 
-                        if (stat.IsArray()) {
-                            for(int si=0; si < stat.Size(); si++) {
-                                const rapidjson::Value& item = stat[si];
-                                if (item.IsObject() && item.HasMember("type") && item["type"].IsString() ) {
-                                    std::string type = item["type"].GetString();
-                                    if(type == "SENT" && item.HasMember("message") && item["message"].IsNull()) {
-                                        send_confirmed = true;
-                                    }
-                                    if(type == "ERROR" && item.HasMember("message") && item["message"].IsString()) {
-                                        send_error_msg = item["message"].GetString();
-                                    }
-                                }
-                            }
-                        }
-                        // If we reach here, it means the invoice is still being processed
-                        return maventa_invoice_identifier;
-                    }
-                    
-                    int invoiceId = odooApi.OdooInvoiceToFinvoice(entry, invoice);
-                    std::string maventa_invoice_id = maventaApi.uploadInvoice(invoice);
-                    if(maventa_invoice_id.empty() || maventa_invoice_id == "-1") {
-                        send_error_msg = "Failed to upload invoice to Maventa";
-                        LOG(ERROR) << configProfile.getName() << ": Failed to upload invoice " << invoice.InvoiceNumber << " to Maventa";
-                        return std::string("-1");
-                    }
-                    
-                    LOG(INFO) << configProfile.getName() << ": Sales invoice sent to to maventa: " << invoice.InvoiceNumber
-                            << ", Seller: " << invoice.seller.SellerOrganisationName
-                            << ", Buyer: " << invoice.buyer.BuyerOrganisationName
-                            << " maventa_id: " << maventa_invoice_id;
-                    return maventa_invoice_id;
-            }, 7);
+            OutboundPipeline::Workers workers;
+            workers.build = configProfile.getOutboundBuildWorkers();
+            workers.zip = configProfile.getOutboundZipWorkers();
+            workers.upload = configProfile.getOutboundUploadWorkers();
+            workers.write = configProfile.getOutboundWriteWorkers();
+            workers.queue_size = configProfile.getOutboundQueueSize();
+            OutboundPipeline outbound(odooApi, maventaApi, configProfile.getName(), workers);
+            int senttomaventa = outbound.run(7);
             LOG(INFO) << configProfile.getName() << ": Sales invoices sent to maventa: " << std::to_string(senttomaventa);
 
             int importedttoodoo = maventaApi.processReceivedInvoices(configProfile.getName(), [&odooApi](FinvoiceInvoice &invoice) {
@@ -270,4 +254,7 @@ int main(int argc, char *argv[]) {
         }
 
     }
+    LOG(INFO) << "Request statistics:\n" << RequestGovernor::instance().statistics();
+    LOG(INFO) << "Attachment store: " << AttachmentStore::statistics();
+    curl_global_cleanup();
 }
@@ -29,9 +29,57 @@
 #include <rapidjson/writer.h>   
 #include "maventa_invoice.h"
 #include "finvoice_invoice.h"
-#include <iconv.h>
 #include "util.h"
 #include "zipper.h"
+#include "request_governor.h"
+#include "charset.h"
+#include "finvoice_writer.h"
+#include "finvoice_validator.h"
+#include "task_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+
+static void setTimeouts(CURL* curl) {
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 15L);
+    // no overall timeout, large attachments may take long; give up on stalled transfers
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+}
+// Runs the prepared curl handle under the request governor. Transient
+// failures are retried, reset() drops the output of a failed attempt.
+static CURLcode governedPerform(CURL* curl, const std::string& endpoint, bool idempotent, long& http_code, const std::function<void()>& reset) {
+    RequestGovernor& governor = RequestGovernor::instance();
+    for (int attempt = 0; ; attempt++) {
+        GovernedRequest request(endpoint);
+        CURLcode res = curl_easy_perform(curl);
+
+        RequestGovernor::Outcome outcome;
+        http_code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        outcome.http_status = http_code;
+        outcome.transport_error = res != CURLE_OK;
+        curl_off_t retry_after = -1;
+        if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) {
+            outcome.retry_after = static_cast<long>(retry_after);
+        }
+        request.done(outcome);
+
+        // nothing reached the server, so even a POST can be repeated
+        bool not_sent = res == CURLE_COULDNT_CONNECT || res == CURLE_COULDNT_RESOLVE_HOST;
+        if (!governor.shouldRetry(outcome, idempotent || not_sent, attempt)) {
+            if (outcome.transport_error || http_code >= 400) {
+                governor.countFailure(endpoint);
+            }
+            return res;
+        }
+        LOG(INFO) << endpoint << ": transient failure (" << (res != CURLE_OK ? curl_easy_strerror(res) : "HTTP " + std::to_string(http_code)) << "), retrying";
+        governor.countRetry(endpoint);
+        governor.backoff(endpoint, outcome, attempt);
+        reset();
+    }
+}
 
 int MaventaAPI::currentTimestampSeconds() {
     return time(nullptr);
@@ -52,6 +100,7 @@ bool MaventaAPI::saveProfile() {
     layout.AddMember("scope", rapidjson::Value(scope.c_str(), allocator), allocator);
 
     layout.AddMember("expires_at", expires_at, allocator);
+    layout.AddMember("base_url", rapidjson::Value(base_url.c_str(), allocator), allocator);
 
     std::string profile = "/tmp/maventa_api_profile_"+profile_name+".json"; // Example path
     rapidjson::StringBuffer buffer;
@@ -78,6 +127,11 @@ bool MaventaAPI::loadProfile() {
     }
     rapidjson::Document layout;
     rapidjson::ParseResult iok = layout.Parse(profileContent.c_str());
+    if (layout.IsObject() && layout.HasMember("base_url") && layout["base_url"].IsString() && base_url != layout["base_url"].GetString()) {
+        // token was issued by another server (e.g. the mock)
+        LOG(DEBUG) << "Stored token is for " << layout["base_url"].GetString() << ", not loading it for profile: " << profile_name;
+        return false;
+    }
     if (layout.IsObject() && layout.HasMember("expires_at")  && layout["expires_at"].IsInt()) {
         expires_at = layout["expires_at"].GetInt();
     } else {
@@ -105,6 +159,84 @@ bool MaventaAPI::loadProfile() {
     }
     return true;
 }
+std::string httpCacheFile(const std::string& profile_name, const std::string& url) {
+    std::ostringstream name;
+    name << "/tmp/maventa_api_cache_" << profile_name << "_" << std::hex << std::hash<std::string>{}(url) << ".body";
+    return name.str();
+}
+// listing urls carry the start date, yesterday's entries are not asked for again
+const int httpCacheMaxAge = 2 * 24 * 60 * 60;
+const size_t httpCacheMaxEntries = 256;
+bool MaventaAPI::saveHttpCache() {
+    int now = currentTimestampSeconds();
+    std::vector<std::pair<int, std::string>> by_use;
+    for (auto it = http_cache.begin(); it != http_cache.end(); ) {
+        if (now - it->second.used_at > httpCacheMaxAge) {
+            remove(it->second.body_file.c_str());
+            it = http_cache.erase(it);
+        } else {
+            by_use.emplace_back(it->second.used_at, it->first);
+            ++it;
+        }
+    }
+    if (by_use.size() > httpCacheMaxEntries) {
+        std::sort(by_use.begin(), by_use.end());
+        for (size_t i = 0; i < by_use.size() - httpCacheMaxEntries; i++) {
+            auto it = http_cache.find(by_use[i].second);
+            remove(it->second.body_file.c_str());
+            http_cache.erase(it);
+        }
+    }
+
+    rapidjson::Document layout;
+    layout.SetObject();
+    rapidjson::Document::AllocatorType& allocator = layout.GetAllocator();
+
+    for (const auto& kv : http_cache) {
+        rapidjson::Value entry(rapidjson::kObjectType);
+        entry.AddMember("etag", rapidjson::Value(kv.second.etag.c_str(), allocator), allocator);
+        entry.AddMember("last_modified", rapidjson::Value(kv.second.last_modified.c_str(), allocator), allocator);
+        entry.AddMember("body_file", rapidjson::Value(kv.second.body_file.c_str(), allocator), allocator);
+        entry.AddMember("used_at", kv.second.used_at, allocator);
+        layout.AddMember(rapidjson::Value(kv.first.c_str(), allocator), entry, allocator);
+    }
+    std::string cache = "/tmp/maventa_api_http_cache_"+profile_name+".json";
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    layout.Accept(writer);
+    std::string content = buffer.GetString();
+    return WriteFileContent(cache, content, true);
+}
+bool MaventaAPI::loadHttpCache() {
+    if (profile_name.empty()) {
+        return false;
+    }
+    std::string cache = "/tmp/maventa_api_http_cache_"+profile_name+".json";
+    std::string cacheContent = ReadFileContent(cache);
+    if (cacheContent.empty()) {
+        return false;
+    }
+    rapidjson::Document layout;
+    if (layout.Parse(cacheContent.c_str()).HasParseError() || !layout.IsObject()) {
+        LOG(DEBUG) << "Ignoring unreadable http cache for profile: " << profile_name;
+        return false;
+    }
+    for (auto it = layout.MemberBegin(); it != layout.MemberEnd(); ++it) {
+        const rapidjson::Value& entry = it->value;
+        if (!entry.IsObject() || !entry.HasMember("body_file") || !entry["body_file"].IsString()) {
+            continue;
+        }
+        HttpCacheEntry e;
+        if (entry.HasMember("etag") && entry["etag"].IsString()) e.etag = entry["etag"].GetString();
+        if (entry.HasMember("last_modified") && entry["last_modified"].IsString()) e.last_modified = entry["last_modified"].GetString();
+        e.body_file = entry["body_file"].GetString();
+        if (entry.HasMember("used_at") && entry["used_at"].IsInt()) e.used_at = entry["used_at"].GetInt();
+        if (file_exists(e.body_file)) {
+            http_cache[it->name.GetString()] = e;
+        }
+    }
+    return true;
+}
 bool MaventaAPI::tokenValid() {
     if (access_token.empty()) {
         LOG(DEBUG) << "Access token is empty, not valid.";
@@ -125,8 +257,10 @@ bool MaventaAPI::authenticate(const std::string& client_id,
     if (!curl) return "";
 
     std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, "https://ax.maventa.com/oauth2/token");
+    std::string url = base_url + "/oauth2/token";
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
 
     std::string postfields = "grant_type=client_credentials"
                              "&client_id=" + client_id +
@@ -146,8 +280,10 @@ bool MaventaAPI::authenticate(const std::string& client_id,
         return size * nmemb;
     });
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    setTimeouts(curl);
 
-    CURLcode res = curl_easy_perform(curl);
+    long http_code = 0;
+    CURLcode res = governedPerform(curl, "maventa/oauth2", true, http_code, [&response]() { response.clear(); });
     curl_slist_free_all(headers);
     curl_easy_cleanup(curl);
 
@@ -160,7 +296,7 @@ bool MaventaAPI::authenticate(const std::string& client_id,
     // Parse JSON and extract access_token using rapidjson
     rapidjson::Document doc;
     if (doc.Parse(response.c_str()).HasParseError()) {
-        LOG(DEBUG) << "Failed to parse JSON response: " << response << std::endl;
+        LOG(DEBUG) << "Failed to parse JSON response: " << logPayload(LogCategory::Http, response) << std::endl;
         return false;
     }
     if (doc.HasMember("access_token") && doc["access_token"].IsString()) {
@@ -170,83 +306,242 @@ bool MaventaAPI::authenticate(const std::string& client_id,
         expires_in = doc["expires_in"].GetInt();
         expires_at = currentTimestampSeconds() + expires_in;
     } else {
-        LOG(DEBUG) << "No access_token in response: " << response << std::endl;
+        LOG(DEBUG) << "No access_token in response: " << logPayload(LogCategory::Http, response) << std::endl;
         return false;
     }
     return true;
 }
 
-std::string iso_8859_15_to_utf8(const std::string& input) {
-    iconv_t cd = iconv_open("UTF-8", "ISO-8859-15");
-    if (cd == (iconv_t)-1) {
-        LOG(ERROR) << "iconv_open failed for ISO-8859-15 to UTF-8";
-        return input;
+// JSON is UTF-8 unless the server says otherwise in the Content-Type
+static void jsonToUtf8(std::string& json, const std::string& content_type) {
+    Charset charset = charsetFromContentType(content_type);
+    if (charset == Charset::Latin1 || charset == Charset::Latin9) {
+        latinToUtf8InPlace(json, charset);
     }
+}
 
-    size_t inbytesleft = input.size();
-    size_t outbytesleft = inbytesleft * 2 + 1; // UTF-8 may use more bytes
-    std::string output(outbytesleft, 0);
-
-    char* inbuf = const_cast<char*>(input.data());
-    char* outbuf = &output[0];
-    char* outbuf_start = outbuf;
-
-    size_t result = iconv(cd, &inbuf, &inbytesleft, &outbuf, &outbytesleft);
-    if (result == (size_t)-1) {
-        LOG(ERROR) << "iconv conversion failed";
-        iconv_close(cd);
-        return input;
+struct HttpGetHeaders {
+    std::string etag;
+    std::string last_modified;
+};
+static size_t httpGetHeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata) {
+    HttpGetHeaders* hdr = static_cast<HttpGetHeaders*>(userdata);
+    std::string line(buffer, size * nitems);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        std::string value = string_trim(line.substr(colon + 1), " \t\r\n");
+        if (name == "etag") hdr->etag = value;
+        else if (name == "last-modified") hdr->last_modified = value;
     }
-    iconv_close(cd);
-    output.resize(outbuf - outbuf_start);
-    return output;
+    return size * nitems;
 }
-
-int MaventaAPI::processReceivedInvoices(std::string profilename, std::function<bool (FinvoiceInvoice &invoice)> processInvoiceCallback, int lastHowManyDays) {
-   
-    int invoicesAddedCount = 0;
-    if (tokenValid() == false) {
-        LOG(ERROR) << "No access token available for invoice request.";
-        has_error = true;
-        return invoicesAddedCount;
+struct HttpGetSink {
+    CURL* curl;
+    std::string* response;
+    bool reserved;
+};
+static size_t httpGetWriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    HttpGetSink* sink = static_cast<HttpGetSink*>(userdata);
+    if (!sink->reserved) {
+        // headers are in by the time the first body chunk arrives
+        curl_off_t content_length = -1;
+        if (curl_easy_getinfo(sink->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length) == CURLE_OK && content_length > 0) {
+            sink->response->reserve(static_cast<size_t>(content_length));
+        }
+        sink->reserved = true;
+    }
+    sink->response->append(ptr, size * nmemb);
+    return size * nmemb;
+}
+std::string MaventaAPI::httpGet(const std::string& url, std::string* content_type, bool revalidate) {
+    if (access_token.empty()) {
+        LOG(ERROR) << "No access token available for invoice XML request.";
+        return "";
     }
 
     CURL* curl = curl_easy_init();
     if (!curl) {
         LOG(ERROR) << "Failed to initialize CURL";
-        has_error = true;
-        return invoicesAddedCount;
+        return "";
     }
 
-    std::ostringstream url;
-    url << "https://ax.maventa.com/v1/invoices?direction=RECEIVED"
-        <<"&received_at_start=" << timestamp_to_string(currentTimestampSeconds() - 60 * 60 * 24 * lastHowManyDays); // Last 7 days
-        //<< "&page=" << 1
-        //<< "&per_page=" << 100;
-
     std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, url.str().c_str());
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    // empty string enables every content encoding libcurl was built with (gzip, br, ...)
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
 
     struct curl_slist* headers = nullptr;
     headers = curl_slist_append(headers, "accept: application/json");
     std::string auth_header = "Authorization: Bearer " + access_token;
     headers = curl_slist_append(headers, auth_header.c_str());
+
+    auto cached = revalidate ? http_cache.find(url) : http_cache.end();
+    if (cached != http_cache.end()) {
+        if (!cached->second.etag.empty()) {
+            std::string h = "If-None-Match: " + cached->second.etag;
+            headers = curl_slist_append(headers, h.c_str());
+        }
+        if (!cached->second.last_modified.empty()) {
+            std::string h = "If-Modified-Since: " + cached->second.last_modified;
+            headers = curl_slist_append(headers, h.c_str());
+        }
+    }
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
-        std::string* str = static_cast<std::string*>(userdata);
-        str->append(ptr, size * nmemb);
-        return size * nmemb;
+    HttpGetHeaders received;
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, httpGetHeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &received);
+
+    HttpGetSink sink = { curl, &response, false };
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, httpGetWriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+    setTimeouts(curl);
+
+    long http_code = 0;
+    CURLcode res = governedPerform(curl, "maventa/invoices", true, http_code, [&]() {
+        response.clear();
+        sink.reserved = false;
+        received = HttpGetHeaders();
     });
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    char* type = nullptr;
+    if (content_type && res == CURLE_OK && curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &type) == CURLE_OK && type) {
+        *content_type = type;
+    }
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+
+    if (res != CURLE_OK) {
+        LOG(ERROR) << "CURL error: " << curl_easy_strerror(res);
+        return "";
+    }
+    // an error body is not the resource, e.g. the json of a 404
+    if (http_code != 200 && http_code != 304) {
+        LOG(ERROR) << "HTTP " << http_code << " for " << url;
+        return "";
+    }
+    if (http_code == 304 && cached != http_cache.end()) {
+        std::string body = ReadFileContent(cached->second.body_file);
+        if (!body.empty()) {
+            cached->second.used_at = currentTimestampSeconds();
+            return body;
+        }
+        // the local copy is gone, ask for the whole resource again
+        LOG(WARNING) << "Cached body of " << url << " is missing, requesting it again";
+        http_cache.erase(cached);
+        return httpGet(url, content_type, revalidate);
+    }
+    if (http_code == 200) {
+        if (revalidate && (!received.etag.empty() || !received.last_modified.empty())) {
+            HttpCacheEntry entry;
+            entry.etag = received.etag;
+            entry.last_modified = received.last_modified;
+            entry.body_file = httpCacheFile(profile_name, url);
+            entry.used_at = currentTimestampSeconds();
+            if (WriteFileContent(entry.body_file, response, true)) {
+                http_cache[url] = entry;
+            }
+        } else if (cached != http_cache.end()) {
+            remove(cached->second.body_file.c_str());
+            http_cache.erase(cached);
+        }
+    }
+    if(response.empty()) {
+        LOG(ERROR) << "No response received for invoice XML request.";
+        return "";
+    }
+    return response;
+}
+
+struct HttpStreamSink {
+    CURL* curl;
+    const FinvoiceAttachment::ContentSize* size;
+    const FinvoiceAttachment::ContentData* data;
+    bool started; // the body of a 200 is being passed on
+};
+static size_t httpStreamWriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    HttpStreamSink* sink = static_cast<HttpStreamSink*>(userdata);
+    long http_code = 0;
+    curl_easy_getinfo(sink->curl, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code != 200) {
+        // error body, governedPerform judges the status
+        return size * nmemb;
+    }
+    if (!sink->started) {
+        curl_off_t content_length = -1;
+        if (curl_easy_getinfo(sink->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length) != CURLE_OK) {
+            content_length = -1;
+        }
+        (*sink->size)(content_length);
+        sink->started = true;
+    }
+    return (*sink->data)(ptr, size * nmemb) ? size * nmemb : 0;
+}
+bool MaventaAPI::httpGetStream(const std::string& url, const FinvoiceAttachment::ContentSize& size, const FinvoiceAttachment::ContentData& data) {
+    if (access_token.empty()) {
+        LOG(ERROR) << "No access token available for attachment request.";
+        return false;
+    }
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        LOG(ERROR) << "Failed to initialize CURL";
+        return false;
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    // no content encoding, the Content-Length must be the size of the content
+
+    struct curl_slist* headers = nullptr;
+    headers = curl_slist_append(headers, "accept: application/json");
+    std::string auth_header = "Authorization: Bearer " + access_token;
+    headers = curl_slist_append(headers, auth_header.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 
-    CURLcode res = curl_easy_perform(curl);
+    HttpStreamSink sink = { curl, &size, &data, false };
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, httpStreamWriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+    setTimeouts(curl);
+
+    // what was passed on cannot be taken back, so only the attempts that
+    // got no body (429, connect failures) are repeated
+    long http_code = 0;
+    CURLcode res = governedPerform(curl, "maventa/invoices", false, http_code, []() {});
     curl_slist_free_all(headers);
     curl_easy_cleanup(curl);
 
     if (res != CURLE_OK) {
         LOG(ERROR) << "CURL error: " << curl_easy_strerror(res);
+        return false;
+    }
+    if (http_code != 200) {
+        LOG(ERROR) << "HTTP " << http_code << " for " << url;
+        return false;
+    }
+    if (!sink.started) {
+        size(0);
+    }
+    return true;
+}
+
+int MaventaAPI::processReceivedInvoices(std::string profilename, std::function<bool (FinvoiceInvoice &invoice)> processInvoiceCallback, int lastHowManyDays) {
+   
+    int invoicesAddedCount = 0;
+    if (tokenValid() == false) {
+        LOG(ERROR) << "No access token available for invoice request.";
+        has_error = true;
+        return invoicesAddedCount;
+    }
+
+    std::ostringstream url;
+    url << base_url << "/v1/invoices?direction=RECEIVED"
+        <<"&received_at_start=" << timestamp_to_string(currentTimestampSeconds() - 60 * 60 * 24 * lastHowManyDays); // Last 7 days
+        //<< "&page=" << 1
+        //<< "&per_page=" << 100;
+
+    std::string response = httpGet(url.str(), nullptr, true);
+    if (response.empty()) {
         has_error = true;
         return invoicesAddedCount;
     }
@@ -292,6 +587,13 @@ int MaventaAPI::processReceivedInvoices(std::string profilename, std::function<b
         return invoicesAddedCount; // No invoices found, but not an error
     }
     
+    // Attachments are relayed to their destination as they are downloaded
+    // instead of being held in full, which matters for scans of tens of MB
+    auto streamFrom = [this](const std::string& url) {
+        return [this, url](const FinvoiceAttachment::ContentSize& size, const FinvoiceAttachment::ContentData& data) {
+            return httpGetStream(url, size, data);
+        };
+    };
     for (rapidjson::SizeType i = 0; i < doc.Size(); ++i) {
         const rapidjson::Value& invoice = doc[i];
         if (!invoice.IsObject()) {
@@ -329,14 +631,12 @@ int MaventaAPI::processReceivedInvoices(std::string profilename, std::function<b
                         std::string attachment_mime_type = file["mimetype"].GetString();
                         std::string href = file["href"].GetString();
                         //LOG(INFO) << "Found attachment: ID=" << attachment_id << ", Name=" << attachment_name << ", MIME Type=" << attachment_mime_type;
-                        std::string attachment_b64 = getInvoiceAttachment(inv, href);
-                        if(!attachment_b64.empty()) {
-                            FinvoiceAttachment attachment;
-                            attachment.AttachmentName = attachment_name;
-                            attachment.AttachmentMimeType = attachment_mime_type;
-                            attachment.AttachmentContent = attachment_b64;
-                            finvoice_invoice.attachments.push_back(attachment);
-                        }
+                        FinvoiceAttachment attachment;
+                        attachment.AttachmentName = attachment_name;
+                        attachment.AttachmentMimeType = attachment_mime_type;
+                        // downloaded while it is stored, see OdooAPI::createVendorBillAttachment
+                        attachment.contentSource = streamFrom(href);
+                        finvoice_invoice.attachments.push_back(attachment);
                     } else {
                         LOG(ERROR) << "Invalid file object in extended details at index " << i;
                     }
@@ -347,20 +647,19 @@ int MaventaAPI::processReceivedInvoices(std::string profilename, std::function<b
             LOG(ERROR) << "Failed to parse extended details JSON: " << rapidjson::GetParseError_En(doc.GetParseError())
                        << " (offset " << doc.GetErrorOffset() << ")";
         }
-        //lastly get the invoice image
-        std::string invoiceImageb64 = getInvoiceImage(inv);
-        if(!invoiceImageb64.empty()) {
+        //lastly the invoice image
+        {
             FinvoiceAttachment attachment;
             attachment.AttachmentName = "invoice_"+invoice_id+".pdf";
             attachment.AttachmentMimeType = "application/pdf";
-            attachment.AttachmentContent = invoiceImageb64;
+            attachment.contentSource = streamFrom(base_url + "/v1/invoices/" + invoice_id + "?return_format=ORIGINAL_OR_GENERATED_IMAGE");
             finvoice_invoice.attachments.push_back(attachment);
         }
         if(!invoiceXml.empty()) {
             #if 0 // For debugging, save the invoice XML to a file
                 WriteFileContent("/tmp/maventa_invoice_"+invoice_id+".xml", invoiceXml, true);
             #endif 
-            if (!finvoice_invoice.parseFromXml(invoiceXml)) {
+            if (!finvoice_invoice.parseFromXml(std::move(invoiceXml))) {
                 LOG(ERROR) << "Failed to parse invoice ID: " << invoice_id; 
             }
             else {
@@ -378,112 +677,163 @@ int MaventaAPI::processReceivedInvoices(std::string profilename, std::function<b
     }
     return invoicesAddedCount;
 }
-bool MaventaAPI::validateXml(std::string xml_content){
-    return true;
-    /*
-    if (access_token.empty()) {
-        LOG(ERROR) << "No access token available for invoice XML request.";
-        return "";
+bool MaventaAPI::validateXml(const std::string& xml, std::string& error) {
+    std::vector<std::string> errors;
+    if (FinvoiceValidator::validate(xml, errors)) {
+        return true;
+    }
+    error = "Finvoice validation failed: ";
+    for (size_t i = 0; i < errors.size(); ++i) {
+        error += (i ? "; " : "") + errors[i];
     }
+    LOG(ERROR) << error;
+    return false;
+}
+std::string MaventaAPI::getInvoiceStatus(std::string invoice_id) {
+    std::ostringstream url;
+    url << base_url << "/v1/invoices/" << invoice_id << "/actions";
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        LOG(ERROR) << "Failed to initialize CURL";
+    std::string content_type;
+    std::string response = httpGet(url.str(), &content_type, true);
+    if(response.empty()) {
         return "";
     }
+    jsonToUtf8(response, content_type);
+    return response;
+}
 
-     std::string response;
-    std::string url = "https://validator-stage.maventa.com/validate";
-
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "accept: application/json");
-    std::string auth_header = "Authorization: Bearer " + access_token;
-    headers = curl_slist_append(headers, auth_header.c_str());
-
-    // Prepare multipart form
-    curl_mime* mime = curl_mime_init(curl);
-    curl_mimepart* part = curl_mime_addpart(mime);
-    curl_mime_name(part, "file");
-    curl_mime_filename(part, "invoice.xml");
-    curl_mime_data(part, xml_content.c_str(), xml_content.size());
-    curl_mime_type(part, "application/xml");
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_MIMEPOST, mime);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
-        std::string* str = static_cast<std::string*>(userdata);
-        str->append(ptr, size * nmemb);
-        return size * nmemb;
-    });
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-
-    curl_mime_free(mime);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-
-
-    if (res != CURLE_OK) {
-        LOG(ERROR) << "CURL error: " << curl_easy_strerror(res);
-        return false;
-    }
-    if(response.empty()) {
-        LOG(ERROR) << "No response received for invoice XML request.";
-        return false;
+bool MaventaAPI::loadSentInvoiceStatuses(int lastHowManyDays) {
+    sent_statuses_loaded = true;
+    const int per_page = 100;
+    const int max_pages = 50;
+    for (int page = 1; page <= max_pages; page++) {
+        std::ostringstream url;
+        url << base_url << "/v1/invoices?direction=SENT"
+            << "&updated_at_start=" << timestamp_to_string(currentTimestampSeconds() - 60 * 60 * 24 * lastHowManyDays)
+            << "&page=" << page
+            << "&per_page=" << per_page;
+
+        std::string response = httpGet(url.str(), nullptr, true);
+        rapidjson::Document doc;
+        if (response.empty() || doc.Parse(response.c_str()).HasParseError() || !doc.IsArray()) {
+            LOG(ERROR) << "Failed to list sent invoices, page " << page;
+            return false;
+        }
+        for (rapidjson::SizeType i = 0; i < doc.Size(); ++i) {
+            const rapidjson::Value& invoice = doc[i];
+            if (invoice.IsObject() && invoice.HasMember("id") && invoice["id"].IsString() &&
+                invoice.HasMember("status") && invoice["status"].IsString()) {
+                sent_statuses[invoice["id"].GetString()] = invoice["status"].GetString();
+            }
+        }
+        if (doc.Size() < per_page) {
+            break;
+        }
     }
-    response = iso_8859_15_to_utf8(response);
-    LOG(DEBUG) << "response " << response;
+    //LOG(DEBUG) << "Sent invoices listed: " << sent_statuses.size();
     return true;
-    */
 }
-std::string MaventaAPI::getInvoiceStatus(std::string invoice_id) {
-    if (access_token.empty()) {
-        LOG(ERROR) << "No access token available for invoice XML request.";
-        return "";
-    }
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        LOG(ERROR) << "Failed to initialize CURL";
-        return "";
+bool MaventaAPI::getSentInvoiceStatus(const std::string& invoice_id, bool& send_confirmed, std::string& send_error_msg, int lastHowManyDays) {
+    if (!sent_statuses_loaded) {
+        loadSentInvoiceStatuses(lastHowManyDays);
+    }
+    int now = currentTimestampSeconds();
+    auto listed = sent_statuses.find(invoice_id);
+    if (listed != sent_statuses.end() && listed->second == "SENT") {
+        send_confirmed = true;
+        status_polls.erase(invoice_id);
+        return true;
     }
 
-    std::ostringstream url;
-    url << "https://ax.maventa.com/v1/invoices/" << invoice_id << "/actions";
-
-    std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, url.str().c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
-
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "accept: application/json");
-    std::string auth_header = "Authorization: Bearer " + access_token;
-    headers = curl_slist_append(headers, auth_header.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    // Not settled by the listing. Errors are fetched right away for the
+    // message, everything else is polled less often the older it gets.
+    bool failed = listed != sent_statuses.end() && listed->second == "ERROR";
+    StatusPoll& poll = status_polls[invoice_id];
+    if (poll.first_seen == 0) {
+        poll.first_seen = now;
+    }
+    if (!failed && now < poll.next_poll) {
+        return false;
+    }
 
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
-        std::string* str = static_cast<std::string*>(userdata);
-        str->append(ptr, size * nmemb);
-        return size * nmemb;
-    });
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    std::string status = getInvoiceStatus(invoice_id);
+    rapidjson::Document stat;
+    stat.Parse(status.c_str());
+    if (stat.IsArray()) {
+        for (rapidjson::SizeType si = 0; si < stat.Size(); si++) {
+            const rapidjson::Value& item = stat[si];
+            if (item.IsObject() && item.HasMember("type") && item["type"].IsString()) {
+                std::string type = item["type"].GetString();
+                if (type == "SENT" && item.HasMember("message") && item["message"].IsNull()) {
+                    send_confirmed = true;
+                }
+                if (type == "ERROR" && item.HasMember("message") && item["message"].IsString()) {
+                    send_error_msg = item["message"].GetString();
+                }
+            }
+        }
+    }
+    if (send_confirmed || !send_error_msg.empty()) {
+        status_polls.erase(invoice_id);
+        return true;
+    }
+    // interval doubles with every poll: 5 min, 10 min, 20 min ... up to a day
+    int interval = 300 << std::min(poll.polls, 8);
+    poll.polls++;
+    poll.next_poll = now + std::min(interval, 60 * 60 * 24);
+    return true;
+}
 
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+bool MaventaAPI::saveStatusPolls() {
+    rapidjson::Document layout;
+    layout.SetObject();
+    rapidjson::Document::AllocatorType& allocator = layout.GetAllocator();
 
-    if (res != CURLE_OK) {
-        LOG(ERROR) << "CURL error: " << curl_easy_strerror(res);
-        return "";
+    int expired = currentTimestampSeconds() - 60 * 60 * 24 * 90;
+    for (const auto& kv : status_polls) {
+        if (kv.second.first_seen < expired) {
+            continue; // no longer pending in odoo
+        }
+        rapidjson::Value entry(rapidjson::kObjectType);
+        entry.AddMember("first_seen", kv.second.first_seen, allocator);
+        entry.AddMember("polls", kv.second.polls, allocator);
+        entry.AddMember("next_poll", kv.second.next_poll, allocator);
+        layout.AddMember(rapidjson::Value(kv.first.c_str(), allocator), entry, allocator);
     }
-    if(response.empty()) {
-        LOG(ERROR) << "No response received for invoice XML request.";
-        return "";
+    std::string polls = "/tmp/maventa_api_status_polls_"+profile_name+".json";
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    layout.Accept(writer);
+    std::string content = buffer.GetString();
+    return WriteFileContent(polls, content, true);
+}
+bool MaventaAPI::loadStatusPolls() {
+    if (profile_name.empty()) {
+        return false;
+    }
+    std::string polls = "/tmp/maventa_api_status_polls_"+profile_name+".json";
+    std::string pollsContent = ReadFileContent(polls);
+    if (pollsContent.empty()) {
+        return false;
+    }
+    rapidjson::Document layout;
+    if (layout.Parse(pollsContent.c_str()).HasParseError() || !layout.IsObject()) {
+        LOG(DEBUG) << "Ignoring unreadable status poll schedule for profile: " << profile_name;
+        return false;
+    }
+    for (auto it = layout.MemberBegin(); it != layout.MemberEnd(); ++it) {
+        const rapidjson::Value& entry = it->value;
+        if (!entry.IsObject()) {
+            continue;
+        }
+        StatusPoll poll;
+        if (entry.HasMember("first_seen") && entry["first_seen"].IsInt()) poll.first_seen = entry["first_seen"].GetInt();
+        if (entry.HasMember("polls") && entry["polls"].IsInt()) poll.polls = entry["polls"].GetInt();
+        if (entry.HasMember("next_poll") && entry["next_poll"].IsInt()) poll.next_poll = entry["next_poll"].GetInt();
+        status_polls[it->name.GetString()] = poll;
     }
-    return iso_8859_15_to_utf8(response);
+    return true;
 }
 
 static
@@ -558,7 +908,29 @@ int my_trace(CURL *handle, curl_infotype type,
   return 0;
 }
  
-std::string MaventaAPI::sendFile(std::string xml_content, std::string filename, std::string mimetype){
+// Source of a multipart part served straight from a caller owned buffer
+struct MimeSource {
+    const std::string* data;
+    size_t offset;
+};
+static size_t mimeReadCallback(char* buffer, size_t size, size_t nitems, void* arg) {
+    MimeSource* src = static_cast<MimeSource*>(arg);
+    size_t len = std::min(size * nitems, src->data->size() - src->offset);
+    memcpy(buffer, src->data->data() + src->offset, len);
+    src->offset += len;
+    return len;
+}
+static int mimeSeekCallback(void* arg, curl_off_t offset, int origin) {
+    // curl rewinds the part when a request is repeated
+    MimeSource* src = static_cast<MimeSource*>(arg);
+    if (origin != SEEK_SET || offset < 0 || static_cast<size_t>(offset) > src->data->size()) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    src->offset = static_cast<size_t>(offset);
+    return CURL_SEEKFUNC_OK;
+}
+
+std::string MaventaAPI::sendFile(const std::string& content, std::string filename, std::string mimetype){
     if (access_token.empty()) {
         LOG(ERROR) << "No access token available for invoice XML request.";
         return "";
@@ -573,7 +945,7 @@ std::string MaventaAPI::sendFile(std::string xml_content, std::string filename,
         return "";
     }
     std::string response;
-    std::string url = "https://ax.maventa.com/v1/invoices";
+    std::string url = base_url + "/v1/invoices";
 
     struct curl_slist* headers = nullptr;
     headers = curl_slist_append(headers, "accept: application/json");
@@ -586,7 +958,9 @@ std::string MaventaAPI::sendFile(std::string xml_content, std::string filename,
     curl_mimepart* part = curl_mime_addpart(mime);
     curl_mime_name(part, "file");
     curl_mime_filename(part, filename.c_str());
-    curl_mime_data(part, xml_content.c_str(), xml_content.size());
+    // curl_mime_data would copy the whole payload, let curl read it in place instead
+    MimeSource source = { &content, 0 };
+    curl_mime_data_cb(part, static_cast<curl_off_t>(content.size()), mimeReadCallback, mimeSeekCallback, nullptr, &source);
     curl_mime_type(part, mimetype.c_str());
 /*
     if(attachments.size()>0) {
@@ -607,6 +981,7 @@ std::string MaventaAPI::sendFile(std::string xml_content, std::string filename,
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_MIMEPOST, mime);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
 
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
         std::string* str = static_cast<std::string*>(userdata);
@@ -614,8 +989,16 @@ std::string MaventaAPI::sendFile(std::string xml_content, std::string filename,
         return size * nmemb;
     });
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
+    setTimeouts(curl);
+
+    // not idempotent, a repeated upload would create a second invoice
+    long http_code = 0;
+    CURLcode res = governedPerform(curl, "maventa/upload", false, http_code, [&response]() { response.clear(); });
+    char* type = nullptr;
+    std::string content_type;
+    if (res == CURLE_OK && curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &type) == CURLE_OK && type) {
+        content_type = type;
+    }
 
     curl_mime_free(mime);
     curl_slist_free_all(headers);
@@ -629,249 +1012,176 @@ std::string MaventaAPI::sendFile(std::string xml_content, std::string filename,
         LOG(ERROR) << "No response received for invoice XML request.";
         return "";
     }
-    response = iso_8859_15_to_utf8(response);
+    jsonToUtf8(response, content_type);
     return response;
 }
-std::string MaventaAPI::getInvoiceImage(MaventaInvoice & inv) {
-    if (access_token.empty()) {
-        LOG(ERROR) << "No access token available for invoice XML request.";
-        return "";
-    }
-
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        LOG(ERROR) << "Failed to initialize CURL";
-        return "";
-    }
-
-    std::ostringstream url;
-    //url << "https://ax.maventa.com/v1/invoices/" << inv.getId() << "/attachments/" << attachment_id;
-    url << "https://ax.maventa.com/v1/invoices/" << inv.getId() << "?return_format=ORIGINAL_OR_GENERATED_IMAGE";
-
-    std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, url.str().c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
-
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "accept: application/json");
-    std::string auth_header = "Authorization: Bearer " + access_token;
-    headers = curl_slist_append(headers, auth_header.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
-        std::string* str = static_cast<std::string*>(userdata);
-        str->append(ptr, size * nmemb);
-        return size * nmemb;
-    });
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-
-    if (res != CURLE_OK) {
-        LOG(ERROR) << "CURL error: " << curl_easy_strerror(res);
-        return "";
-    }
-    if(response.empty()) {
-        LOG(ERROR) << "No response received for invoice XML request.";
-        return "";
-    }
-    //LOG(INFO) << "Attachment response: " << response;
-    return base64_encode(response);
-}
-std::string MaventaAPI::getInvoiceAttachment(MaventaInvoice & inv, std::string href) {
-    if (access_token.empty()) {
-        LOG(ERROR) << "No access token available for invoice XML request.";
-        return "";
-    }
-
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        LOG(ERROR) << "Failed to initialize CURL";
-        return "";
-    }
-
-    std::ostringstream url;
-    //href example "https://ax.maventa.com/v1/invoices/25189cf0-4b3c-4c1b-952d-35b162171042/files/8cadd442-0211-47f9-83a7-c025796581d8;
-    url << href;
-
-    std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, url.str().c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
-
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "accept: application/json");
-    std::string auth_header = "Authorization: Bearer " + access_token;
-    headers = curl_slist_append(headers, auth_header.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
-        std::string* str = static_cast<std::string*>(userdata);
-        str->append(ptr, size * nmemb);
-        return size * nmemb;
-    });
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-
-    if (res != CURLE_OK) {
-        LOG(ERROR) << "CURL error: " << curl_easy_strerror(res);
-        return "";
-    }
-    if(response.empty()) {
-        LOG(ERROR) << "No response received for invoice XML request.";
-        return "";
-    }
-    //LOG(INFO) << "Attachment response: " << response;
-    return base64_encode(response);
-}
 std::string MaventaAPI::getExtendedDetails(MaventaInvoice & inv) {
-    if (access_token.empty()) {
-        LOG(ERROR) << "No access token available for invoice XML request.";
-        return "";
-    }
-
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        LOG(ERROR) << "Failed to initialize CURL";
-        return "";
-    }
-
     std::ostringstream url;
     //url << "https://ax.maventa.com/v1/invoices/" << inv.getId() << "/attachments/" << attachment_id;
-    url << "https://ax.maventa.com/v1/invoices/" << inv.getId() << "?return_format=EXTENDED_DETAILS";
-
-    std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, url.str().c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
-
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "accept: application/json");
-    std::string auth_header = "Authorization: Bearer " + access_token;
-    headers = curl_slist_append(headers, auth_header.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
-        std::string* str = static_cast<std::string*>(userdata);
-        str->append(ptr, size * nmemb);
-        return size * nmemb;
-    });
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    url << base_url << "/v1/invoices/" << inv.getId() << "?return_format=EXTENDED_DETAILS";
 
-    if (res != CURLE_OK) {
-        LOG(ERROR) << "CURL error: " << curl_easy_strerror(res);
-        return "";
-    }
-    if(response.empty()) {
-        LOG(ERROR) << "No response received for invoice XML request.";
-        return "";
-    }
     //LOG(INFO) << "Attachment response: " << response;
-    return response;
+    return httpGet(url.str());
 }
 std::string MaventaAPI::getInvoiceXml(MaventaInvoice& inv) {
-    if (access_token.empty()) {
-        LOG(ERROR) << "No access token available for invoice XML request.";
-        return "";
-    }
-
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        LOG(ERROR) << "Failed to initialize CURL";
-        return "";
-    }
-
     std::ostringstream url;
-    url << "https://ax.maventa.com/v1/invoices/" << inv.getId() << "?return_format=FINVOICE30";
+    url << base_url << "/v1/invoices/" << inv.getId() << "?return_format=FINVOICE30";
 
-    std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, url.str().c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
-
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "accept: application/json");
-    std::string auth_header = "Authorization: Bearer " + access_token;
-    headers = curl_slist_append(headers, auth_header.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
-        std::string* str = static_cast<std::string*>(userdata);
-        str->append(ptr, size * nmemb);
-        return size * nmemb;
-    });
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-
-    if (res != CURLE_OK) {
-        LOG(ERROR) << "CURL error: " << curl_easy_strerror(res);
-        return "";
-    }
+    std::string content_type;
+    std::string response = httpGet(url.str(), &content_type);
     if(response.empty()) {
-        LOG(ERROR) << "No response received for invoice XML request.";
         return "";
     }
-    //hack
-    if( response.find("iso_8859") != std::string::npos ||
-        response.find("ISO_8859") != std::string::npos ||
-        response.find("iso-8859") != std::string::npos ||
-        response.find("ISO-8859") != std::string::npos 
-    ) {
-        return iso_8859_15_to_utf8(response);
+    if (!xmlToUtf8(response, content_type)) {
+        LOG(WARNING) << "Unsupported charset in invoice " << inv.getId() << " (" << content_type << "), kept as is";
     }
     return response;
 }
-std::string MaventaAPI::uploadInvoice(FinvoiceInvoice &invoice) {
+void MaventaAPI::buildInvoiceXml(FinvoiceInvoice &invoice, std::string &soap, std::string &xml) {
     invoice.messageId = generateRandomMessageId();
+    xml.clear();
+    soap.clear();
+    FinvoiceWriter(xml).finvoiceMessage(invoice);
+    FinvoiceWriter(soap).envelope(invoice);
+}
 
-    std::vector<FinvoiceAttachment> files;
-    std::string xml = invoice.getXmlFinvoiceMessage(invoice.attachments);
-    std::string soap = invoice.getXmlFinvoiceEnvelopeHeader();
-    std::string content = soap + xml;
-
-    //add all files to a zip file
-    std::stringstream buffer;
-    zipper::Zipper zipper(buffer);
-    std::istringstream stream_content(content); 
+bool MaventaAPI::zipInvoice(const FinvoiceInvoice &invoice, const std::string &soap, const std::string &xml, std::string &zip_content, TaskPool *deflatePool) {
+    //add all files to a zip file, the archive is the only full copy of the payload
     std::tm tm{};
     std::mktime(&tm);
 
-    bool ok = zipper.add(stream_content, tm, "invoice.xml");
+    // Attachments are decoded slice by slice. The compression of each one is
+    // chosen from its mime type and first slice: already compressed ones are
+    // stored, straight into the archive, the others are deflated apart, by
+    // the calling thread and the threads of deflatePool, and copied into the
+    // archive in order.
+    const size_t slice = 64 * 1024;
+    auto decodeAttachment = [&](const FinvoiceAttachment& attachment, const std::function<bool (const std::string&)>& sink) {
+        AttachmentContent::View view = attachment.AttachmentContent.view();
+        if(!view.ok()) {
+            LOG(ERROR) << "Attachment " << attachment.AttachmentName << " could not be read";
+            return false;
+        }
+        std::string_view content = view.text();
+        std::string decoded;
+        decoded.reserve(slice);
+        bool ok = true;
+        try {
+            // the secure hash is taken over the base64 text while it is in cache anyway
+            bool hashing = attachment.contentHash.empty();
+            SecureHash hash;
+            Base64Decoder decoder(decoded);
+            for(size_t pos = 0; ok && pos < content.size(); pos += slice) {
+                size_t len = std::min(slice, content.size() - pos);
+                decoded.clear();
+                decoder.update(content.data() + pos, len);
+                if(hashing) {
+                    hash.update(content.data() + pos, len);
+                }
+                ok = sink(decoded);
+            }
+            if(ok && hashing) {
+                attachment.contentHash = hash.hexDigest();
+                attachment.contentHashAlgorithm = SecureHash::Sha1;
+            }
+        } catch (const std::invalid_argument& e) {
+            LOG(ERROR) << "Attachment " << attachment.AttachmentName << ": " << e.what();
+            ok = false;
+        }
+        return ok;
+    };
+    auto compressionFor = [&](const FinvoiceAttachment& attachment) {
+        std::string sample;
+        try {
+            AttachmentContent::View view = attachment.AttachmentContent.view();
+            Base64Decoder(sample).update(view.data(), std::min(slice, view.size()));
+        } catch (const std::invalid_argument&) {
+            // reported when the attachment is decoded
+        }
+        return zipper::Zipper::compressionFor(attachment.AttachmentMimeType, sample.data(), sample.size());
+    };
+
+    size_t count = invoice.attachments.size();
+    std::vector<zipper::Zipper::DeflatedEntry> deflated(count);
+    enum { Stored, Deflated, Failed };
+    std::vector<char> state(count, Stored);
+    std::atomic<size_t> next{0};
+    auto deflateWorker = [&]() {
+        for(size_t i; (i = next++) < count; ) {
+            const FinvoiceAttachment& attachment = invoice.attachments[i];
+            zipper::Zipper::zipFlags flags = compressionFor(attachment);
+            if(flags == zipper::Zipper::zipFlags::Store) {
+                continue;
+            }
+            zipper::Zipper::DeflatedEntry& entry = deflated[i];
+            entry.nameInZip = attachment.AttachmentName;
+            entry.timestamp = tm;
+            zipper::Zipper::Deflater deflater(entry, flags);
+            bool ok = decodeAttachment(attachment, [&](const std::string& data) {
+                return deflater.write(data.data(), data.size());
+            }) && deflater.finish();
+            state[i] = ok ? Deflated : Failed;
+            if(!ok) {
+                std::string().swap(entry.data);
+            }
+        }
+    };
+    // helpers that start after the caller took the last entry find nothing left
+    size_t helpers = deflatePool ? std::min(count > 0 ? count - 1 : 0, deflatePool->size()) : 0;
+    std::vector<std::future<void>> helping;
+    for(size_t h = 0; h < helpers; h++) {
+        helping.push_back(deflatePool->submit(deflateWorker));
+    }
+    deflateWorker();
+    for(auto& done : helping) {
+        done.wait();
+    }
+
+    // the archive is written into one buffer sized from what goes into it,
+    // close(zip_content) moves it out
+    size_t content = soap.size() + xml.size();
+    for(size_t i=0; i<count; i++) {
+        content += state[i] == Deflated ? deflated[i].data.size() : invoice.attachments[i].AttachmentContent.size() / 4 * 3;
+    }
+    zipper::Zipper zipper(zipper::Zipper::archiveSize(content, count + 1));
+    bool ok = zipper.openEntry(tm, "invoice.xml") &&
+              zipper.writeEntry(soap.data(), soap.size()) &&
+              zipper.writeEntry(xml.data(), xml.size()) &&
+              zipper.closeEntry();
     if(!ok) {
         LOG(ERROR) << "Failed to add invoice.xml to zip";
-        return std::string("-1");
+        return false;
     }
-
-    for(size_t i=0; i<invoice.attachments.size(); i++) {
-        auto attachment = invoice.attachments[i];
-        std::string decoded = base64_decode(attachment.AttachmentContent);
-        std::istringstream stream_attachment(decoded); 
-        ok = zipper.add(stream_attachment, tm, attachment.AttachmentName);
+    for(size_t i=0; i<count; i++) {
+        const FinvoiceAttachment& attachment = invoice.attachments[i];
+        if(state[i] == Stored) {
+            ok = zipper.openEntry(tm, attachment.AttachmentName, zipper::Zipper::zipFlags::Store) &&
+                 decodeAttachment(attachment, [&](const std::string& data) {
+                     return zipper.writeEntry(data.data(), data.size());
+                 }) &&
+                 zipper.closeEntry();
+        } else {
+            ok = state[i] == Deflated && zipper.addDeflated(deflated[i]);
+            // the archive has its copy now
+            std::string().swap(deflated[i].data);
+        }
         if(!ok) {
             LOG(ERROR) << "Failed to add " << attachment.AttachmentName << " to zip";
-            return std::string("-1");
-        }   
+            return false;
+        }
     }
-    zipper.close();
-    
-    std::string zip_content = buffer.str();
+    zipper.close(zip_content);
     //WriteFileContent("/tmp/finvoice.zip", zip_content, true);
-    
+    return true;
+}
+
+std::string MaventaAPI::uploadInvoiceZip(const std::string &zip_content) {
     std::string invresult = sendFile(zip_content, "finvoice.zip", "application/zip");
     rapidjson::Document resp;
     rapidjson::ParseResult iok = resp.Parse(invresult.c_str());     
 
     if (!resp.IsObject() || !resp.HasMember("id") || !resp["id"].IsString()) {
-        LOG(ERROR) << "Invalid return from uploadInvoice: " << invresult;
+        LOG(ERROR) << "Invalid return from uploadInvoice: " << logPayload(LogCategory::Http, invresult);
         return std::string("-1");
     }
     std::string maventa_invoice_id = resp["id"].GetString();
@@ -879,3 +1189,16 @@ std::string MaventaAPI::uploadInvoice(FinvoiceInvoice &invoice) {
     return maventa_invoice_id;
        
 }
+
+std::string MaventaAPI::uploadInvoice(FinvoiceInvoice &invoice) {
+    std::string soap, xml, zip_content;
+    buildInvoiceXml(invoice, soap, xml);
+    std::string error;
+    if(!validateXml(xml, error)) {
+        return std::string("-1");
+    }
+    if(!zipInvoice(invoice, soap, xml, zip_content)) {
+        return std::string("-1");
+    }
+    return uploadInvoiceZip(zip_content);
+}
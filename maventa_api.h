@@ -22,45 +22,107 @@
 #pragma once
 #include <string>
 #include <functional>
+#include <map>
 #include "maventa_invoice.h"
 #include "finvoice_invoice.h"
 
+class TaskPool;
+
 class MaventaAPI {
     std::string profile_name;
+    std::string base_url; // e.g. "https://ax.maventa.com", no trailing slash
     std::string access_token;
     std::string token_type; // e.g., "Bearer"
     std::string scope; // e.g., "read write"
     int expires_in; // in seconds
     int expires_at; // timestamp when the token expires
 
+    // Validators of the last 200 response per url, replayed as
+    // If-None-Match / If-Modified-Since so unchanged resources return 304.
+    // Only the small JSON resources polled run after run are kept, entries
+    // not used for a while are dropped with their body when saved.
+    struct HttpCacheEntry {
+        std::string etag;
+        std::string last_modified;
+        std::string body_file; // local copy of the body served on 304
+        int used_at = 0;       // when last stored or served
+    };
+    std::map<std::string, HttpCacheEntry> http_cache;
+
+    // Sent invoice reconciliation: statuses from the paged SENT listing, and
+    // the poll schedule of invoices the listing did not settle
+    struct StatusPoll {
+        int first_seen = 0;
+        int polls = 0;
+        int next_poll = 0;
+    };
+    std::map<std::string, std::string> sent_statuses; // invoice id -> listing status
+    bool sent_statuses_loaded = false;
+    std::map<std::string, StatusPoll> status_polls;
+
     int currentTimestampSeconds();
     bool loadProfile();
     bool saveProfile();
+    bool loadHttpCache();
+    bool saveHttpCache();
+    bool loadStatusPolls();
+    bool saveStatusPolls();
+    bool loadSentInvoiceStatuses(int lastHowManyDays);
     bool has_error = false;
 
-    std::string sendFile(std::string xml, std::string filename="invoice.xml", std::string mimetype="application/xml");
-    bool validateXml(std::string xml);
+    // content_type receives the Content-Type of a fresh (not 304) response,
+    // revalidate=true keeps the body in the http cache for the next poll
+    std::string httpGet(const std::string& url, std::string* content_type = nullptr, bool revalidate = false);
+
+    // Passes the body of url on to data as it is received, without keeping
+    // or caching it; the contentSource of received attachments
+    bool httpGetStream(const std::string& url, const FinvoiceAttachment::ContentSize& size, const FinvoiceAttachment::ContentData& data);
+
+    // content is streamed to curl from the caller's buffer, it must outlive the call
+    std::string sendFile(const std::string& content, std::string filename="invoice.xml", std::string mimetype="application/xml");
 public:
-    MaventaAPI(std::string profileName):
+    MaventaAPI(std::string profileName, std::string baseUrl = "https://ax.maventa.com"):
         profile_name(profileName),
+        base_url(baseUrl),
         access_token(""),
         token_type(""),
         scope(""),
         expires_in(0) {
+            while (!base_url.empty() && base_url.back() == '/') {
+                base_url.pop_back();
+            }
             loadProfile();
+            loadHttpCache();
+            loadStatusPolls();
         }
     ~MaventaAPI() {
         saveProfile();
+        saveHttpCache();
+        saveStatusPolls();
     }
     bool tokenValid();
     bool authenticate(const std::string& client_id,
                                          const std::string& client_secret,
                                          const std::string& vendor_api_key);
     std::string uploadInvoice(FinvoiceInvoice &invoice);
+    // The steps of uploadInvoice, run as separate stages by the outbound pipeline.
+    // They do not touch the http cache and can run concurrently.
+    void buildInvoiceXml(FinvoiceInvoice &invoice, std::string &soap, std::string &xml);
+    // Checks the message against the Finvoice 3.0 rules offline, error
+    // receives the violations found
+    bool validateXml(const std::string& xml, std::string& error);
+    // deflatePool, when given, compresses independent attachments side by side
+    bool zipInvoice(const FinvoiceInvoice &invoice, const std::string &soap, const std::string &xml, std::string &zip_content, TaskPool *deflatePool = nullptr);
+    std::string uploadInvoiceZip(const std::string &zip_content);
+    // The attachments of the invoices passed to the callback have no
+    // AttachmentContent, their contentSource downloads them and is valid
+    // during the callback
     int processReceivedInvoices(std::string profilename, std::function<bool (FinvoiceInvoice &invoice)> processInvoiceCallback, int lastHowManyDays=7);
     std::string getInvoiceXml(MaventaInvoice & inv);
-    std::string getInvoiceImage(MaventaInvoice & inv);
-    std::string getInvoiceAttachment(MaventaInvoice & inv, std::string href);
     std::string getExtendedDetails(MaventaInvoice & inv);
     std::string getInvoiceStatus(std::string invoice_id);
+    // Resolves the delivery state of an uploaded invoice from the SENT listing,
+    // polling the invoice actions only for the ones the listing leaves open.
+    // Returns false when the invoice was not due for an individual poll.
+    bool getSentInvoiceStatus(const std::string& invoice_id, bool& send_confirmed, std::string& send_error_msg, int lastHowManyDays=7);
 };
\ No newline at end of file
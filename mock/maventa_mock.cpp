@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+// Local stand-in for the Maventa AX API, see mock/README.md
+#include "mock_http_server.h"
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static std::string fixtureDir = "mock/fixtures/maventa";
+static std::mutex uploadedMutex;
+static std::map<std::string, size_t> uploaded; // invoice id -> zip size
+static std::atomic<long> uploadCounter{0};
+
+static bool readFile(const fs::path& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+static void notFound(MockResponse& resp) {
+    resp.status = 404;
+    resp.body = "{\"code\":\"not_found\",\"message\":\"Not found\"}";
+}
+static std::string replaceAll(std::string s, const std::string& from, const std::string& to) {
+    for (size_t pos = s.find(from); pos != std::string::npos; pos = s.find(from, pos + to.size())) {
+        s.replace(pos, from.size(), to);
+    }
+    return s;
+}
+
+static void listInvoices(const MockRequest& req, MockResponse& resp) {
+    std::string direction = req.query.count("direction") ? req.query.at("direction") : "";
+    int page = req.query.count("page") ? std::max(1, atoi(req.query.at("page").c_str())) : 1;
+    int per_page = req.query.count("per_page") ? std::max(1, atoi(req.query.at("per_page").c_str())) : 100;
+
+    rapidjson::Document all;
+    all.SetArray();
+    auto& allocator = all.GetAllocator();
+    std::error_code ec;
+    std::vector<fs::path> dirs;
+    for (const auto& entry : fs::directory_iterator(fixtureDir + "/invoices", ec)) {
+        dirs.push_back(entry.path());
+    }
+    std::sort(dirs.begin(), dirs.end());
+    for (const auto& dir : dirs) {
+        std::string meta;
+        rapidjson::Document doc;
+        if (!readFile(dir / "meta.json", meta) || doc.Parse(meta.c_str()).HasParseError() || !doc.IsObject()) {
+            continue;
+        }
+        std::string dir_direction = doc.HasMember("direction") && doc["direction"].IsString() ? doc["direction"].GetString() : "RECEIVED";
+        if (!direction.empty() && direction != dir_direction) {
+            continue;
+        }
+        if (!doc.HasMember("id")) {
+            doc.AddMember("id", rapidjson::Value(dir.filename().string().c_str(), doc.GetAllocator()), doc.GetAllocator());
+        }
+        rapidjson::Value copy(doc, allocator);
+        all.PushBack(copy, allocator);
+    }
+    if (direction.empty() || direction == "SENT") {
+        std::lock_guard<std::mutex> lock(uploadedMutex);
+        for (const auto& kv : uploaded) {
+            rapidjson::Value inv(rapidjson::kObjectType);
+            inv.AddMember("id", rapidjson::Value(kv.first.c_str(), allocator), allocator);
+            inv.AddMember("status", "SENT", allocator);
+            inv.AddMember("direction", "SENT", allocator);
+            all.PushBack(inv, allocator);
+        }
+    }
+
+    rapidjson::Document out;
+    out.SetArray();
+    size_t first = static_cast<size_t>(page - 1) * per_page;
+    for (size_t i = first; i < all.Size() && i < first + per_page; i++) {
+        out.PushBack(rapidjson::Value(all[static_cast<rapidjson::SizeType>(i)], out.GetAllocator()), out.GetAllocator());
+    }
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    out.Accept(writer);
+    resp.body = buffer.GetString();
+    resp.headers["X-Total-Count"] = std::to_string(all.Size());
+}
+
+static void getInvoice(const MockRequest& req, MockResponse& resp, const std::string& id, const std::string& rest, const std::string& base_url) {
+    fs::path dir = fs::path(fixtureDir) / "invoices" / id;
+    if (rest == "actions") {
+        {
+            std::lock_guard<std::mutex> lock(uploadedMutex);
+            if (uploaded.count(id)) {
+                resp.body = "[{\"type\":\"SENT\",\"message\":null}]";
+                return;
+            }
+        }
+        if (!fs::exists(dir)) {
+            notFound(resp);
+        } else if (!readFile(dir / "actions.json", resp.body)) {
+            resp.body = "[{\"type\":\"SENT\",\"message\":null}]";
+        }
+        return;
+    }
+    if (rest.rfind("files/", 0) == 0) {
+        std::string file = rest.substr(6);
+        if (file.find("..") != std::string::npos || !readFile(dir / "files" / file, resp.body)) {
+            notFound(resp);
+        }
+        resp.content_type = "application/octet-stream";
+        return;
+    }
+    std::string format = req.query.count("return_format") ? req.query.at("return_format") : "";
+    bool ok;
+    if (format == "FINVOICE30") {
+        ok = readFile(dir / "finvoice.xml", resp.body);
+        resp.content_type = "application/xml";
+    } else if (format == "EXTENDED_DETAILS") {
+        ok = readFile(dir / "details.json", resp.body);
+        // hrefs in the fixture point back to this server
+        resp.body = replaceAll(resp.body, "{base_url}", base_url);
+    } else if (format == "ORIGINAL_OR_GENERATED_IMAGE") {
+        ok = readFile(dir / "image.pdf", resp.body);
+        resp.content_type = "application/pdf";
+    } else {
+        ok = readFile(dir / "meta.json", resp.body);
+    }
+    if (!ok) {
+        notFound(resp);
+    }
+}
+
+static void handle(const MockHttpServer& server, const MockRequest& req, MockResponse& resp) {
+    if (req.path == "/oauth2/token") {
+        if (req.method != "POST") {
+            resp.status = 405;
+            return;
+        }
+        resp.body = "{\"access_token\":\"mock-token\",\"token_type\":\"Bearer\",\"expires_in\":3600,"
+                    "\"scope\":\"eui global company lookup receivables payables\"}";
+        return;
+    }
+    if (req.path.rfind("/v1/", 0) != 0) {
+        notFound(resp);
+        return;
+    }
+    auto auth = req.headers.find("authorization");
+    if (auth == req.headers.end() || auth->second.rfind("Bearer ", 0) != 0) {
+        resp.status = 401;
+        resp.body = "{\"code\":\"auth_unauthorized\",\"message\":\"Missing token\"}";
+        return;
+    }
+    if (req.path == "/v1/invoices") {
+        if (req.method == "POST") {
+            char id[48];
+            long n = ++uploadCounter;
+            snprintf(id, sizeof(id), "00000000-0000-4000-8000-%012ld", n);
+            {
+                std::lock_guard<std::mutex> lock(uploadedMutex);
+                uploaded[id] = req.body.size();
+            }
+            resp.status = 201;
+            resp.body = std::string("{\"id\":\"") + id + "\",\"status\":\"PENDING\"}";
+        } else {
+            listInvoices(req, resp);
+        }
+        return;
+    }
+    // /v1/invoices/<id>[/actions|/files/<file>]
+    std::string rest = req.path.substr(strlen("/v1/invoices/"));
+    size_t slash = rest.find('/');
+    std::string id = rest.substr(0, slash);
+    if (req.path.rfind("/v1/invoices/", 0) != 0 || id.empty() || id.find("..") != std::string::npos) {
+        notFound(resp);
+        return;
+    }
+    getInvoice(req, resp, id, slash == std::string::npos ? "" : rest.substr(slash + 1), server.baseUrl(req));
+}
+
+int main(int argc, char *argv[]) {
+    int port = 8080;
+    MockHttpServer::Faults faults;
+    std::string opts = std::string("p:d:h") + MockHttpServer::faultOptions();
+    int c;
+    while ((c = getopt(argc, argv, opts.c_str())) != -1) {
+        switch (c) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'd':
+                fixtureDir = optarg;
+                break;
+            default:
+                if (c != 'h' && MockHttpServer::parseFaultOption(c, optarg, faults)) {
+                    break;
+                }
+                fprintf(stderr,
+                    "Usage: %s [OPTION]...\n"
+                    "Serves the Maventa API from a fixture directory.\n"
+                    "\n"
+                    " -p <port>     Port to listen on (default 8080)\n"
+                    " -d <dir>      Fixture directory (default mock/fixtures/maventa)\n"
+                    "%s"
+                    " -h            Print out this help\n",
+                    argv[0], MockHttpServer::faultUsage());
+                return -1;
+        }
+    }
+    MockHttpServer* self = nullptr;
+    MockHttpServer server(port, faults, [&self](const MockRequest& req, MockResponse& resp) {
+        handle(*self, req, resp);
+    });
+    self = &server;
+    return server.run() ? 0 : -1;
+}
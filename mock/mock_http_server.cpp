@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "mock_http_server.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cstring>
+#include <strings.h>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <sstream>
+
+static const char* statusText(int status) {
+    switch (status) {
+        case 100: return "Continue";
+        case 200: return "OK";
+        case 201: return "Created";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+    }
+    return "Unknown";
+}
+
+static std::string urlDecode(const std::string& in) {
+    std::string out;
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+        if (in[i] == '+') {
+            out += ' ';
+        } else if (in[i] == '%' && i + 2 < in.size()) {
+            out += static_cast<char>(std::strtol(in.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else {
+            out += in[i];
+        }
+    }
+    return out;
+}
+
+static bool sendAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string mockEtag(const std::string& body) {
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"%zx-%zx\"", std::hash<std::string>()(body), body.size());
+    return etag;
+}
+
+MockHttpServer::MockHttpServer(int p, const Faults& f, Handler h)
+    : port(p), faults(f), handler(std::move(h)), rng(std::random_device{}()) {}
+
+const char* MockHttpServer::faultUsage() {
+    return " -l <ms>       Latency added to every response\n"
+           " -j <ms>       Random extra latency, uniform 0..ms\n"
+           " -b <bytes/s>  Bandwidth cap per response\n"
+           " -e <0..1>     Share of requests failing with 500/502/503\n"
+           " -t <0..1>     Share of requests rejected with 429\n"
+           " -r <s>        Retry-After sent with 429/503 (default 1)\n";
+}
+
+bool MockHttpServer::parseFaultOption(int opt, const char* arg, Faults& f) {
+    switch (opt) {
+        case 'l': f.latency_ms = atoi(arg); return true;
+        case 'j': f.jitter_ms = atoi(arg); return true;
+        case 'b': f.bandwidth = atol(arg); return true;
+        case 'e': f.error_rate = atof(arg); return true;
+        case 't': f.throttle_rate = atof(arg); return true;
+        case 'r': f.retry_after = atoi(arg); return true;
+    }
+    return false;
+}
+
+std::string MockHttpServer::baseUrl(const MockRequest& req) const {
+    auto host = req.headers.find("host");
+    if (host != req.headers.end()) {
+        return "http://" + host->second;
+    }
+    return "http://localhost:" + std::to_string(port);
+}
+
+bool MockHttpServer::run() {
+    signal(SIGPIPE, SIG_IGN);
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    if (server < 0) {
+        perror("socket");
+        return false;
+    }
+    int one = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(server, 128) < 0) {
+        perror("bind");
+        close(server);
+        return false;
+    }
+    fprintf(stderr, "listening on port %d\n", port);
+    while (true) {
+        int fd = accept(server, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::thread(&MockHttpServer::serve, this, fd).detach();
+    }
+}
+
+void MockHttpServer::serve(int fd) {
+    std::string in;
+    char buf[16384];
+    size_t header_end;
+    while ((header_end = in.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0 || in.size() > 1024 * 1024) {
+            close(fd);
+            return;
+        }
+        in.append(buf, static_cast<size_t>(n));
+    }
+
+    MockRequest req;
+    std::istringstream head(in.substr(0, header_end));
+    std::string line, target;
+    std::getline(head, line);
+    std::istringstream request_line(line);
+    request_line >> req.method >> target;
+    while (std::getline(head, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        size_t value = line.find_first_not_of(' ', colon + 1);
+        req.headers[name] = value == std::string::npos ? "" : line.substr(value);
+    }
+    size_t q = target.find('?');
+    req.path = urlDecode(target.substr(0, q));
+    if (q != std::string::npos) {
+        std::istringstream params(target.substr(q + 1));
+        std::string kv;
+        while (std::getline(params, kv, '&')) {
+            size_t eq = kv.find('=');
+            req.query[urlDecode(kv.substr(0, eq))] = eq == std::string::npos ? "" : urlDecode(kv.substr(eq + 1));
+        }
+    }
+
+    auto expect = req.headers.find("expect");
+    if (expect != req.headers.end() && strcasecmp(expect->second.c_str(), "100-continue") == 0) {
+        const char* cont = "HTTP/1.1 100 Continue\r\n\r\n";
+        sendAll(fd, cont, strlen(cont));
+    }
+    size_t content_length = 0;
+    auto cl = req.headers.find("content-length");
+    if (cl != req.headers.end()) {
+        content_length = static_cast<size_t>(std::strtoull(cl->second.c_str(), nullptr, 10));
+    }
+    req.body = in.substr(header_end + 4);
+    req.body.reserve(content_length);
+    while (req.body.size() < content_length) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            close(fd);
+            return;
+        }
+        req.body.append(buf, static_cast<size_t>(n));
+    }
+
+    int delay = faults.latency_ms;
+    if (faults.jitter_ms > 0) {
+        std::lock_guard<std::mutex> lock(rng_mutex);
+        delay += std::uniform_int_distribution<int>(0, faults.jitter_ms)(rng);
+    }
+    if (delay > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    }
+
+    MockResponse resp;
+    if (!injectFault(resp)) {
+        handler(req, resp);
+        auto inm = req.headers.find("if-none-match");
+        if (resp.status == 200 && req.method == "GET") {
+            std::string etag = mockEtag(resp.body);
+            resp.headers["ETag"] = etag;
+            if (inm != req.headers.end() && inm->second == etag) {
+                resp.status = 304;
+                resp.body.clear();
+            }
+        }
+    }
+    fprintf(stderr, "%s %s -> %d (%zu bytes)\n", req.method.c_str(), target.c_str(), resp.status, resp.body.size());
+    send(fd, resp, req.method == "HEAD");
+    close(fd);
+}
+
+bool MockHttpServer::injectFault(MockResponse& resp) {
+    double roll;
+    int pick;
+    {
+        std::lock_guard<std::mutex> lock(rng_mutex);
+        roll = std::uniform_real_distribution<double>(0, 1)(rng);
+        pick = std::uniform_int_distribution<int>(0, 2)(rng);
+    }
+    if (roll < faults.throttle_rate) {
+        resp.status = 429;
+    } else if (roll < faults.throttle_rate + faults.error_rate) {
+        static const int errors[] = { 500, 502, 503 };
+        resp.status = errors[pick];
+    } else {
+        return false;
+    }
+    if (resp.status == 429 || resp.status == 503) {
+        resp.headers["Retry-After"] = std::to_string(faults.retry_after);
+    }
+    resp.body = "{\"code\":\"mock_fault\",\"message\":\"injected by mock server\"}";
+    return true;
+}
+
+void MockHttpServer::send(int fd, const MockResponse& resp, bool head_only) {
+    std::ostringstream head;
+    head << "HTTP/1.1 " << resp.status << " " << statusText(resp.status) << "\r\n"
+         << "Content-Type: " << resp.content_type << "\r\n"
+         << "Content-Length: " << resp.body.size() << "\r\n"
+         << "Connection: close\r\n";
+    for (const auto& kv : resp.headers) {
+        head << kv.first << ": " << kv.second << "\r\n";
+    }
+    head << "\r\n";
+    std::string h = head.str();
+    if (!sendAll(fd, h.data(), h.size()) || head_only) {
+        return;
+    }
+    if (faults.bandwidth <= 0) {
+        sendAll(fd, resp.body.data(), resp.body.size());
+        return;
+    }
+    // pace the body in 10 slices per second
+    size_t slice = std::max<size_t>(1, static_cast<size_t>(faults.bandwidth / 10));
+    auto next = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos < resp.body.size(); pos += slice) {
+        std::this_thread::sleep_until(next);
+        if (!sendAll(fd, resp.body.data() + pos, std::min(slice, resp.body.size() - pos))) {
+            return;
+        }
+        next += std::chrono::milliseconds(100);
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <string>
+#include <map>
+#include <functional>
+#include <mutex>
+#include <random>
+
+// Minimal HTTP/1.1 server for the mock backends (maventa_mock, odoo_mock).
+// One thread per connection, one request per connection. Every response
+// can be slowed down and broken on purpose so the client side can be
+// measured against a known latency, bandwidth and error rate.
+struct MockRequest {
+    std::string method;
+    std::string path;                           // without the query
+    std::map<std::string, std::string> query;   // url decoded
+    std::map<std::string, std::string> headers; // names lower case
+    std::string body;
+};
+struct MockResponse {
+    int status = 200;
+    std::string content_type = "application/json";
+    std::map<std::string, std::string> headers;
+    std::string body;
+};
+
+class MockHttpServer {
+public:
+    struct Faults {
+        int latency_ms = 0;        // added before every response
+        int jitter_ms = 0;         // uniform extra latency
+        long bandwidth = 0;        // response bytes per second, 0 = unlimited
+        double error_rate = 0;     // share of requests answered with 500/502/503
+        double throttle_rate = 0;  // share of requests answered with 429
+        int retry_after = 1;       // seconds, sent with 429 and 503
+    };
+    using Handler = std::function<void(const MockRequest& req, MockResponse& resp)>;
+
+    MockHttpServer(int port, const Faults& faults, Handler handler);
+
+    // Accepts connections until the process is stopped, false if the port cannot be bound
+    bool run();
+
+    // "http://host:port" as seen by the client of req
+    std::string baseUrl(const MockRequest& req) const;
+
+    // Parses the option shared by all mocks, returns false for an unknown one
+    static bool parseFaultOption(int opt, const char* arg, Faults& faults);
+    static const char* faultOptions() { return "l:j:b:e:t:r:"; }
+    static const char* faultUsage();
+
+private:
+    void serve(int fd);
+    bool injectFault(MockResponse& resp);
+    void send(int fd, const MockResponse& resp, bool head_only);
+
+    int port;
+    Faults faults;
+    Handler handler;
+    std::mutex rng_mutex;
+    std::mt19937 rng;
+};
+
+// ETag of a body, used by the mocks for conditional GETs
+std::string mockEtag(const std::string& body);
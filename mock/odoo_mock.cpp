@@ -0,0 +1,911 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "mock_http_server.h"
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/internal/dtoa.h>
+#include <rapidxml.hpp>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <unistd.h>
+
+// In memory Odoo: one record store per model, records kept in the shape
+// search_read returns them (many2one as [id, name], x2many as id lists)
+struct Model {
+    int next_id = 1;
+    std::map<int, rapidjson::Document> records;
+};
+static std::map<std::string, Model> models;
+static std::mutex storeMutex;
+static std::string apiKey; // empty accepts any password
+static const int mockUid = 2;
+
+static const std::map<std::string, std::string> many2one = {
+    {"partner_id", "res.partner"},
+    {"company_id", "res.company"},
+    {"country_id", "res.country"},
+    {"currency_id", "res.currency"},
+    {"bank_id", "res.bank"},
+    {"partner_bank_id", "res.partner.bank"},
+    {"fiscal_position_id", "account.fiscal.position"},
+    {"move_id", "account.move"},
+    {"create_uid", "res.users"},
+};
+static const std::map<std::string, std::string> x2many = {
+    {"invoice_line_ids", "account.move.line"},
+    {"attachment_ids", "ir.attachment"},
+    {"tax_ids", "account.tax"},
+    {"bank_ids", "res.partner.bank"},
+};
+
+struct OdooFault : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+static std::string displayName(const std::string& model, int id) {
+    auto m = models.find(model);
+    if (m == models.end()) {
+        return "";
+    }
+    auto r = m->second.records.find(id);
+    if (r == m->second.records.end()) {
+        return "";
+    }
+    const rapidjson::Document& rec = r->second;
+    if (rec.HasMember("name") && rec["name"].IsString()) {
+        return rec["name"].GetString();
+    }
+    if (rec.HasMember("acc_number") && rec["acc_number"].IsString()) {
+        return rec["acc_number"].GetString();
+    }
+    return model + "," + std::to_string(id);
+}
+
+static int createRecord(const std::string& model, const rapidjson::Value& vals);
+
+// Stores one field the way Odoo reads it back: ids of relations become
+// [id, name], x2many commands (0, 0, vals) / (4, id) / (6, 0, ids) are applied
+static void setField(rapidjson::Document& rec, const std::string& field, const rapidjson::Value& v) {
+    auto& a = rec.GetAllocator();
+    rapidjson::Value value;
+    auto m2o = many2one.find(field);
+    auto x2m = x2many.find(field);
+    if (m2o != many2one.end() && v.IsInt()) {
+        value.SetArray();
+        value.PushBack(v.GetInt(), a);
+        value.PushBack(rapidjson::Value(displayName(m2o->second, v.GetInt()).c_str(), a), a);
+    } else if (x2m != x2many.end() && v.IsArray()) {
+        std::vector<int> ids;
+        if (rec.HasMember(field.c_str()) && rec[field.c_str()].IsArray()) {
+            for (const auto& id : rec[field.c_str()].GetArray()) {
+                if (id.IsInt()) ids.push_back(id.GetInt());
+            }
+        }
+        for (const auto& cmd : v.GetArray()) {
+            if (cmd.IsInt()) {
+                ids.push_back(cmd.GetInt());
+                continue;
+            }
+            if (!cmd.IsArray() || cmd.Size() < 2 || !cmd[0].IsInt()) {
+                throw OdooFault("Invalid x2many command for " + field);
+            }
+            int op = cmd[0].GetInt();
+            if (op == 0 && cmd.Size() > 2 && cmd[2].IsObject()) {
+                rapidjson::Document line;
+                line.CopyFrom(cmd[2], line.GetAllocator(), true);
+                if (x2m->second == "account.move.line" && !line.HasMember("move_id")) {
+                    line.AddMember("move_id", rec["id"].GetInt(), line.GetAllocator());
+                }
+                ids.push_back(createRecord(x2m->second, line));
+            } else if (op == 4 && cmd[1].IsInt()) {
+                ids.push_back(cmd[1].GetInt());
+            } else if ((op == 2 || op == 3) && cmd[1].IsInt()) {
+                ids.erase(std::remove(ids.begin(), ids.end(), cmd[1].GetInt()), ids.end());
+            } else if (op == 5) {
+                ids.clear();
+            } else if (op == 6 && cmd.Size() > 2 && cmd[2].IsArray()) {
+                ids.clear();
+                for (const auto& id : cmd[2].GetArray()) {
+                    if (id.IsInt()) ids.push_back(id.GetInt());
+                }
+            } else {
+                throw OdooFault("Unsupported x2many command for " + field);
+            }
+        }
+        value.SetArray();
+        for (int id : ids) {
+            value.PushBack(id, a);
+        }
+    } else {
+        value.CopyFrom(v, a, true);
+    }
+    if (rec.HasMember(field.c_str())) {
+        rec[field.c_str()] = value;
+    } else {
+        rec.AddMember(rapidjson::Value(field.c_str(), a), value, a);
+    }
+}
+
+static int createRecord(const std::string& model, const rapidjson::Value& vals) {
+    if (!vals.IsObject()) {
+        throw OdooFault("create expects a dict of values");
+    }
+    Model& m = models[model];
+    int id = m.next_id++;
+    rapidjson::Document& rec = m.records[id];
+    rec.SetObject();
+    rec.AddMember("id", id, rec.GetAllocator());
+    for (auto it = vals.MemberBegin(); it != vals.MemberEnd(); ++it) {
+        setField(rec, it->name.GetString(), it->value);
+    }
+    auto& a = rec.GetAllocator();
+    if (model == "account.move.line" && !rec.HasMember("price_subtotal")) {
+        double qty = rec.HasMember("quantity") && rec["quantity"].IsNumber() ? rec["quantity"].GetDouble() : 0;
+        double price = rec.HasMember("price_unit") && rec["price_unit"].IsNumber() ? rec["price_unit"].GetDouble() : 0;
+        rec.AddMember("price_subtotal", qty * price, a);
+    }
+    // attachments created for a move show up in its attachment_ids
+    if (model == "ir.attachment" && rec.HasMember("res_model") && rec["res_model"].IsString()
+        && rec.HasMember("res_id") && rec["res_id"].IsInt() && rec["res_id"].GetInt() > 0) {
+        auto owner = models.find(rec["res_model"].GetString());
+        if (owner != models.end()) {
+            auto r = owner->second.records.find(rec["res_id"].GetInt());
+            if (r != owner->second.records.end()) {
+                rapidjson::Value cmd(rapidjson::kArrayType);
+                rapidjson::Document tmp;
+                cmd.PushBack(4, tmp.GetAllocator()).PushBack(id, tmp.GetAllocator());
+                rapidjson::Value cmds(rapidjson::kArrayType);
+                cmds.PushBack(cmd, tmp.GetAllocator());
+                setField(r->second, "attachment_ids", cmds);
+            }
+        }
+    }
+    return id;
+}
+
+// Domain evaluation, prefix notation with an implicit '&' between terms
+
+static bool wildcardMatch(const char* pattern, const char* text, bool icase) {
+    auto eq = [icase](char a, char b) {
+        return icase ? tolower((unsigned char)a) == tolower((unsigned char)b) : a == b;
+    };
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*text) {
+        if (*pattern == '%') {
+            star = pattern++;
+            resume = text;
+        } else if (*pattern == '_' || (*pattern && eq(*pattern, *text))) {
+            pattern++;
+            text++;
+        } else if (star) {
+            pattern = star + 1;
+            text = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '%') pattern++;
+    return *pattern == 0;
+}
+
+// <0, 0, >0 like strcmp; ints and numeric strings compare as numbers,
+// a many2one compares by id against a number and by name against a string
+static int compareValues(const rapidjson::Value& field, const rapidjson::Value& value) {
+    if (field.IsArray() && field.Size() == 2 && field[0].IsInt()) {
+        if (value.IsString() && field[1].IsString()) {
+            char* end = nullptr;
+            long n = strtol(value.GetString(), &end, 10);
+            if (*value.GetString() && *end == 0) {
+                return field[0].GetInt() < n ? -1 : field[0].GetInt() > n;
+            }
+            return strcmp(field[1].GetString(), value.GetString());
+        }
+        return compareValues(field[0], value);
+    }
+    if (field.IsNumber() || value.IsNumber()) {
+        auto num = [](const rapidjson::Value& v, double& d) {
+            if (v.IsNumber()) { d = v.GetDouble(); return true; }
+            if (v.IsString()) { char* end; d = strtod(v.GetString(), &end); return *v.GetString() && *end == 0; }
+            if (v.IsBool()) { d = v.GetBool(); return true; }
+            return false;
+        };
+        double a, b;
+        if (!num(field, a) || !num(value, b)) {
+            return 1;
+        }
+        return a < b ? -1 : a > b;
+    }
+    if (field.IsString() && value.IsString()) {
+        return strcmp(field.GetString(), value.GetString());
+    }
+    // unset fields read as False
+    bool a = field.IsBool() ? field.GetBool() : !field.IsNull() && !field.IsArray();
+    bool b = value.IsBool() ? value.GetBool() : !value.IsNull();
+    if (field.IsArray() && field.Size() > 0) a = true;
+    return a == b ? 0 : 1;
+}
+
+static bool matchLeaf(const rapidjson::Value& rec, const rapidjson::Value& leaf) {
+    if (!leaf.IsArray() || leaf.Size() != 3 || !leaf[0].IsString() || !leaf[1].IsString()) {
+        throw OdooFault("Invalid domain term");
+    }
+    static const rapidjson::Value unset(false);
+    const char* name = leaf[0].GetString();
+    const rapidjson::Value& field = rec.HasMember(name) ? rec[name] : unset;
+    std::string op = leaf[1].GetString();
+    const rapidjson::Value& value = leaf[2];
+
+    bool x2m = x2many.count(name) && field.IsArray();
+    auto equals = [&](const rapidjson::Value& v) {
+        if (x2m) {
+            for (const auto& id : field.GetArray()) {
+                if (compareValues(id, v) == 0) return true;
+            }
+            return false;
+        }
+        return compareValues(field, v) == 0;
+    };
+    if (op == "=" || op == "==") return equals(value);
+    if (op == "!=" || op == "<>") return !equals(value);
+    if (op == "in" || op == "not in") {
+        bool found = false;
+        if (value.IsArray()) {
+            for (const auto& v : value.GetArray()) {
+                if (equals(v)) { found = true; break; }
+            }
+        } else {
+            found = equals(value);
+        }
+        return op == "in" ? found : !found;
+    }
+    if (op == "<") return compareValues(field, value) < 0;
+    if (op == "<=") return compareValues(field, value) <= 0;
+    if (op == ">") return compareValues(field, value) > 0;
+    if (op == ">=") return compareValues(field, value) >= 0;
+    if (op == "like" || op == "ilike" || op == "not like" || op == "not ilike" || op == "=like" || op == "=ilike") {
+        const rapidjson::Value& text = field.IsArray() && field.Size() == 2 ? field[1] : field;
+        if (!text.IsString() || !value.IsString()) {
+            return op.rfind("not", 0) == 0;
+        }
+        std::string pattern = value.GetString();
+        if (op[0] != '=') {
+            pattern = "%" + pattern + "%";
+        }
+        bool matched = wildcardMatch(pattern.c_str(), text.GetString(), op.find("ilike") != std::string::npos);
+        return op.rfind("not", 0) == 0 ? !matched : matched;
+    }
+    throw OdooFault("Unsupported domain operator " + op);
+}
+
+static bool matchTerm(const rapidjson::Value& rec, const rapidjson::Value& domain, rapidjson::SizeType& pos) {
+    if (pos >= domain.Size()) {
+        throw OdooFault("Incomplete domain");
+    }
+    const rapidjson::Value& term = domain[pos++];
+    if (term.IsString()) {
+        std::string op = term.GetString();
+        if (op == "!") {
+            return !matchTerm(rec, domain, pos);
+        }
+        bool left = matchTerm(rec, domain, pos);
+        bool right = matchTerm(rec, domain, pos);
+        if (op == "&") return left && right;
+        if (op == "|") return left || right;
+        throw OdooFault("Unsupported domain operator " + op);
+    }
+    return matchLeaf(rec, term);
+}
+
+static bool matchDomain(const rapidjson::Value& rec, const rapidjson::Value& domain) {
+    if (!domain.IsArray()) {
+        return true;
+    }
+    rapidjson::SizeType pos = 0;
+    bool ok = true;
+    while (pos < domain.Size()) {
+        ok = matchTerm(rec, domain, pos) && ok;
+    }
+    return ok;
+}
+
+// execute_kw, args and kwargs as received, result in out
+
+struct SearchOptions {
+    const rapidjson::Value* fields = nullptr;
+    int offset = 0;
+    int limit = 0;
+    std::string order;
+};
+
+static const rapidjson::Value* arg(const rapidjson::Value& args, const rapidjson::Value& kwargs, rapidjson::SizeType index, const char* name) {
+    if (kwargs.IsObject() && kwargs.HasMember(name)) {
+        return &kwargs[name];
+    }
+    if (args.IsArray() && index < args.Size()) {
+        return &args[index];
+    }
+    return nullptr;
+}
+
+static std::vector<int> search(Model& m, const rapidjson::Value* domain, const SearchOptions& opt) {
+    std::vector<int> ids;
+    for (const auto& kv : m.records) {
+        if (!domain || matchDomain(kv.second, *domain)) {
+            ids.push_back(kv.first);
+        }
+    }
+    if (!opt.order.empty()) {
+        std::string field = opt.order.substr(0, opt.order.find_first_of(" ,"));
+        bool desc = opt.order.find(" desc") != std::string::npos || opt.order.find(" DESC") != std::string::npos;
+        static const rapidjson::Value unset(false);
+        std::stable_sort(ids.begin(), ids.end(), [&](int a, int b) {
+            const rapidjson::Document& ra = m.records[a];
+            const rapidjson::Document& rb = m.records[b];
+            const rapidjson::Value& va = ra.HasMember(field.c_str()) ? ra[field.c_str()] : unset;
+            const rapidjson::Value& vb = rb.HasMember(field.c_str()) ? rb[field.c_str()] : unset;
+            int c = compareValues(va, vb);
+            return desc ? c > 0 : c < 0;
+        });
+    }
+    if (opt.offset > 0) {
+        ids.erase(ids.begin(), ids.begin() + std::min<size_t>(opt.offset, ids.size()));
+    }
+    if (opt.limit > 0 && ids.size() > static_cast<size_t>(opt.limit)) {
+        ids.resize(opt.limit);
+    }
+    return ids;
+}
+
+static void readRecords(Model& m, const std::vector<int>& ids, const rapidjson::Value* fields, rapidjson::Value& out, rapidjson::Document::AllocatorType& a) {
+    out.SetArray();
+    bool all = !fields || !fields->IsArray() || fields->Empty();
+    for (int id : ids) {
+        auto r = m.records.find(id);
+        if (r == m.records.end()) {
+            continue;
+        }
+        rapidjson::Value rec(rapidjson::kObjectType);
+        if (all) {
+            rec.CopyFrom(r->second, a, true);
+        } else {
+            rec.AddMember("id", id, a);
+            for (const auto& f : fields->GetArray()) {
+                if (!f.IsString() || strcmp(f.GetString(), "id") == 0) {
+                    continue;
+                }
+                rapidjson::Value v(false);
+                if (r->second.HasMember(f.GetString())) {
+                    v.CopyFrom(r->second[f.GetString()], a, true);
+                }
+                rec.AddMember(rapidjson::Value(f.GetString(), a), v, a);
+            }
+        }
+        out.PushBack(rec, a);
+    }
+}
+
+static std::vector<int> idList(const rapidjson::Value* v) {
+    std::vector<int> ids;
+    if (v && v->IsInt()) {
+        ids.push_back(v->GetInt());
+    } else if (v && v->IsArray()) {
+        for (const auto& id : v->GetArray()) {
+            if (id.IsInt()) ids.push_back(id.GetInt());
+        }
+    }
+    return ids;
+}
+
+static void executeKw(const std::string& model, const std::string& method, const rapidjson::Value& args, const rapidjson::Value& kwargs, rapidjson::Value& out, rapidjson::Document::AllocatorType& a) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    auto mit = models.find(model);
+    if (mit == models.end()) {
+        throw OdooFault("Object " + model + " doesn't exist");
+    }
+    Model& m = mit->second;
+    static const rapidjson::Value none(rapidjson::kArrayType);
+    const rapidjson::Value& kw = kwargs.IsObject() ? kwargs : none;
+
+    if (method == "search_read" || method == "search" || method == "search_count") {
+        SearchOptions opt;
+        bool read = method == "search_read";
+        const rapidjson::Value* domain = arg(args, kw, 0, "domain");
+        if (read) {
+            opt.fields = arg(args, kw, 1, "fields");
+        }
+        const rapidjson::Value* offset = arg(args, kw, read ? 2 : 1, "offset");
+        const rapidjson::Value* limit = arg(args, kw, read ? 3 : 2, "limit");
+        const rapidjson::Value* order = arg(args, kw, read ? 4 : 3, "order");
+        opt.offset = offset && offset->IsInt() ? offset->GetInt() : 0;
+        opt.limit = limit && limit->IsInt() ? limit->GetInt() : 0;
+        opt.order = order && order->IsString() ? order->GetString() : "";
+        std::vector<int> ids = search(m, domain, opt);
+        if (method == "search_count") {
+            out.SetInt(static_cast<int>(ids.size()));
+        } else if (method == "search") {
+            out.SetArray();
+            for (int id : ids) out.PushBack(id, a);
+        } else {
+            readRecords(m, ids, opt.fields, out, a);
+        }
+    } else if (method == "read") {
+        readRecords(m, idList(arg(args, kw, 0, "ids")), arg(args, kw, 1, "fields"), out, a);
+    } else if (method == "create") {
+        const rapidjson::Value* vals = arg(args, kw, 0, "vals_list");
+        if (!vals) {
+            throw OdooFault("create: missing values");
+        }
+        if (vals->IsArray()) {
+            out.SetArray();
+            for (const auto& v : vals->GetArray()) out.PushBack(createRecord(model, v), a);
+        } else {
+            out.SetInt(createRecord(model, *vals));
+        }
+    } else if (method == "write") {
+        const rapidjson::Value* vals = arg(args, kw, 1, "vals");
+        if (!vals || !vals->IsObject()) {
+            throw OdooFault("write: missing values");
+        }
+        for (int id : idList(arg(args, kw, 0, "ids"))) {
+            auto r = m.records.find(id);
+            if (r == m.records.end()) {
+                throw OdooFault("Record does not exist or has been deleted. (Record: " + model + "(" + std::to_string(id) + ",))");
+            }
+            for (auto it = vals->MemberBegin(); it != vals->MemberEnd(); ++it) {
+                setField(r->second, it->name.GetString(), it->value);
+            }
+        }
+        out.SetBool(true);
+    } else if (method == "unlink") {
+        for (int id : idList(arg(args, kw, 0, "ids"))) {
+            m.records.erase(id);
+        }
+        out.SetBool(true);
+    } else {
+        throw OdooFault("The method '" + method + "' does not exist on the model '" + model + "'");
+    }
+}
+
+// Dispatch of the common and object services, shared by XML-RPC and JSON-RPC
+static void call(const std::string& service, const std::string& method, const rapidjson::Value& params, rapidjson::Value& out, rapidjson::Document::AllocatorType& a) {
+    auto param = [&params](rapidjson::SizeType i) -> const rapidjson::Value& {
+        if (!params.IsArray() || i >= params.Size()) {
+            throw OdooFault("Missing argument " + std::to_string(i));
+        }
+        return params[i];
+    };
+    if (service == "common") {
+        if (method == "version") {
+            out.SetObject();
+            out.AddMember("server_version", "17.0", a);
+            out.AddMember("protocol_version", 1, a);
+        } else if (method == "authenticate" || method == "login") {
+            const rapidjson::Value& password = param(2);
+            bool ok = apiKey.empty() || (password.IsString() && apiKey == password.GetString());
+            if (ok) out.SetInt(mockUid); else out.SetBool(false);
+        } else {
+            throw OdooFault("Unknown method common." + method);
+        }
+        return;
+    }
+    if (service == "object" && method == "execute_kw") {
+        const rapidjson::Value& uid = param(1);
+        const rapidjson::Value& password = param(2);
+        if (!uid.IsInt() || uid.GetInt() != mockUid || (!apiKey.empty() && (!password.IsString() || apiKey != password.GetString()))) {
+            throw OdooFault("Access Denied");
+        }
+        if (!param(3).IsString() || !param(4).IsString()) {
+            throw OdooFault("execute_kw expects model and method names");
+        }
+        static const rapidjson::Value none(rapidjson::kArrayType);
+        const rapidjson::Value& args = params.Size() > 5 ? params[5] : none;
+        const rapidjson::Value& kwargs = params.Size() > 6 ? params[6] : none;
+        executeKw(param(3).GetString(), param(4).GetString(), args, kwargs, out, a);
+        return;
+    }
+    throw OdooFault("Unknown method " + service + "." + method);
+}
+
+// XML-RPC <-> rapidjson
+
+static void xmlrpcToJson(rapidxml::xml_node<>* value, rapidjson::Value& out, rapidjson::Document::AllocatorType& a) {
+    rapidxml::xml_node<>* typed = value->first_node();
+    if (!typed) {
+        out.SetString(value->value(), static_cast<rapidjson::SizeType>(value->value_size()), a);
+        return;
+    }
+    std::string type(typed->name(), typed->name_size());
+    if (type == "int" || type == "i4" || type == "i8") {
+        long long n = atoll(typed->value());
+        if (n == static_cast<int>(n)) out.SetInt(static_cast<int>(n)); else out.SetInt64(n);
+    } else if (type == "boolean") {
+        out.SetBool(atoi(typed->value()) != 0);
+    } else if (type == "double") {
+        out.SetDouble(atof(typed->value()));
+    } else if (type == "nil") {
+        out.SetNull();
+    } else if (type == "array") {
+        out.SetArray();
+        rapidxml::xml_node<>* data = typed->first_node("data");
+        for (auto* v = data ? data->first_node("value") : nullptr; v; v = v->next_sibling("value")) {
+            rapidjson::Value item;
+            xmlrpcToJson(v, item, a);
+            out.PushBack(item, a);
+        }
+    } else if (type == "struct") {
+        out.SetObject();
+        for (auto* member = typed->first_node("member"); member; member = member->next_sibling("member")) {
+            rapidxml::xml_node<>* name = member->first_node("name");
+            rapidxml::xml_node<>* v = member->first_node("value");
+            if (!name || !v) {
+                continue;
+            }
+            rapidjson::Value item;
+            xmlrpcToJson(v, item, a);
+            out.AddMember(rapidjson::Value(name->value(), static_cast<rapidjson::SizeType>(name->value_size()), a), item, a);
+        }
+    } else {
+        // string, base64 and dateTime.iso8601 are kept as text
+        out.SetString(typed->value(), static_cast<rapidjson::SizeType>(typed->value_size()), a);
+    }
+}
+
+static void appendEscaped(std::string& out, const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        switch (s[i]) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            default: out += s[i];
+        }
+    }
+}
+
+static void jsonToXmlrpc(const rapidjson::Value& v, std::string& out) {
+    out += "<value>";
+    if (v.IsBool()) {
+        out += v.GetBool() ? "<boolean>1</boolean>" : "<boolean>0</boolean>";
+    } else if (v.IsInt()) {
+        out += "<int>" + std::to_string(v.GetInt()) + "</int>";
+    } else if (v.IsNumber()) {
+        // shortest round trip form, like the JSON-RPC side
+        char buf[32];
+        char* end = rapidjson::internal::dtoa(v.GetDouble(), buf);
+        out += "<double>";
+        out.append(buf, end);
+        out += "</double>";
+    } else if (v.IsString()) {
+        out += "<string>";
+        appendEscaped(out, v.GetString(), v.GetStringLength());
+        out += "</string>";
+    } else if (v.IsArray()) {
+        out += "<array><data>";
+        for (const auto& item : v.GetArray()) jsonToXmlrpc(item, out);
+        out += "</data></array>";
+    } else if (v.IsObject()) {
+        out += "<struct>";
+        for (auto it = v.MemberBegin(); it != v.MemberEnd(); ++it) {
+            out += "<member><name>";
+            appendEscaped(out, it->name.GetString(), it->name.GetStringLength());
+            out += "</name>";
+            jsonToXmlrpc(it->value, out);
+            out += "</member>";
+        }
+        out += "</struct>";
+    } else {
+        out += "<nil/>";
+    }
+    out += "</value>";
+}
+
+static void handleXmlrpc(const std::string& service, const MockRequest& req, MockResponse& resp) {
+    resp.content_type = "text/xml";
+    rapidjson::Document result;
+    std::string fault;
+    try {
+        std::vector<char> buffer(req.body.begin(), req.body.end());
+        buffer.push_back(0);
+        rapidxml::xml_document<> xml;
+        xml.parse<0>(buffer.data());
+        rapidxml::xml_node<>* call_node = xml.first_node("methodCall");
+        rapidxml::xml_node<>* name = call_node ? call_node->first_node("methodName") : nullptr;
+        if (!name) {
+            throw OdooFault("Not an XML-RPC call");
+        }
+        rapidjson::Document params;
+        params.SetArray();
+        rapidxml::xml_node<>* list = call_node->first_node("params");
+        for (auto* p = list ? list->first_node("param") : nullptr; p; p = p->next_sibling("param")) {
+            rapidjson::Value item;
+            if (rapidxml::xml_node<>* v = p->first_node("value")) {
+                xmlrpcToJson(v, item, params.GetAllocator());
+            }
+            params.PushBack(item, params.GetAllocator());
+        }
+        call(service, std::string(name->value(), name->value_size()), params, result, result.GetAllocator());
+    } catch (const rapidxml::parse_error& e) {
+        fault = std::string("XML parse error: ") + e.what();
+    } catch (const std::exception& e) {
+        fault = e.what();
+    }
+    resp.body = "<?xml version=\"1.0\"?>\n<methodResponse>";
+    if (fault.empty()) {
+        resp.body += "<params><param>";
+        jsonToXmlrpc(result, resp.body);
+        resp.body += "</param></params>";
+    } else {
+        rapidjson::Document f;
+        f.SetObject();
+        f.AddMember("faultCode", 1, f.GetAllocator());
+        f.AddMember("faultString", rapidjson::Value(fault.c_str(), f.GetAllocator()), f.GetAllocator());
+        resp.body += "<fault>";
+        jsonToXmlrpc(f, resp.body);
+        resp.body += "</fault>";
+    }
+    resp.body += "</methodResponse>\n";
+}
+
+// JSON-RPC 2.0 on /jsonrpc: {"method": "call", "params": {"service", "method", "args"}}
+static void handleJsonrpc(const MockRequest& req, MockResponse& resp) {
+    rapidjson::Document in;
+    rapidjson::Document out;
+    out.SetObject();
+    auto& a = out.GetAllocator();
+    out.AddMember("jsonrpc", "2.0", a);
+    rapidjson::Value result;
+    std::string error;
+    try {
+        if (in.Parse(req.body.c_str()).HasParseError() || !in.IsObject()) {
+            throw OdooFault("Invalid JSON request");
+        }
+        if (in.HasMember("id")) {
+            out.AddMember("id", rapidjson::Value(in["id"], a), a);
+        }
+        const rapidjson::Value* params = in.HasMember("params") && in["params"].IsObject() ? &in["params"] : nullptr;
+        if (!params || !params->HasMember("service") || !(*params)["service"].IsString()
+            || !params->HasMember("method") || !(*params)["method"].IsString() || !params->HasMember("args")) {
+            throw OdooFault("Expected params with service, method and args");
+        }
+        call((*params)["service"].GetString(), (*params)["method"].GetString(), (*params)["args"], result, a);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    if (error.empty()) {
+        out.AddMember("result", result, a);
+    } else {
+        rapidjson::Value err(rapidjson::kObjectType);
+        err.AddMember("code", 200, a);
+        err.AddMember("message", "Odoo Server Error", a);
+        rapidjson::Value data(rapidjson::kObjectType);
+        data.AddMember("name", "odoo.exceptions.UserError", a);
+        data.AddMember("message", rapidjson::Value(error.c_str(), a), a);
+        err.AddMember("data", data, a);
+        out.AddMember("error", err, a);
+    }
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    out.Accept(writer);
+    resp.body = buffer.GetString();
+}
+
+static void handle(const MockRequest& req, MockResponse& resp) {
+    if (req.method != "POST") {
+        resp.status = 405;
+        resp.body = "";
+        return;
+    }
+    if (req.path == "/xmlrpc/2/common" || req.path == "/xmlrpc/2/object") {
+        handleXmlrpc(req.path.substr(strlen("/xmlrpc/2/")), req, resp);
+    } else if (req.path == "/jsonrpc") {
+        handleJsonrpc(req, resp);
+    } else {
+        resp.status = 404;
+        resp.body = "";
+    }
+}
+
+// Seed data: one company with its bank account, the Finnish VAT rates,
+// N customers with e-invoice addresses and M invoices waiting to be sent
+
+struct Seed {
+    int partners = 10;
+    int invoices = 20;
+    int rows = 3;
+    size_t attachment_size = 0;
+    unsigned seed = 1;
+};
+
+static int seedRecord(const std::string& model, const char* json) {
+    rapidjson::Document vals;
+    if (vals.Parse(json).HasParseError()) {
+        throw std::logic_error(std::string("bad seed record: ") + json);
+    }
+    return createRecord(model, vals);
+}
+
+static void seedData(const Seed& s) {
+    std::mt19937 rng(s.seed);
+    char json[1024];
+
+    seedRecord("res.currency", "{\"name\":\"EUR\"}");
+    seedRecord("res.users", "{\"name\":\"OdooBot\",\"login\":\"__system__\"}");
+    seedRecord("res.users", "{\"name\":\"Mock Admin\",\"login\":\"admin\"}"); // mockUid
+    int fi = seedRecord("res.country", "{\"name\":\"Finland\",\"code\":\"FI\"}");
+    seedRecord("res.country", "{\"name\":\"Sweden\",\"code\":\"SE\"}");
+    seedRecord("res.country", "{\"name\":\"Estonia\",\"code\":\"EE\"}");
+    snprintf(json, sizeof(json),
+        "{\"name\":\"Mock Seller Oy\",\"vat\":\"FI12345678\",\"street\":\"Testikatu 1\",\"city\":\"Helsinki\","
+        "\"zip\":\"00100\",\"country_id\":%d,\"currency_id\":1,\"x_studio_eio_ovt\":\"003712345678\","
+        "\"x_studio_eio_intermediator\":\"003721291126\"}", fi);
+    int company = seedRecord("res.company", json);
+    int bank = seedRecord("res.bank", "{\"name\":\"Mock Bank\",\"bic\":\"MOCKFIHH\"}");
+    snprintf(json, sizeof(json),
+        "{\"acc_number\":\"FI21 1234 5600 0007 85\",\"bank_id\":%d,\"bank_name\":\"Mock Bank\","
+        "\"bank_bic\":\"MOCKFIHH\",\"company_id\":%d}", bank, company);
+    int account = seedRecord("res.partner.bank", json);
+    snprintf(json, sizeof(json), "{\"name\":\"Domestic\",\"company_id\":%d,\"country_id\":%d}", company, fi);
+    seedRecord("account.fiscal.position", json);
+
+    const double rates[] = {25.5, 14, 13.5, 10, 0};
+    std::vector<int> taxes;
+    for (double rate : rates) {
+        snprintf(json, sizeof(json), "{\"name\":\"%g%%\",\"amount\":%g,\"type_tax_use\":\"sale\",\"company_id\":%d}", rate, rate, company);
+        taxes.push_back(seedRecord("account.tax", json));
+    }
+
+    std::vector<int> partners;
+    for (int i = 1; i <= s.partners; i++) {
+        snprintf(json, sizeof(json),
+            "{\"name\":\"Asiakas %d Oy\",\"vat\":\"FI%08d\",\"street\":\"Asiakaskatu %d\",\"city\":\"Tampere\","
+            "\"zip\":\"33100\",\"country_id\":%d,\"company_id\":%d,\"is_company\":true,"
+            "\"x_studio_eio_ovt\":\"0037%08d\",\"x_studio_eio_intermediator\":\"003721291126\"}",
+            i, 10000000 + i, i, fi, company, 10000000 + i);
+        partners.push_back(seedRecord("res.partner", json));
+    }
+
+    std::string attachment;
+    if (s.attachment_size > 0) {
+        // base64 text of the size asked for, as ir.attachment.datas holds it
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        attachment.resize((s.attachment_size + 2) / 3 * 4);
+        for (auto& ch : attachment) ch = alphabet[rng() % 64];
+    }
+    std::uniform_int_distribution<int> qty(1, 20);
+    std::uniform_int_distribution<int> cents(100, 100000);
+    for (int i = 1; i <= s.invoices && !partners.empty(); i++) {
+        int partner = partners[(i - 1) % partners.size()];
+        int day = 1 + (i - 1) % 28;
+        snprintf(json, sizeof(json),
+            "{\"name\":\"INV/2025/%05d\",\"move_type\":\"out_invoice\",\"state\":\"posted\",\"company_id\":%d,"
+            "\"partner_id\":%d,\"partner_bank_id\":%d,\"currency_id\":1,\"create_uid\":%d,"
+            "\"invoice_date\":\"2025-09-%02d\",\"invoice_date_due\":\"2025-10-%02d\",\"payment_reference\":false,"
+            "\"x_studio_maventa_status\":\"sending\",\"x_studio_buyerref\":\"REF%d\",\"x_studio_orderid\":\"PO%d\"}",
+            i, company, partner, account, mockUid, day, day, i, i);
+        int move = seedRecord("account.move", json);
+        rapidjson::Document& rec = models["account.move"].records[move];
+        double untaxed = 0, tax = 0;
+        rapidjson::Document lines;
+        lines.SetArray();
+        for (int r = 1; r <= s.rows; r++) {
+            int q = qty(rng);
+            double price = cents(rng) / 100.0;
+            size_t t = rng() % taxes.size();
+            rapidjson::Value line(rapidjson::kObjectType);
+            snprintf(json, sizeof(json), "Tuote %d", r);
+            line.AddMember("name", rapidjson::Value(json, lines.GetAllocator()), lines.GetAllocator());
+            line.AddMember("quantity", q, lines.GetAllocator());
+            line.AddMember("price_unit", price, lines.GetAllocator());
+            line.AddMember("price_subtotal", q * price, lines.GetAllocator());
+            rapidjson::Value tax_ids(rapidjson::kArrayType);
+            tax_ids.PushBack(taxes[t], lines.GetAllocator());
+            line.AddMember("tax_ids", tax_ids, lines.GetAllocator());
+            rapidjson::Value cmd(rapidjson::kArrayType);
+            cmd.PushBack(0, lines.GetAllocator()).PushBack(0, lines.GetAllocator()).PushBack(line, lines.GetAllocator());
+            lines.PushBack(cmd, lines.GetAllocator());
+            untaxed += q * price;
+            tax += q * price * rates[t] / 100;
+        }
+        setField(rec, "invoice_line_ids", lines);
+        auto& a = rec.GetAllocator();
+        untaxed = std::round(untaxed * 100) / 100;
+        tax = std::round(tax * 100) / 100;
+        rec.AddMember("amount_untaxed_signed", untaxed, a);
+        rec.AddMember("amount_tax_signed", tax, a);
+        rec.AddMember("amount_total_signed", std::round((untaxed + tax) * 100) / 100, a);
+        if (!attachment.empty()) {
+            rapidjson::Document att;
+            att.SetObject();
+            snprintf(json, sizeof(json), "INV_2025_%05d.pdf", i);
+            att.AddMember("name", rapidjson::Value(json, att.GetAllocator()), att.GetAllocator());
+            att.AddMember("mimetype", "application/pdf", att.GetAllocator());
+            att.AddMember("type", "binary", att.GetAllocator());
+            att.AddMember("res_model", "account.move", att.GetAllocator());
+            att.AddMember("res_id", move, att.GetAllocator());
+            att.AddMember("datas", rapidjson::StringRef(attachment.data(), attachment.size()), att.GetAllocator());
+            createRecord("ir.attachment", att);
+        }
+    }
+    // vendor bills and their attachments are created by the client
+    models["ir.attachment"];
+    models["account.move.line"];
+}
+
+int main(int argc, char *argv[]) {
+    int port = 8069;
+    MockHttpServer::Faults faults;
+    Seed seed;
+    std::string opts = std::string("p:k:n:i:x:a:s:h") + MockHttpServer::faultOptions();
+    int c;
+    while ((c = getopt(argc, argv, opts.c_str())) != -1) {
+        switch (c) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'k':
+                apiKey = optarg;
+                break;
+            case 'n':
+                seed.partners = atoi(optarg);
+                break;
+            case 'i':
+                seed.invoices = atoi(optarg);
+                break;
+            case 'x':
+                seed.rows = atoi(optarg);
+                break;
+            case 'a':
+                seed.attachment_size = strtoul(optarg, nullptr, 10);
+                break;
+            case 's':
+                seed.seed = strtoul(optarg, nullptr, 10);
+                break;
+            default:
+                if (c != 'h' && MockHttpServer::parseFaultOption(c, optarg, faults)) {
+                    break;
+                }
+                fprintf(stderr,
+                    "Usage: %s [OPTION]...\n"
+                    "Serves the Odoo external API (XML-RPC and JSON-RPC) from generated in memory data.\n"
+                    "\n"
+                    " -p <port>     Port to listen on (default 8069)\n"
+                    " -k <key>      Password / api key to accept (default any)\n"
+                    " -n <count>    Customers to generate (default 10)\n"
+                    " -i <count>    Invoices waiting to be sent to generate (default 20)\n"
+                    " -x <count>    Rows per invoice (default 3)\n"
+                    " -a <bytes>    Size of a pdf attachment added to every invoice (default none)\n"
+                    " -s <seed>     Random seed of the generator (default 1)\n"
+                    "%s"
+                    " -h            Print out this help\n",
+                    argv[0], MockHttpServer::faultUsage());
+                return -1;
+        }
+    }
+    seedData(seed);
+    fprintf(stderr, "odoo_mock: %d customers, %d invoices sending, listening on port %d\n", seed.partners, seed.invoices, port);
+    MockHttpServer server(port, faults, handle);
+    return server.run() ? 0 : -1;
+}
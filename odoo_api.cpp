@@ -24,6 +24,8 @@
 #include <map>
 #include <sstream>
 #include "util.h"
+#include "request_governor.h"
+#include "attachment_relay.h"
 
 OdooAPI::OdooAPI(const std::string& url,
                  const std::string& db,
@@ -31,9 +33,61 @@ OdooAPI::OdooAPI(const std::string& url,
                  const std::string& apikey, const int companyId)
     : url_(url), db_(db), username_(username), apikey_(apikey), loggedOnCompanyId(companyId) {}
 
+// xmlrpc-c reports http failures only as text, e.g. "HTTP response code is 503, not 200"
+static long httpStatusFromError(const std::string& what) {
+    size_t pos = what.find("HTTP response code is ");
+    if (pos == std::string::npos) {
+        return 0;
+    }
+    return std::strtol(what.c_str() + pos + 22, nullptr, 10);
+}
+
+void OdooAPI::xmlrpcCall(const std::string& path, const std::string& method, const xmlrpc_c::paramList& params, xmlrpc_c::value* result, bool idempotent) {
+    const std::string endpoint = "odoo" + path.substr(path.rfind('/'));
+    RequestGovernor& governor = RequestGovernor::instance();
+
+    xmlrpc_c::clientXmlTransport_curl transport(
+        xmlrpc_c::clientXmlTransport_curl::constrOpt()
+            .connect_timeout(15000)
+            .timeout(300000));
+    xmlrpc_c::client_xml client(&transport);
+    xmlrpc_c::carriageParm_curl0 carriage(url_ + path);
+
+    for (int attempt = 0; ; attempt++) {
+        RequestGovernor::Outcome outcome;
+        std::string error;
+        xmlrpc_c::rpcPtr rpc(method, params);
+        {
+            GovernedRequest request(endpoint);
+            try {
+                rpc->call(&client, &carriage);
+            } catch (const std::exception& e) {
+                error = e.what();
+                outcome.http_status = httpStatusFromError(error);
+                outcome.transport_error = outcome.http_status == 0;
+            }
+            request.done(outcome);
+        }
+        if (error.empty()) {
+            if (!rpc->isSuccessful()) {
+                // a fault is a valid answer from the server, never retried
+                throw std::runtime_error(rpc->getFault().getDescription());
+            }
+            *result = rpc->getResult();
+            return;
+        }
+        if (!governor.shouldRetry(outcome, idempotent, attempt)) {
+            governor.countFailure(endpoint);
+            throw std::runtime_error(error);
+        }
+        LOG(INFO) << endpoint << ": transient failure (" << error << "), retrying";
+        governor.countRetry(endpoint);
+        governor.backoff(endpoint, outcome, attempt);
+    }
+}
+
 bool OdooAPI::authenticate() {
     try {
-        xmlrpc_c::clientSimple client;
         xmlrpc_c::value result;
 
         std::map<std::string, xmlrpc_c::value> empty_map;
@@ -45,12 +99,7 @@ bool OdooAPI::authenticate() {
         params.add(xmlrpc_c::value_string(apikey_));
         params.add(empty_struct);
 
-        client.call(
-            url_ + "/xmlrpc/2/common",
-            "authenticate",
-            params,
-            &result
-        );
+        xmlrpcCall("/xmlrpc/2/common", "authenticate", params, &result, true);
         if (result.type() == xmlrpc_c::value::TYPE_INT) {
             loggedOnUserId = xmlrpc_c::value_int(result);
             //LOG(INFO) << "Athentication ok, got loggedOnUserId: " << loggedOnUserId;
@@ -194,7 +243,6 @@ void add_filter(std::vector<xmlrpc_c::value>* domain, const std::string& field,
 bool OdooAPI::odooCommand(const std::string& method, const std::string& model, const xmlrpc_c::value_array& domain, xmlrpc_c::value* result, std::map<std::string, xmlrpc_c::value> *options) {
     has_error = false; // Reset error state before command execution
     try {
-        xmlrpc_c::clientSimple client;
         xmlrpc_c::paramList params;
         params.add(xmlrpc_c::value_string(db_));
         params.add(xmlrpc_c::value_int(loggedOnUserId));
@@ -213,7 +261,8 @@ bool OdooAPI::odooCommand(const std::string& method, const std::string& model, c
         else {
             params.add(xmlrpc_c::value_struct(opts));
         }
-        client.call(url_ + "/xmlrpc/2/object", "execute_kw", params, result);
+        // a repeated create would duplicate the record
+        xmlrpcCall("/xmlrpc/2/object", "execute_kw", params, result, method != "create");
 
         return true;
     } catch (const std::exception& e) {
@@ -260,7 +309,7 @@ std::string OdooAPI::getCompanyInfoByCompanyId(int companyId, std::string &taxco
     }
     return vat;
 }
-double OdooAPI::getCompanyTaxRatePercentById(int taxId){
+Decimal OdooAPI::getCompanyTaxRatePercentById(int taxId){
     // Get the percentage for the given tax id
     std::vector<xmlrpc_c::value> filters;
     add_filter(&filters, "id", "=", taxId);
@@ -275,17 +324,16 @@ double OdooAPI::getCompanyTaxRatePercentById(int taxId){
             if (doc.IsArray() && doc.Size() > 0) {
                 const rapidjson::Value& first_entry = doc[0];
                 if (first_entry.IsObject() && first_entry.HasMember("amount")&& first_entry["amount"].IsNumber()) {
-                    return first_entry["amount"].GetDouble();
+                    return Decimal::fromDouble(first_entry["amount"].GetDouble());
                 }
             }
         }
     }
-    return 0;
+    return Decimal();
 }
 
 int OdooAPI::getCompanyTaxId(std::string taxString, int companyId) {
 
-    if(taxString == "25.50") taxString="25.5";
     // Get the tax id for the given tax string
     std::vector<xmlrpc_c::value> filters;
     add_filter(&filters, "name", "=", taxString+"%");
@@ -648,15 +696,6 @@ int OdooAPI::createVendor(std::string const& taxCode, const FinvoiceInvoice& inv
 
     return vendor_id;
 }                  
-std::string decimalFormat(const std::string& value) {
-    // Convert string "25,5" to "25.5"
-    //102.34434,55
-    if(value.empty()) return "0"; // Return 0 if input is empty
-
-    std::string formatted_value = value;
-    string_replaceall(formatted_value, ",", ".");
-    return formatted_value;
-}
 int OdooAPI::getFiscalPositionId(){
     // Get the fiscal position id for the company
     std::vector<xmlrpc_c::value> filters;
@@ -689,30 +728,16 @@ std::string insertDashesToDate(const std::string& date) {
     return date.substr(0, 4) + "-" + date.substr(4, 2) + "-" + date.substr(6, 2);
 }
 int OdooAPI::createVendorBillAttachment(const FinvoiceAttachment &attachment, int res_id) {
-    std::map<std::string, xmlrpc_c::value> vals;
-    add_val(vals, "name", "=", attachment.AttachmentName);
-    add_val(vals, "type", "=", "binary"); //attachment.AttachmentMimeType);
-    add_val(vals, "datas", "=", attachment.AttachmentContent);
-    add_val(vals, "res_model", "=", "account.move");
-    add_val(vals, "res_id", "=", res_id); // Link to the invoice, if res_id is 0, it can be linked later
-    add_val(vals, "mimetype", "=", attachment.AttachmentMimeType);
-    add_val(vals, "company_id", "=", loggedOnCompanyId);
-
-    std::vector<xmlrpc_c::value> records;
-    records.push_back(xmlrpc_c::value_struct(vals));
-
-    xmlrpc_c::value result;
-    if(odooCommand("create", "ir.attachment", records, &result)) {
-        rapidjson::Document doc;
-        if(convertResultToJson(result, doc)) {
-            if (doc.HasMember("result") && doc["result"].IsInt()) {
-                int attachment_id = doc["result"].GetInt();
-                LOG(INFO) << "New attachment created " << attachment.AttachmentName << " with id = " << attachment_id;
-                return attachment_id;
-            }
-        }
+    // streamed from its origin, or from the content held, into the request;
+    // xmlrpc-c would want a string of its own for the whole of it
+    AttachmentRelay relay(url_, db_, loggedOnUserId, apikey_);
+    int attachment_id = -1;
+    if (relay.create(attachment, "account.move", res_id, loggedOnCompanyId, attachment_id) != AttachmentRelay::Created) {
+        has_error = true;
+        return -1;
     }
-    return -1;
+    LOG(INFO) << "New attachment created " << attachment.AttachmentName << " with id = " << attachment_id;
+    return attachment_id;
 }
 int OdooAPI::createVendorBill(const FinvoiceInvoice& inv) {
 
@@ -773,13 +798,14 @@ int OdooAPI::createVendorBill(const FinvoiceInvoice& inv) {
         }
         add_val(line_vals, "name", "=", articlename);
 
-        if (!row.InvoicedQuantity.empty()) add_val(line_vals, "quantity", "=", std::stod(row.InvoicedQuantity));
-        else if (!row.DeliveredQuantity.empty()) add_val(line_vals, "quantity", "=", std::stod(row.DeliveredQuantity));
-        else if (!row.OrderedQuantity.empty()) add_val(line_vals, "quantity", "=", std::stod(row.OrderedQuantity));
+        if (!row.InvoicedQuantity.empty()) add_val(line_vals, "quantity", "=", Decimal::parseOrZero(row.InvoicedQuantity).toDouble());
+        else if (!row.DeliveredQuantity.empty()) add_val(line_vals, "quantity", "=", Decimal::parseOrZero(row.DeliveredQuantity).toDouble());
+        else if (!row.OrderedQuantity.empty()) add_val(line_vals, "quantity", "=", Decimal::parseOrZero(row.OrderedQuantity).toDouble());
 
-        add_val(line_vals, "price_unit", "=",  std::stod(decimalFormat(row.UnitPriceAmount)));
+        add_val(line_vals, "price_unit", "=",  Decimal::parseOrZero(row.UnitPriceAmount).toDouble());
 
-        int tax_id = getCompanyTaxId(decimalFormat(row.RowVatRatePercent), loggedOnCompanyId);
+        // tax names are like "25.5%", "14%"
+        int tax_id = getCompanyTaxId(Decimal::parseOrZero(row.RowVatRatePercent).toString(Decimal::shortest, '.'), loggedOnCompanyId);
 
         if(tax_id > 0) {
             std::vector<xmlrpc_c::value> tax_ids_vec;
@@ -828,6 +854,10 @@ int OdooAPI::createVendorBill(const FinvoiceInvoice& inv) {
         std::vector<int> att_odoo_ids;
         for(const auto& att : inv.attachments) {
             int aid = createVendorBillAttachment(att, billId);
+            if(aid <= 0) {
+                LOG(ERROR) << "Failed to attach " << att.AttachmentName << " to vendor bill " << billId;
+                return -1;
+            }
             att_odoo_ids.push_back(aid);
         }
         /*
@@ -881,12 +911,13 @@ int OdooAPI::OdooInvoiceToFinvoice(const rapidjson::Value& entry, FinvoiceInvoic
     invoice.InvoiceCurrencyCode = entry.HasMember("currency_id") && entry["currency_id"].IsArray() ? entry["currency_id"][1].GetString() : "EUR";
 
     invoice.InvoiceRecipientLanguageCode="FI";
-    invoice.InvoiceTotalVatExcludedAmount =  string_fmt_money(entry.HasMember("amount_untaxed_signed") && entry["amount_untaxed_signed"].IsNumber() ? entry["amount_untaxed_signed"].GetDouble() : 0);
-    invoice.InvoiceTotalVatAmount =  string_fmt_money(entry.HasMember("amount_tax_signed") && entry["amount_tax_signed"].IsNumber() ? entry["amount_tax_signed"].GetDouble() : 0);
-    invoice.InvoiceTotalVatIncludedAmount =  string_fmt_money(entry.HasMember("amount_total_signed") && entry["amount_total_signed"].IsNumber() ? entry["amount_total_signed"].GetDouble() : 0);
+    invoice.InvoiceTotalVatExcludedAmount =  string_fmt_money(Decimal::fromDouble(entry.HasMember("amount_untaxed_signed") && entry["amount_untaxed_signed"].IsNumber() ? entry["amount_untaxed_signed"].GetDouble() : 0));
+    invoice.InvoiceTotalVatAmount =  string_fmt_money(Decimal::fromDouble(entry.HasMember("amount_tax_signed") && entry["amount_tax_signed"].IsNumber() ? entry["amount_tax_signed"].GetDouble() : 0));
+    invoice.InvoiceTotalVatIncludedAmount =  string_fmt_money(Decimal::fromDouble(entry.HasMember("amount_total_signed") && entry["amount_total_signed"].IsNumber() ? entry["amount_total_signed"].GetDouble() : 0));
 
-    double RowsTotalVatExcludedAmount = 0;
-    double RowsTotal = 0;
+    // summed exactly, the row amounts are rounded only when formatted
+    Decimal RowsTotalVatExcludedAmount;
+    Decimal RowsTotal;
     if(entry.HasMember("invoice_line_ids") && entry["invoice_line_ids"].IsArray() ){
         auto rows = entry["invoice_line_ids"].GetArray();
         for(int i=0; i < rows.Size(); i++) {
@@ -896,31 +927,18 @@ int OdooAPI::OdooInvoiceToFinvoice(const rapidjson::Value& entry, FinvoiceInvoic
                 if(getInvoiceRowById(docrow, rowId)) {
                    const rapidjson::Value& myrow = docrow[0];
                     InvoiceRow ir;
-                    double unitPriceAmount =  myrow.HasMember("price_unit") && myrow["price_unit"].IsNumber() ? myrow["price_unit"].GetDouble() : 0;
-                    int quantity =  myrow.HasMember("quantity") && myrow["quantity"].IsNumber() ? myrow["quantity"].GetInt() : 0;
-                    double taxrate = getCompanyTaxRatePercentById(myrow.HasMember("tax_ids") && myrow["tax_ids"].IsArray() && myrow["tax_ids"].Size()>0 && myrow["tax_ids"][0].IsInt() ? myrow["tax_ids"][0].GetInt() : -1);
-                    double pricesubtotal = myrow.HasMember("price_subtotal") && myrow["price_subtotal"].IsNumber() ? myrow["price_subtotal"].GetDouble() : 0;   
+                    Decimal unitPriceAmount =  Decimal::fromDouble(myrow.HasMember("price_unit") && myrow["price_unit"].IsNumber() ? myrow["price_unit"].GetDouble() : 0);
+                    Decimal quantity =  Decimal::fromDouble(myrow.HasMember("quantity") && myrow["quantity"].IsNumber() ? myrow["quantity"].GetDouble() : 0);
+                    Decimal taxrate = getCompanyTaxRatePercentById(myrow.HasMember("tax_ids") && myrow["tax_ids"].IsArray() && myrow["tax_ids"].Size()>0 && myrow["tax_ids"][0].IsInt() ? myrow["tax_ids"][0].GetInt() : -1);
+                    Decimal pricesubtotal = Decimal::fromDouble(myrow.HasMember("price_subtotal") && myrow["price_subtotal"].IsNumber() ? myrow["price_subtotal"].GetDouble() : 0);
 
                     RowsTotalVatExcludedAmount += pricesubtotal;
-                    ir.RowVatRatePercent = string_fmt_money(taxrate);
                     ir.UnitPriceAmount = string_fmt_money(unitPriceAmount);
-                    ir.OrderedQuantity = std::to_string(quantity);
+                    ir.OrderedQuantity = quantity.toString(Decimal::shortest);
                     ir.DeliveredQuantity=ir.OrderedQuantity;
                     ir.InvoicedQuantity=ir.OrderedQuantity;
 
-                    ir.RowVatAmount = "0";
-                    if(taxrate > 0) {
-                        ir.RowVatAmount = string_fmt_money(pricesubtotal * (taxrate / 100));
-                    }
-                    ir.RowVatExcludedAmount = string_fmt_money(pricesubtotal);
-                    ir.RowVatIncludedAmount = string_fmt_money(pricesubtotal);
-                    if(taxrate > 0) {
-                        ir.RowVatIncludedAmount = string_fmt_money(pricesubtotal + pricesubtotal * taxrate / 100);
-                    }
-                    RowsTotal += (pricesubtotal);
-                    if(taxrate > 0) {
-                        RowsTotal += (pricesubtotal * taxrate / 100);
-                    } 
+                    RowsTotal += setRowVatAmounts(ir, pricesubtotal, taxrate);
 
                     ir.ArticleName = myrow.HasMember("name") && myrow["name"].IsString() ? myrow["name"].GetString() : "";
                     
@@ -935,7 +953,7 @@ int OdooAPI::OdooInvoiceToFinvoice(const rapidjson::Value& entry, FinvoiceInvoic
             }
         }
     }
-    invoice.RowsTotalVatExcludedAmount = std::to_string(RowsTotalVatExcludedAmount);
+    invoice.RowsTotalVatExcludedAmount = string_fmt_money(RowsTotalVatExcludedAmount);
 
 
 //seller info
@@ -1111,7 +1129,7 @@ bool OdooAPI::getVendorBillAttachmentById(int attId, int res_id, FinvoiceAttachm
                 if (entry.HasMember("mimetype") && entry["mimetype"].IsString())
                     att.AttachmentMimeType = entry["mimetype"].GetString();
                 if (entry.HasMember("datas") && entry["datas"].IsString())
-                    att.AttachmentContent = entry["datas"].GetString();
+                    att.AttachmentContent.assign(std::string_view(entry["datas"].GetString(), entry["datas"].GetStringLength()));
                 if (entry.HasMember("id") && entry["id"].IsInt())
                     att.odooAttachmentId = entry["id"].GetInt();
                 return true;
@@ -1191,7 +1209,7 @@ bool OdooAPI::updateDomainField(std::string domain, int domain_id, const std::st
     }
     return false;
 }
-int OdooAPI::processUnsentInvoices(std::function<std::string (const rapidjson::Value& entry, std::string odoo_maventa_status, std::string maventa_invoice_identifier, FinvoiceInvoice &invoice, bool &send_confirmed, std::string &send_error_msg)> processInvoiceCallback, int lastHowManyDays) {
+bool OdooAPI::getUnsentInvoices(rapidjson::Document &doc) {
     // Find unsent invoices
     std::vector<xmlrpc_c::value> filters;
     add_filter(&filters, "move_type", "=", "out_invoice");
@@ -1203,125 +1221,82 @@ int OdooAPI::processUnsentInvoices(std::function<std::string (const rapidjson::V
 
     xmlrpc_c::value result;
     bool success = odooCommand("search_read", "account.move", domain, &result);
-    rapidjson::Document doc;
+    return success && convertResultToJson(result, doc) && doc.IsArray();
+}
 
-    int successfully_sent = 0;
-    if(success && convertResultToJson(result, doc)) {
-         // Parse ret_str as JSON array to check if any results exist
-        
-        if (doc.IsArray() ) {
-            if(!doc.Empty() && doc.Size() > 0) {
-                //LOG(INFO) << "Found " << doc.Size() << " unsent invoices";
-                // Enumerate over array entries
-                for (rapidjson::SizeType i = 0; i < doc.Size(); ++i) {
-                    const rapidjson::Value& entry = doc[i];
-                    std::string x_studio_eio_invoice_identifier="";
-                    std::string x_studio_eio_ovt="";
-                    std::string BuyerOrganisationTaxCode="";
-                    std::string BuyerStreetName="";
-                    std::string BuyerTownName="";
-                    std::string BuyerPostCodeIdentifier="";
-                    std::string BuyerOVT="";
-                    std::string BuyerIntermediator="";
-                    std::string x_studio_maventa_status="";
-                    if (entry.IsObject()) {
-                        if(entry.HasMember("x_studio_maventa_status") && entry["x_studio_maventa_status"].IsString()) {
-                            x_studio_maventa_status = entry["x_studio_maventa_status"].GetString();
-                        }
-                        if(entry.HasMember("x_studio_eio_invoice_identifier") && entry["x_studio_eio_invoice_identifier"].IsString()) {
-                            x_studio_eio_invoice_identifier = entry["x_studio_eio_invoice_identifier"].GetString();
-                        }
-                        
-                        if(x_studio_maventa_status == "sending") {
-                            int buyer_id = 0;
-                            if(entry.HasMember("partner_id") && entry["partner_id"].IsArray() && entry["partner_id"].Size() > 0) {
-                                buyer_id = entry["partner_id"][0].GetInt();
-                                getCompanyInfoByCompanyId(buyer_id, 
-                                    BuyerOrganisationTaxCode,
-                                    BuyerStreetName,
-                                    BuyerTownName,
-                                    BuyerPostCodeIdentifier,
-                                    BuyerOVT, 
-                                    BuyerIntermediator);
-                            }
-                            if(BuyerOVT !="" && BuyerIntermediator != "") {
-                                FinvoiceInvoice invoice;
-                                invoice.buyer.BuyerOrganisationTaxCode = BuyerOrganisationTaxCode;
-                                invoice.buyer.BuyerStreetName = BuyerStreetName;
-                                invoice.buyer.BuyerTownName = BuyerTownName;
-                                invoice.buyer.BuyerPostCodeIdentifier = BuyerPostCodeIdentifier;
-                                invoice.buyer.BuyerOVT = BuyerOVT;
-                                invoice.buyer.BuyerIntermediator = BuyerIntermediator;
-
-                                int invoiceId = entry.HasMember("id") && entry["id"].IsInt() ? entry["id"].GetInt() : -1;
-                                if(invoiceId > 0) {
-                                    // Call the callback function to process the invoice
-                                    bool send_confirmed = false;
-                                    std::string send_error_msg;
-                                    std::string maventa_invoice_id = processInvoiceCallback(entry, x_studio_maventa_status, x_studio_eio_invoice_identifier, invoice, send_confirmed, send_error_msg);
-                                    if(!maventa_invoice_id.empty()) {
-                                        // save the maventa invoice id to odoo, and update status
-                                        updateDomainField("account.move", invoiceId, "x_studio_eio_invoice_identifier", maventa_invoice_id);
-                                        if(send_confirmed){
-                                            updateDomainField("account.move", invoiceId, "x_studio_maventa_status", "senddone");
-                                            LOG(INFO) << "Invoice processed and send confirmed: " << maventa_invoice_id << " for invoice: " << invoice.InvoiceNumber;
-                                        }
-                                        if(!send_error_msg.empty()){
-                                            updateDomainField("account.move", invoiceId, "x_studio_maventa_status", "senderror");
-                                            updateDomainField("account.move", invoiceId, "x_studio_maventa_error", send_error_msg);
-                                            LOG(INFO) << "Invoice processed WITH ERROR: " << maventa_invoice_id << " for invoice: " << invoice.InvoiceNumber << " error message: " << send_error_msg;
-                                            continue;
-                                        }
-                                        
-                                        //LOG(INFO) << "Invoice processed and updated with maventa_invoice_id: " << maventa_invoice_id << " for invoice: " << invoice.InvoiceNumber;
-                                        successfully_sent++;
-                                    }
-                                    else {
-                                        LOG(ERROR) << "Processing invoice callback failed for invoice, did not get a maventa_invoice_id: " << invoice.InvoiceNumber;
-                                    }
-                                }
-                                else {
-                                    int invoiceId = entry.HasMember("id") && entry["id"].IsInt() ? entry["id"].GetInt() : -1;
-                                    LOG(ERROR) << "Failed to convert Odoo invoice to Finvoice: " << invoiceId;
-                                    std::string errormsg = "Failed to convert Odoo invoice to Finvoice: Uknown reason";
-                                    updateDomainField("account.move", invoiceId, "x_studio_maventa_status", "senderror");
-                                    updateDomainField("account.move", invoiceId, "x_studio_maventa_error", errormsg);
-                                }
-                            }
-                            else {
-                                std::string partner_name = "";
-                                if(entry.HasMember("partner_id") && entry["partner_id"].IsArray()) {
-                                    const rapidjson::Value& partner = entry["partner_id"];
-                                    if(partner.Size() > 1 && partner[1].IsString()) {
-                                        partner_name = partner[1].GetString();
-                                    }
-                                }    
-                                else if(entry.HasMember("invoice_partner_display_name")) {
-                                    partner_name = entry["invoice_partner_display_name"].GetString();
-                                }
-                                else if(entry.HasMember("invoice_partner_display_name")) {
-                                    partner_name = entry["invoice_partner_display_name"].GetString();
-                                }
-                                int invoiceId = entry.HasMember("id") && entry["id"].IsInt() ? entry["id"].GetInt() : -1;
-                                LOG(INFO) << "Skipping invoice (id: " << std::to_string(invoiceId) << ", to: "<< partner_name << "). Missing OVT/Intermediator. Fix and re-send!";
-                                std::string errormsg = partner_name + std::string(" is missing OVT/Intermediator");
-                                updateDomainField("account.move", invoiceId, "x_studio_maventa_status", "senderror");
-                                updateDomainField("account.move", invoiceId, "x_studio_maventa_error", errormsg);
-                            }
-                        }
-                        else {
-                            LOG(INFO) << "Skipping invoice not sending: " << x_studio_eio_invoice_identifier << " " << BuyerOVT << " " << BuyerIntermediator << std::endl;    
-                        }
-                    }
-                }
-                return successfully_sent; // Number of unsent invoices processed
-            }
-            else {
-                //LOG(DEBUG) << "No entries found in search_read result.";
-                return 0; // No entries found
-            }
-        } 
-        return 0; //no invoices to process
+std::string OdooAPI::prepareUnsentInvoice(const rapidjson::Value& entry, FinvoiceInvoice &invoice) {
+    std::string BuyerOrganisationTaxCode="";
+    std::string BuyerStreetName="";
+    std::string BuyerTownName="";
+    std::string BuyerPostCodeIdentifier="";
+    std::string BuyerOVT="";
+    std::string BuyerIntermediator="";
+
+    int buyer_id = 0;
+    if(entry.HasMember("partner_id") && entry["partner_id"].IsArray() && entry["partner_id"].Size() > 0) {
+        buyer_id = entry["partner_id"][0].GetInt();
+        getCompanyInfoByCompanyId(buyer_id, 
+            BuyerOrganisationTaxCode,
+            BuyerStreetName,
+            BuyerTownName,
+            BuyerPostCodeIdentifier,
+            BuyerOVT, 
+            BuyerIntermediator);
+    }
+    if(BuyerOVT !="" && BuyerIntermediator != "") {
+        invoice.buyer.BuyerOrganisationTaxCode = BuyerOrganisationTaxCode;
+        invoice.buyer.BuyerStreetName = BuyerStreetName;
+        invoice.buyer.BuyerTownName = BuyerTownName;
+        invoice.buyer.BuyerPostCodeIdentifier = BuyerPostCodeIdentifier;
+        invoice.buyer.BuyerOVT = BuyerOVT;
+        invoice.buyer.BuyerIntermediator = BuyerIntermediator;
+
+        int invoiceId = entry.HasMember("id") && entry["id"].IsInt() ? entry["id"].GetInt() : -1;
+        if(invoiceId <= 0) {
+            LOG(ERROR) << "Failed to convert Odoo invoice to Finvoice: " << invoiceId;
+            return "Failed to convert Odoo invoice to Finvoice: Uknown reason";
+        }
+        return "";
     }
-    return 0; // Command failed
-}
\ No newline at end of file
+    std::string partner_name = "";
+    if(entry.HasMember("partner_id") && entry["partner_id"].IsArray()) {
+        const rapidjson::Value& partner = entry["partner_id"];
+        if(partner.Size() > 1 && partner[1].IsString()) {
+            partner_name = partner[1].GetString();
+        }
+    }    
+    else if(entry.HasMember("invoice_partner_display_name")) {
+        partner_name = entry["invoice_partner_display_name"].GetString();
+    }
+    int invoiceId = entry.HasMember("id") && entry["id"].IsInt() ? entry["id"].GetInt() : -1;
+    LOG(INFO) << "Skipping invoice (id: " << std::to_string(invoiceId) << ", to: "<< partner_name << "). Missing OVT/Intermediator. Fix and re-send!";
+    return partner_name + std::string(" is missing OVT/Intermediator");
+}
+
+bool OdooAPI::storeSendResult(int invoiceId, const FinvoiceInvoice &invoice, const std::string &maventa_invoice_id, bool send_confirmed, const std::string &send_error_msg) {
+    if(maventa_invoice_id.empty()) {
+        if(!send_error_msg.empty()) {
+            // never reached maventa
+            updateDomainField("account.move", invoiceId, "x_studio_maventa_status", "senderror");
+            updateDomainField("account.move", invoiceId, "x_studio_maventa_error", send_error_msg);
+        }
+        else {
+            LOG(ERROR) << "Processing invoice callback failed for invoice, did not get a maventa_invoice_id: " << invoice.InvoiceNumber;
+        }
+        return false;
+    }
+    // save the maventa invoice id to odoo, and update status
+    updateDomainField("account.move", invoiceId, "x_studio_eio_invoice_identifier", maventa_invoice_id);
+    if(send_confirmed){
+        updateDomainField("account.move", invoiceId, "x_studio_maventa_status", "senddone");
+        LOG(INFO) << "Invoice processed and send confirmed: " << maventa_invoice_id << " for invoice: " << invoice.InvoiceNumber;
+    }
+    if(!send_error_msg.empty()){
+        updateDomainField("account.move", invoiceId, "x_studio_maventa_status", "senderror");
+        updateDomainField("account.move", invoiceId, "x_studio_maventa_error", send_error_msg);
+        LOG(INFO) << "Invoice processed WITH ERROR: " << maventa_invoice_id << " for invoice: " << invoice.InvoiceNumber << " error message: " << send_error_msg;
+        return false;
+    }
+    //LOG(INFO) << "Invoice processed and updated with maventa_invoice_id: " << maventa_invoice_id << " for invoice: " << invoice.InvoiceNumber;
+    return true;
+}
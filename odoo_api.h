@@ -22,16 +22,20 @@
 #pragma once
 #include <xmlrpc-c/base.hpp>
 #include <xmlrpc-c/client_simple.hpp>
+#include <xmlrpc-c/client.hpp>
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
 
 #include <string>
 #include "finvoice_invoice.h"
+#include "decimal.h"
 #include <functional>
 
 class OdooAPI {
     bool has_error = false;
 
+    // Governed XML-RPC call, throws on fault like clientSimple::call
+    void xmlrpcCall(const std::string& path, const std::string& method, const xmlrpc_c::paramList& params, xmlrpc_c::value* result, bool idempotent);
     bool convertResultToJson(const xmlrpc_c::value& result, rapidjson::Document &doc);
     bool odooCommand(const std::string& method, const std::string& model, const xmlrpc_c::value_array& domain, xmlrpc_c::value* result, std::map<std::string, xmlrpc_c::value> *options = nullptr);
     int vendorExists_ex(std::string const& taxCode);
@@ -46,7 +50,7 @@ class OdooAPI {
     int findCountryId(std::string countryName);
 
     bool getInvoiceRowById(rapidjson::Document &doc, int rowId);
-    double getCompanyTaxRatePercentById(int taxId);
+    Decimal getCompanyTaxRatePercentById(int taxId);
     bool getBankAccountBic(int partner_bank_id, std::string &bic, std::string &bankName, std::string &accNumber);
 
     bool updateDomainField(std::string domain, int domain_id, const std::string &fieldName, const std::string &fieldValue);
@@ -70,7 +74,13 @@ public:
     bool vendorBillExists(const std::string& eioInvoiceIdentifier);
     int createVendorBill(const FinvoiceInvoice& inv);
     int createVendorBillAttachment(const FinvoiceAttachment &attachment, int res_id=0);
-    int processUnsentInvoices(std::function<std::string (const rapidjson::Value& entry, std::string odoo_maventa_status, std::string maventa_invoice_identifier, FinvoiceInvoice &invoice, bool &send_confirmed, std::string &send_error_msg)> processInvoiceCallback, int lastHowManyDays=30);
+    // Sending sales invoices: getUnsentInvoices lists the invoices marked for
+    // sending, prepareUnsentInvoice reads one into a FinvoiceInvoice and
+    // returns the error to store when it cannot be sent, storeSendResult
+    // writes the outcome of the send back to the invoice.
+    bool getUnsentInvoices(rapidjson::Document &doc);
+    std::string prepareUnsentInvoice(const rapidjson::Value& entry, FinvoiceInvoice &invoice);
+    bool storeSendResult(int invoiceId, const FinvoiceInvoice &invoice, const std::string &maventa_invoice_id, bool send_confirmed, const std::string &send_error_msg);
     int OdooInvoiceToFinvoice(const rapidjson::Value& entry, FinvoiceInvoice& invoice);
     bool getVendorBillAttachmentById(int attId, int res_id, FinvoiceAttachment& att);
 private:
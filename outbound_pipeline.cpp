@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "outbound_pipeline.h"
+#include "util.h"
+#include <algorithm>
+#include <functional>
+
+OutboundPipeline::OutboundPipeline(OdooAPI &odooApi, MaventaAPI &maventaApi, const std::string &profileName, const Workers &w)
+    : odoo(odooApi), maventa(maventaApi), profile_name(profileName), workers(w),
+      to_build(w.queue_size), to_zip(w.queue_size), to_upload(w.queue_size), to_write(w.queue_size),
+      // the zip workers deflate too, together they take every core
+      deflate_pool(std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - std::max(1, w.zip))) {}
+
+static void startWorkers(std::vector<std::thread> &threads, int count, const std::function<void()> &work) {
+    for (int i = 0; i < std::max(1, count); i++) {
+        threads.emplace_back(work);
+    }
+}
+static void joinWorkers(std::vector<std::thread> &threads) {
+    for (auto &t : threads) {
+        t.join();
+    }
+    threads.clear();
+}
+
+int OutboundPipeline::run(int lastHowManyDays) {
+    sent = 0;
+    rapidjson::Document doc;
+    if (!odoo.getUnsentInvoices(doc)) {
+        return 0;
+    }
+    std::vector<std::thread> build, zip, upload, write;
+    startWorkers(build, workers.build, [this, lastHowManyDays]() { buildStage(lastHowManyDays); });
+    startWorkers(zip, workers.zip, [this]() { zipStage(); });
+    startWorkers(upload, workers.upload, [this]() { uploadStage(); });
+    startWorkers(write, workers.write, [this]() { writeStage(); });
+
+    // fetch stage
+    for (rapidjson::SizeType i = 0; i < doc.Size(); ++i) {
+        const rapidjson::Value& entry = doc[i];
+        if (!entry.IsObject()) {
+            continue;
+        }
+        JobPtr job = std::make_unique<Job>();
+        job->entry.CopyFrom(entry, job->entry.GetAllocator());
+        job->invoiceId = entry.HasMember("id") && entry["id"].IsInt() ? entry["id"].GetInt() : -1;
+        if (entry.HasMember("x_studio_maventa_status") && entry["x_studio_maventa_status"].IsString()) {
+            job->maventa_status = entry["x_studio_maventa_status"].GetString();
+        }
+        if (entry.HasMember("x_studio_eio_invoice_identifier") && entry["x_studio_eio_invoice_identifier"].IsString()) {
+            job->maventa_invoice_identifier = entry["x_studio_eio_invoice_identifier"].GetString();
+        }
+        if (job->maventa_status != "sending") {
+            LOG(INFO) << "Skipping invoice not sending: " << job->maventa_invoice_identifier;
+            continue;
+        }
+        to_build.push(std::move(job));
+    }
+
+    // every stage can hand jobs to write, so it is closed last
+    to_build.close();
+    joinWorkers(build);
+    to_zip.close();
+    joinWorkers(zip);
+    to_upload.close();
+    joinWorkers(upload);
+    to_write.close();
+    joinWorkers(write);
+    return sent;
+}
+
+void OutboundPipeline::buildStage(int lastHowManyDays) {
+    OdooAPI odooApi = odoo; // xmlrpc state is per call, a copy per worker keeps has_error apart
+    JobPtr job;
+    while (to_build.pop(job)) {
+        job->send_error_msg = odooApi.prepareUnsentInvoice(job->entry, job->invoice);
+        if (!job->send_error_msg.empty()) {
+            to_write.push(std::move(job));
+            continue;
+        }
+        if (!job->maventa_invoice_identifier.empty()) {
+            //means we have sent to maventa but we have not get confirmation yet
+            std::lock_guard<std::mutex> lock(maventa_mutex);
+            maventa.getSentInvoiceStatus(job->maventa_invoice_identifier, job->send_confirmed, job->send_error_msg, lastHowManyDays);
+            job->maventa_invoice_id = job->maventa_invoice_identifier;
+            to_write.push(std::move(job));
+            continue;
+        }
+        odooApi.OdooInvoiceToFinvoice(job->entry, job->invoice);
+        maventa.buildInvoiceXml(job->invoice, job->soap, job->xml);
+        if (!maventa.validateXml(job->xml, job->send_error_msg)) {
+            // never sent, stored as senderror with the violations
+            to_write.push(std::move(job));
+            continue;
+        }
+        to_zip.push(std::move(job));
+    }
+}
+
+void OutboundPipeline::zipStage() {
+    JobPtr job;
+    while (to_zip.pop(job)) {
+        if (!maventa.zipInvoice(job->invoice, job->soap, job->xml, job->zip, &deflate_pool)) {
+            job->maventa_invoice_id = "-1";
+            job->send_error_msg = "Failed to upload invoice to Maventa";
+            LOG(ERROR) << profile_name << ": Failed to zip invoice " << job->invoice.InvoiceNumber;
+            to_write.push(std::move(job));
+            continue;
+        }
+        // the archive holds everything that is sent, drop the sources early
+        std::string().swap(job->soap);
+        std::string().swap(job->xml);
+        for (auto &attachment : job->invoice.attachments) {
+            attachment.AttachmentContent.clear();
+        }
+        to_upload.push(std::move(job));
+    }
+}
+
+void OutboundPipeline::uploadStage() {
+    JobPtr job;
+    while (to_upload.pop(job)) {
+        std::string maventa_invoice_id = maventa.uploadInvoiceZip(job->zip);
+        std::string().swap(job->zip);
+        if (maventa_invoice_id.empty() || maventa_invoice_id == "-1") {
+            job->maventa_invoice_id = "-1";
+            job->send_error_msg = "Failed to upload invoice to Maventa";
+            LOG(ERROR) << profile_name << ": Failed to upload invoice " << job->invoice.InvoiceNumber << " to Maventa";
+        } else {
+            job->maventa_invoice_id = maventa_invoice_id;
+            LOG(INFO) << profile_name << ": Sales invoice sent to to maventa: " << job->invoice.InvoiceNumber
+                    << ", Seller: " << job->invoice.seller.SellerOrganisationName
+                    << ", Buyer: " << job->invoice.buyer.BuyerOrganisationName
+                    << " maventa_id: " << maventa_invoice_id;
+        }
+        to_write.push(std::move(job));
+    }
+}
+
+void OutboundPipeline::writeStage() {
+    OdooAPI odooApi = odoo;
+    JobPtr job;
+    while (to_write.pop(job)) {
+        if (odooApi.storeSendResult(job->invoiceId, job->invoice, job->maventa_invoice_id, job->send_confirmed, job->send_error_msg)) {
+            sent++;
+        }
+    }
+}
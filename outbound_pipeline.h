@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <rapidjson/document.h>
+#include "bounded_queue.h"
+#include "task_pool.h"
+#include "finvoice_invoice.h"
+#include "odoo_api.h"
+#include "maventa_api.h"
+
+// Sends the Odoo invoices waiting in "sending" to Maventa as a staged pipeline:
+//
+//   fetch -> build -> zip -> upload -> write
+//
+// fetch reads the pending invoices from Odoo, build converts one to Finvoice
+// (or looks up the delivery state of an already uploaded one), zip packs the
+// message with its attachments, upload posts it to Maventa and write stores
+// the result in Odoo. Stages are connected by bounded queues so at most a few
+// invoices per stage are in memory, and each stage runs its own workers so the
+// Odoo calls, the zipping and the Maventa upload overlap. An invoice passes
+// the stages in order and all of its status fields are written by one worker,
+// so the status updates of an invoice keep their order.
+class OutboundPipeline {
+public:
+    struct Workers {
+        int build = 2;
+        int zip = 1;
+        int upload = 2;
+        int write = 2;
+        int queue_size = 4; // invoices waiting between two stages
+    };
+
+    OutboundPipeline(OdooAPI &odooApi, MaventaAPI &maventaApi, const std::string &profileName, const Workers &workers);
+
+    // Returns the number of invoices sent or confirmed
+    int run(int lastHowManyDays = 7);
+
+private:
+    struct Job {
+        int invoiceId = -1;
+        rapidjson::Document entry; // own copy of the account.move row
+        std::string maventa_status;
+        std::string maventa_invoice_identifier;
+        FinvoiceInvoice invoice;
+        std::string soap;
+        std::string xml;
+        std::string zip;
+        std::string maventa_invoice_id;
+        bool send_confirmed = false;
+        std::string send_error_msg;
+    };
+    using JobPtr = std::unique_ptr<Job>;
+
+    void buildStage(int lastHowManyDays);
+    void zipStage();
+    void uploadStage();
+    void writeStage();
+
+    OdooAPI &odoo;
+    MaventaAPI &maventa;
+    std::string profile_name;
+    Workers workers;
+
+    BoundedQueue<JobPtr> to_build;
+    BoundedQueue<JobPtr> to_zip;
+    BoundedQueue<JobPtr> to_upload;
+    BoundedQueue<JobPtr> to_write;
+    // deflates the attachments of the invoices being zipped, shared by the
+    // zip workers for the whole run
+    TaskPool deflate_pool;
+
+    std::mutex maventa_mutex; // status lookups use the MaventaAPI caches
+    std::atomic<int> sent{0};
+};
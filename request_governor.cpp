@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "request_governor.h"
+#include "util.h"
+#include <algorithm>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+
+RequestGovernor& RequestGovernor::instance() {
+    static RequestGovernor governor;
+    return governor;
+}
+RequestGovernor::RequestGovernor() : rng_(std::random_device{}()) {
+    // conservative defaults, raised by the additive increase when the provider keeps up
+    limits_["maventa"] = { 10.0, 20.0, 8 };
+    limits_["odoo"] = { 5.0, 10.0, 4 };
+    limits_[""] = { 5.0, 5.0, 2 };
+}
+void RequestGovernor::configure(const std::string& prefix, double rate_per_second, double burst, int max_concurrency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    limits_[prefix] = { rate_per_second, burst, std::max(1, max_concurrency) };
+    for (auto& kv : endpoints_) {
+        if (string_startswith(kv.first, prefix)) {
+            kv.second.limits = limitsFor(kv.first);
+            kv.second.rate = std::min(kv.second.rate, kv.second.limits.rate);
+        }
+    }
+}
+RequestGovernor::Limits RequestGovernor::limitsFor(const std::string& name) const {
+    // longest matching prefix wins
+    const Limits* best = nullptr;
+    size_t bestlen = 0;
+    for (const auto& kv : limits_) {
+        if (string_startswith(name, kv.first) && (best == nullptr || kv.first.size() >= bestlen)) {
+            best = &kv.second;
+            bestlen = kv.first.size();
+        }
+    }
+    return *best;
+}
+RequestGovernor::Endpoint& RequestGovernor::endpoint(const std::string& name) {
+    auto it = endpoints_.find(name);
+    if (it != endpoints_.end()) {
+        return it->second;
+    }
+    Endpoint ep;
+    ep.limits = limitsFor(name);
+    ep.rate = ep.limits.rate;
+    ep.tokens = ep.limits.burst;
+    ep.refilled = clock::now();
+    ep.blocked_until = ep.refilled;
+    ep.last_decrease = ep.refilled;
+    ep.window = std::min(2, ep.limits.max_concurrency);
+    return endpoints_.emplace(name, ep).first->second;
+}
+void RequestGovernor::refill(Endpoint& ep, clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - ep.refilled).count();
+    ep.tokens = std::min(ep.limits.burst, ep.tokens + elapsed * ep.rate);
+    ep.refilled = now;
+}
+void RequestGovernor::decrease(Endpoint& ep, clock::time_point now, double factor) {
+    // at most one multiplicative decrease per round trip, bursts of errors
+    // from requests already in flight belong to the same congestion event
+    auto rtt = std::chrono::milliseconds(static_cast<long>(std::max(ep.ewma_latency_ms, 100.0)));
+    if (now - ep.last_decrease < rtt) {
+        return;
+    }
+    ep.window = std::max(1.0, ep.window * factor);
+    ep.last_decrease = now;
+}
+void RequestGovernor::acquire(const std::string& name) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Endpoint& ep = endpoint(name);
+    while (true) {
+        auto now = clock::now();
+        refill(ep, now);
+        clock::time_point wake = now;
+        if (ep.blocked_until > now) {
+            wake = ep.blocked_until;
+        } else if (ep.in_flight >= static_cast<int>(ep.window)) {
+            cv_.wait(lock); // woken up by release()
+            continue;
+        } else if (ep.tokens < 1.0) {
+            wake = now + std::chrono::microseconds(static_cast<long>((1.0 - ep.tokens) / ep.rate * 1e6));
+        } else {
+            ep.tokens -= 1.0;
+            ep.in_flight++;
+            ep.requests++;
+            ep.peak_in_flight = std::max(ep.peak_in_flight, ep.in_flight);
+            return;
+        }
+        cv_.wait_until(lock, wake);
+    }
+}
+void RequestGovernor::release(const std::string& name, clock::duration latency, const Outcome& outcome) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Endpoint& ep = endpoint(name);
+        auto now = clock::now();
+        ep.in_flight = std::max(0, ep.in_flight - 1);
+
+        double ms = std::chrono::duration<double, std::milli>(latency).count();
+        bool throttled = outcome.http_status == 429 || outcome.http_status == 503;
+        bool error = throttled || outcome.transport_error || outcome.http_status >= 500;
+        ep.ewma_error = 0.9 * ep.ewma_error + 0.1 * (error ? 1.0 : 0.0);
+
+        if (throttled) {
+            ep.throttled++;
+            // the provider says we are over its limit: slow the bucket down as well
+            ep.rate = std::max(0.2, ep.rate * 0.5);
+            ep.tokens = std::min(ep.tokens, 0.0);
+            decrease(ep, now, 0.5);
+        } else if (error) {
+            decrease(ep, now, 0.5);
+        } else {
+            if (ep.min_latency_ms == 0 || ms < ep.min_latency_ms) ep.min_latency_ms = ms;
+            ep.ewma_latency_ms = ep.ewma_latency_ms == 0 ? ms : 0.8 * ep.ewma_latency_ms + 0.2 * ms;
+            if (ep.ewma_latency_ms > 3.0 * ep.min_latency_ms + 50.0) {
+                // queueing on the server side, back off before it turns into errors
+                decrease(ep, now, 0.8);
+            } else if (ep.ewma_error < 0.05) {
+                // additive increase: about one slot per window of successful requests
+                ep.window = std::min<double>(ep.limits.max_concurrency, ep.window + 1.0 / ep.window);
+                ep.rate = std::min(ep.limits.rate, ep.rate + 0.1);
+            }
+        }
+        if (outcome.retry_after > 0) {
+            long seconds = std::min(outcome.retry_after, max_retry_after);
+            ep.blocked_until = std::max(ep.blocked_until, now + std::chrono::seconds(seconds));
+        }
+    }
+    cv_.notify_all();
+}
+bool RequestGovernor::shouldRetry(const Outcome& outcome, bool idempotent, int attempt) const {
+    if (attempt + 1 >= max_attempts) {
+        return false;
+    }
+    if (outcome.http_status == 429) {
+        return true; // rejected before processing, safe for any method
+    }
+    if (!idempotent) {
+        return false;
+    }
+    return outcome.transport_error ||
+           outcome.http_status == 408 ||
+           outcome.http_status == 502 ||
+           outcome.http_status == 503 ||
+           outcome.http_status == 504;
+}
+void RequestGovernor::backoff(const std::string& name, const Outcome& outcome, int attempt) {
+    if (outcome.retry_after >= 0) {
+        // the endpoint is blocked until then, the next acquire() waits
+        LOG(DEBUG) << name << ": retrying after " << std::min(outcome.retry_after, max_retry_after) << "s (attempt " << attempt + 1 << ")";
+        return;
+    }
+    // jittered: uniform in [cap/4, cap], cap = 500ms * 2^attempt up to 30s
+    std::chrono::milliseconds delay;
+    {
+        long cap = std::min<long>(max_retry_after * 1000, 500L << std::min(attempt, 6));
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::uniform_int_distribution<long> dis(cap / 4, cap);
+        delay = std::chrono::milliseconds(dis(rng_));
+    }
+    LOG(DEBUG) << name << ": retrying in " << delay.count() << "ms (attempt " << attempt + 1 << ")";
+    std::this_thread::sleep_for(delay);
+}
+void RequestGovernor::countRetry(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    endpoint(name).retries++;
+}
+void RequestGovernor::countFailure(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    endpoint(name).failures++;
+}
+std::string RequestGovernor::statistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream oss;
+    for (const auto& kv : endpoints_) {
+        const Endpoint& ep = kv.second;
+        if (oss.tellp() > 0) oss << "\n";
+        oss << kv.first
+            << ": requests " << ep.requests
+            << ", retries " << ep.retries
+            << ", failed " << ep.failures
+            << ", throttled " << ep.throttled
+            << ", window " << std::fixed << std::setprecision(1) << ep.window << "/" << ep.limits.max_concurrency
+            << ", peak in flight " << ep.peak_in_flight
+            << ", rate " << ep.rate << "/s"
+            << ", latency " << std::setprecision(0) << ep.ewma_latency_ms << "ms";
+    }
+    return oss.str();
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <string>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+
+// Shared request governor for the Maventa and Odoo APIs.
+//
+// Every endpoint (e.g. "maventa/invoices", "odoo/object") gets a token
+// bucket that paces the request rate and an AIMD concurrency window driven
+// by the observed latency and error rate. 429/503 responses shrink both,
+// Retry-After blocks the endpoint until the given time, and idempotent
+// calls are retried with exponential backoff and jitter.
+class RequestGovernor {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Outcome {
+        long http_status = 0;       // 0 when no response was received
+        bool transport_error = false; // connect failure, timeout, reset ...
+        long retry_after = -1;      // seconds, -1 if the server did not say
+    };
+
+    static RequestGovernor& instance();
+
+    // Overrides the defaults of all endpoints starting with prefix
+    void configure(const std::string& prefix, double rate_per_second, double burst, int max_concurrency);
+
+    // Blocks until endpoint has a token and a free concurrency slot
+    void acquire(const std::string& endpoint);
+    // Returns the slot taken by acquire() and feeds the outcome to the AIMD window
+    void release(const std::string& endpoint, clock::duration latency, const Outcome& outcome);
+
+    // True if the failed call should be tried again. Non idempotent calls are
+    // only repeated when the server tells us it did not process them (429).
+    bool shouldRetry(const Outcome& outcome, bool idempotent, int attempt) const;
+    // Sleeps before the next attempt with exponential backoff and jitter. A
+    // Retry-After is waited for by acquire() instead, release() blocked the
+    // endpoint until then.
+    void backoff(const std::string& endpoint, const Outcome& outcome, int attempt);
+
+    void countRetry(const std::string& endpoint);
+    void countFailure(const std::string& endpoint);
+
+    // One line per endpoint, for the run statistics
+    std::string statistics();
+
+    static const int max_attempts = 5;
+    // Longest Retry-After honoured, seconds, as long as the longest backoff
+    static constexpr long max_retry_after = 30;
+
+private:
+    struct Limits {
+        double rate;   // tokens per second
+        double burst;  // bucket size
+        int max_concurrency;
+    };
+    struct Endpoint {
+        Limits limits;
+        double rate;           // current rate, lowered on 429
+        double tokens;
+        clock::time_point refilled;
+        clock::time_point blocked_until;
+        double window;         // AIMD concurrency window
+        int in_flight = 0;
+        double ewma_latency_ms = 0;
+        double min_latency_ms = 0;
+        double ewma_error = 0;
+        clock::time_point last_decrease;
+
+        long requests = 0;
+        long retries = 0;
+        long failures = 0;
+        long throttled = 0;
+        int peak_in_flight = 0;
+    };
+
+    RequestGovernor();
+    Endpoint& endpoint(const std::string& name);
+    Limits limitsFor(const std::string& name) const;
+    void refill(Endpoint& ep, clock::time_point now);
+    void decrease(Endpoint& ep, clock::time_point now, double factor);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, Limits> limits_; // by endpoint prefix
+    std::map<std::string, Endpoint> endpoints_;
+    std::mt19937 rng_;
+};
+
+// Scope guard pairing acquire() and release() around a single request
+class GovernedRequest {
+public:
+    GovernedRequest(const std::string& endpoint)
+        : endpoint_(endpoint), started_(RequestGovernor::clock::now()) {
+        RequestGovernor::instance().acquire(endpoint_);
+    }
+    ~GovernedRequest() {
+        if (!released_) {
+            // left by an exception, count it as a failed request
+            RequestGovernor::Outcome failed;
+            failed.transport_error = true;
+            done(failed);
+        }
+    }
+    void done(const RequestGovernor::Outcome& outcome) {
+        RequestGovernor::instance().release(endpoint_, RequestGovernor::clock::now() - started_, outcome);
+        released_ = true;
+    }
+private:
+    std::string endpoint_;
+    RequestGovernor::clock::time_point started_;
+    bool released_ = false;
+};
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "secure_hash.h"
+#include <openssl/evp.h>
+#include <array>
+#include <stdexcept>
+
+namespace {
+
+// "000102...ff", the two characters of each byte value side by side
+constexpr std::array<char, 512> makeHexPairs() {
+    const char digits[] = "0123456789abcdef";
+    std::array<char, 512> pairs{};
+    for (int i = 0; i < 256; i++) {
+        pairs[2 * i] = digits[i >> 4];
+        pairs[2 * i + 1] = digits[i & 0x0F];
+    }
+    return pairs;
+}
+constexpr std::array<char, 512> hexPairs = makeHexPairs();
+
+} // namespace
+
+std::string hex_encode(const unsigned char *data, size_t len) {
+    std::string out(2 * len, '\0');
+    char *p = out.data();
+    for (size_t i = 0; i < len; i++, p += 2) {
+        p[0] = hexPairs[2 * data[i]];
+        p[1] = hexPairs[2 * data[i] + 1];
+    }
+    return out;
+}
+
+SecureHash::SecureHash(Algorithm algorithm) : ctx_(EVP_MD_CTX_new()) {
+    if (!ctx_ || !EVP_DigestInit_ex(ctx_, algorithm == Sha256 ? EVP_sha256() : EVP_sha1(), nullptr)) {
+        EVP_MD_CTX_free(ctx_);
+        throw std::runtime_error("cannot initialize message digest");
+    }
+}
+SecureHash::~SecureHash() {
+    EVP_MD_CTX_free(ctx_);
+}
+void SecureHash::update(const char *data, size_t len) {
+    EVP_DigestUpdate(ctx_, data, len);
+}
+std::string SecureHash::hexDigest() {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    EVP_DigestFinal_ex(ctx_, digest, &len);
+    return hex_encode(digest, len);
+}
+std::string SecureHash::hexDigest(Algorithm algorithm, const std::string &data) {
+    SecureHash hash(algorithm);
+    hash.update(data);
+    return hash.hexDigest();
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <string>
+#include <cstddef>
+
+struct evp_md_ctx_st;
+
+// Incremental message digest, data can be fed in arbitrary sized chunks
+// while it passes by for some other reason (decoding, zipping ...), so
+// that large attachments are not read once more just to be hashed.
+class SecureHash {
+public:
+    enum Algorithm {
+        Sha1,   // AttachmentSecureHash of Finvoice 3.0
+        Sha256,
+    };
+    explicit SecureHash(Algorithm algorithm = Sha1);
+    ~SecureHash();
+    SecureHash(const SecureHash&) = delete;
+    SecureHash& operator=(const SecureHash&) = delete;
+
+    void update(const char *data, size_t len);
+    void update(const std::string &data) { update(data.data(), data.size()); }
+    // Lowercase hex of the digest, the hash cannot be updated afterwards
+    std::string hexDigest();
+
+    static std::string hexDigest(Algorithm algorithm, const std::string &data);
+private:
+    evp_md_ctx_st *ctx_;
+};
+
+// Lowercase hex of len bytes, two characters per byte
+std::string hex_encode(const unsigned char *data, size_t len);
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "bounded_queue.h"
+
+// Fixed set of threads running the tasks submitted to it in order, for work
+// that one caller splits up and waits for, e.g. the entries of one archive.
+// Tasks must not wait for other tasks of the pool. The threads are joined
+// by the destructor once the tasks submitted so far have run.
+class TaskPool {
+public:
+    explicit TaskPool(size_t threads) : tasks_(threads ? threads * 4 : 1) {
+        for (size_t i = 0; i < threads; i++) {
+            threads_.emplace_back([this] {
+                std::function<void()> task;
+                while (tasks_.pop(task)) {
+                    task();
+                }
+            });
+        }
+    }
+    ~TaskPool() {
+        tasks_.close();
+        for (auto &t : threads_) {
+            t.join();
+        }
+    }
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    size_t size() const { return threads_.size(); }
+
+    // Ready once task has run; blocks while the queue is full
+    std::future<void> submit(std::function<void()> task) {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+        std::future<void> done = packaged->get_future();
+        tasks_.push([packaged] { (*packaged)(); });
+        return done;
+    }
+private:
+    BoundedQueue<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+// Amounts of outbound invoices as OdooInvoiceToFinvoice fills them in,
+// run by ctest. Prints the failed checks and exits non-zero on failure.
+#include "finvoice_invoice.h"
+#include "util.h"
+#include "logger.h"
+#include <iostream>
+
+INITIALIZE_EASYLOGGINGPP
+
+namespace {
+
+int failures = 0;
+
+void expect(const std::string &what, const std::string &got, const std::string &expected) {
+    if (got != expected) {
+        std::cout << what << ": got \"" << got << "\", expected \"" << expected << "\"\n";
+        failures++;
+    }
+}
+
+Decimal amount(const char *text) {
+    return Decimal::parseOrZero(text);
+}
+
+} // namespace
+
+int main() {
+    // a taxed row: the VAT included amount carries the VAT
+    InvoiceRow taxed;
+    Decimal taxedTotal = setRowVatAmounts(taxed, amount("100"), amount("25.5"));
+    expect("taxed RowVatRatePercent", taxed.RowVatRatePercent, "25,500");
+    expect("taxed RowVatAmount", taxed.RowVatAmount, "25,500");
+    expect("taxed RowVatExcludedAmount", taxed.RowVatExcludedAmount, "100,000");
+    expect("taxed RowVatIncludedAmount", taxed.RowVatIncludedAmount, "125,500");
+
+    // an untaxed row: VAT included equals VAT excluded
+    InvoiceRow untaxed;
+    Decimal untaxedTotal = setRowVatAmounts(untaxed, amount("80"), Decimal());
+    expect("untaxed RowVatAmount", untaxed.RowVatAmount, "0");
+    expect("untaxed RowVatIncludedAmount", untaxed.RowVatIncludedAmount, "80,000");
+
+    // VAT with more decimals than shown is rounded half away from zero
+    InvoiceRow fraction;
+    Decimal fractionTotal = setRowVatAmounts(fraction, amount("19.99"), amount("14"));
+    expect("fraction RowVatAmount", fraction.RowVatAmount, "2,799");
+    expect("fraction RowVatIncludedAmount", fraction.RowVatIncludedAmount, "22,789");
+
+    // a credit row
+    InvoiceRow credit;
+    Decimal creditTotal = setRowVatAmounts(credit, amount("-100"), amount("24"));
+    expect("credit RowVatAmount", credit.RowVatAmount, "-24,000");
+    expect("credit RowVatIncludedAmount", credit.RowVatIncludedAmount, "-124,000");
+
+    // EpiInstructedAmount: the exact VAT included totals, rounded once to cents
+    Decimal rowsTotal = taxedTotal + untaxedTotal + fractionTotal + creditTotal;
+    expect("EpiInstructedAmount", string_fmt_money(rowsTotal, 2), "104,29");
+    // RowsTotalVatExcludedAmount: three decimals like the other amounts
+    Decimal vatExcluded = amount("100") + amount("80") + amount("19.99") + amount("-100");
+    expect("RowsTotalVatExcludedAmount", string_fmt_money(vatExcluded), "99,990");
+
+    if (failures == 0) {
+        std::cout << "all amounts as expected\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -20,6 +20,7 @@
  * IN THE SOFTWARE.
  */
 #include "util.h"
+#include "base64.h"
 #include <cstdarg>
 #include <cstdio>       
 #include <string>   
@@ -31,6 +32,9 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 static constexpr char b64_table[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
@@ -55,60 +59,116 @@ std::string base64_encode(const ::std::string &bindata){
     const ::std::size_t binlen = bindata.size();
     // Use = signs so the end is properly padded.
     string retval((((binlen + 2) / 3) * 4), '=');
-    ::std::size_t outpos = 0;
-    int bits_collected = 0;
-    unsigned int accumulator = 0;
-    const string::const_iterator binend = bindata.end();
-
-    for (string::const_iterator i = bindata.begin(); i != binend; ++i) {
-        accumulator = (accumulator << 8) | (*i & 0xffu);
-        bits_collected += 8;
-        while (bits_collected >= 6) {
-            bits_collected -= 6;
-            retval[outpos++] = b64_table[(accumulator >> bits_collected) & 0x3fu];
-        }
-    }
-    if (bits_collected > 0) { // Any trailing bits that are missing.
-        //assert(bits_collected < 6);
-        accumulator <<= 6 - bits_collected;
-        retval[outpos++] = b64_table[accumulator & 0x3fu];
+    const unsigned char *in = reinterpret_cast<const unsigned char*>(bindata.data());
+    const ::std::size_t groups = binlen / 3;
+    base64::encodeGroups(in, groups, &retval[0]);
+
+    // trailing bytes that do not fill a group
+    in += groups * 3;
+    char *out = &retval[groups * 4];
+    if (binlen % 3 == 1) {
+        out[0] = b64_table[in[0] >> 2];
+        out[1] = b64_table[(in[0] & 0x03) << 4];
+    } else if (binlen % 3 == 2) {
+        out[0] = b64_table[in[0] >> 2];
+        out[1] = b64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+        out[2] = b64_table[(in[1] & 0x0f) << 2];
     }
-    //assert(outpos >= (retval.size() - 2));
-    //assert(outpos <= retval.size());
     return retval;
 }
 
-std::string base64_decode(const ::std::string &ascdata) {
-    using ::std::string;
-    string retval;
-    const string::const_iterator last = ascdata.end();
-    int bits_collected = 0;
-    unsigned int accumulator = 0;
+void Base64Encoder::reserve(size_t binlen) {
+    out_.reserve(out_.size() + ((binlen + 2) / 3) * 4);
+}
+void Base64Encoder::update(const char *data, size_t len) {
+    const unsigned char *in = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char *end = in + len;
+
+    // complete the group left over from the previous chunk
+    while (npending_ > 0 && npending_ < 3 && in != end) {
+        pending_[npending_++] = *in++;
+    }
+    if (npending_ == 3) {
+        char quad[4];
+        base64::encodeGroups(pending_, 1, quad);
+        out_.append(quad, 4);
+        npending_ = 0;
+    }
+
+    size_t groups = static_cast<size_t>(end - in) / 3;
+    if (groups > 0) {
+        size_t outpos = out_.size();
+        out_.resize(outpos + groups * 4);
+        base64::encodeGroups(in, groups, &out_[outpos]);
+        in += groups * 3;
+    }
+    while (in != end) {
+        pending_[npending_++] = *in++;
+    }
+}
+void Base64Encoder::finish() {
+    if (npending_ == 1) {
+        char quad[4] = { b64_table[pending_[0] >> 2], b64_table[(pending_[0] & 0x03) << 4], '=', '=' };
+        out_.append(quad, 4);
+    } else if (npending_ == 2) {
+        char quad[4] = {
+            b64_table[pending_[0] >> 2],
+            b64_table[((pending_[0] & 0x03) << 4) | (pending_[1] >> 4)],
+            b64_table[(pending_[1] & 0x0f) << 2],
+            '='
+        };
+        out_.append(quad, 4);
+    }
+    npending_ = 0;
+}
 
-    for (string::const_iterator i = ascdata.begin(); i != last; ++i) {
-        const int c = *i;
+void Base64Decoder::update(const char *data, size_t len) {
+    // Room for the most the input can decode to, trimmed to what was
+    // written before returning or throwing
+    size_t outpos = out_.size();
+    out_.resize(outpos + len / 4 * 3 + 3 + base64::decodeSlack);
+    size_t i = 0;
+    while (i < len) {
+        if (bits_collected_ == 0) {
+            // on a group boundary: the clean run up to the next line break,
+            // padding or illegal character goes through the block kernel
+            const size_t consumed = base64::decodeGroups(data + i, len - i, &out_[outpos]);
+            i += consumed;
+            outpos += consumed / 4 * 3;
+            if (i == len) {
+                break;
+            }
+        }
+        const int c = static_cast<unsigned char>(data[i++]);
         if (::std::isspace(c) || c == '=') {
             // Skip whitespace and padding. Be liberal in what you accept.
+            // A whole run at once, "\r\n" ends every line of MIME text.
+            while (i < len && (::std::isspace(static_cast<unsigned char>(data[i])) || data[i] == '=')) {
+                ++i;
+            }
             continue;
         }
-        if ((c > 127) || (c < 0) || (reverse_table[c] > 63)) {
+        if ((c > 127) || (reverse_table[c] > 63)) {
+            out_.resize(outpos);
             throw ::std::invalid_argument("This contains characters not legal in a base64 encoded string.");
         }
-        accumulator = (accumulator << 6) | reverse_table[c];
-        bits_collected += 6;
-        if (bits_collected >= 8) {
-            bits_collected -= 8;
-            retval += static_cast<char>((accumulator >> bits_collected) & 0xffu);
+        accumulator_ = (accumulator_ << 6) | reverse_table[c];
+        bits_collected_ += 6;
+        if (bits_collected_ >= 8) {
+            bits_collected_ -= 8;
+            out_[outpos++] = static_cast<char>((accumulator_ >> bits_collected_) & 0xffu);
         }
     }
+    out_.resize(outpos);
+}
+
+std::string base64_decode(const ::std::string &ascdata) {
+    ::std::string retval;
+    Base64Decoder(retval).update(ascdata.data(), ascdata.size());
     return retval;
 }
-std::string string_fmt_money(double value, int decimals) {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(decimals) << value;
-    std::string out= oss.str();
-    string_replaceall(out, ".", ","); // Ensure comma as decimal separator
-    return out;
+std::string string_fmt_money(Decimal value, int decimals) {
+    return value.toString(decimals, ','); // Finvoice uses comma as decimal separator
 }
 std::string getTimestamp(std::string format) {
     //2025-08-26T12:53:54
@@ -348,27 +408,87 @@ void string_replaceall(std::string& source, const std::string& from, const std::
 
     source.swap(newString);
 }
+// Length of the prefix of data that goes into a JSON string as is, up to
+// the first quote, backslash or control character
+static size_t jsonCleanPrefixLength(const char *data, size_t size) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    const __m256i backslash32 = _mm256_set1_epi8('\\');
+    const __m256i control32 = _mm256_set1_epi8(0x1f);
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, backslash32));
+        // unsigned v <= 0x1f
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(_mm256_min_epu8(v, control32), v));
+        int mask = _mm256_movemask_epi8(special);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        int mask = _mm_movemask_epi8(special);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < size; i++) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        if (c < 0x20 || c == '"' || c == '\\') return i;
+    }
+    return size;
+}
+
+static void appendJsonEscape(std::string &out, char c) {
+    switch (c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\b': out += "\\b"; break;
+    case '\f': out += "\\f"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\t': out += "\\t"; break;
+    default: {
+        static constexpr char hex[] = "0123456789abcdef";
+        const char u[6] = { '\\', 'u', '0', '0', hex[(c >> 4) & 0x1], hex[c & 0xf] };
+        out.append(u, 6);
+    }
+    }
+}
+
+// s escaped, the first escape being at clean
+static std::string escapeJsonFrom(std::string_view s, size_t clean) {
+    std::string out;
+    // the clean runs are copied as blocks, the escapes are few in Odoo
+    // values (line breaks of notes, quotes of names)
+    out.reserve(s.size() + s.size() / 8 + 16);
+    out.append(s.data(), clean);
+    for (size_t pos = clean; pos < s.size();) {
+        appendJsonEscape(out, s[pos++]);
+        const size_t run = jsonCleanPrefixLength(s.data() + pos, s.size() - pos);
+        out.append(s.data() + pos, run);
+        pos += run;
+    }
+    return out;
+}
 std::string escape_json(const std::string &s) {
-    std::ostringstream o;
-    for (auto c = s.cbegin(); c != s.cend(); c++) {
-        switch (*c) {
-        case '"': o << "\\\""; break;
-        case '\\': o << "\\\\"; break;
-        case '\b': o << "\\b"; break;
-        case '\f': o << "\\f"; break;
-        case '\n': o << "\\n"; break;
-        case '\r': o << "\\r"; break;
-        case '\t': o << "\\t"; break;
-        default:
-            if ('\x00' <= *c && *c <= '\x1f') {
-                o << "\\u"
-                  << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(*c);
-            } else {
-                o << *c;
-            }
-        }
+    const size_t clean = jsonCleanPrefixLength(s.data(), s.size());
+    if (clean == s.size()) {
+        return s;
+    }
+    return escapeJsonFrom(s, clean);
+}
+std::string escape_json(std::string &&s) {
+    const size_t clean = jsonCleanPrefixLength(s.data(), s.size());
+    if (clean == s.size()) {
+        return std::move(s);
     }
-    return o.str();
+    return escapeJsonFrom(s, clean);
 }
 const std::map<std::string, std::string> CountryNameToCode = {
     {"Afghanistan", "AF"},
@@ -42,9 +42,39 @@
 #include <stdlib.h>
 
 #include "logger.h"
+#include "log_policy.h"
+#include "decimal.h"
 
 std::string base64_encode(const ::std::string &bindata);
 std::string base64_decode(const ::std::string &ascdata);
+
+// Incremental base64 encoder, data can be fed in arbitrary sized chunks
+// (e.g. from a curl write callback). Partial 3-byte groups are carried
+// over to the next update(), finish() writes the tail and padding.
+class Base64Encoder {
+public:
+    explicit Base64Encoder(std::string &out) : out_(out) {}
+    void reserve(size_t binlen);
+    void update(const char *data, size_t len);
+    void finish();
+    void reset() { out_.clear(); npending_ = 0; }
+private:
+    std::string &out_;
+    unsigned char pending_[3];
+    size_t npending_ = 0;
+};
+// Incremental base64 decoder, the counterpart of Base64Encoder. Whitespace
+// and padding are skipped, illegal characters throw std::invalid_argument;
+// base64_decode() is a single update() of this.
+class Base64Decoder {
+public:
+    explicit Base64Decoder(std::string &out) : out_(out) {}
+    void update(const char *data, size_t len);
+private:
+    std::string &out_;
+    unsigned int accumulator_ = 0;
+    int bits_collected_ = 0;
+};
 std::string formattedString(const char *format, ...);
 std::string ReadFileContent(std::string filename);
 bool file_exists (const std::string& name);
@@ -54,9 +84,12 @@ bool string_startswith(const char* haystack, size_t haystackSize, const char* ne
 bool string_startswith(const std::string haystack, const std::string needle);
 bool string_endswith(const std::string& haystack, const std::string& needle);
 std::string string_trim(const std::string& str, const std::string& whitespace);
-std::string string_fmt_money(double value, int decimals=3);
+std::string string_fmt_money(Decimal value, int decimals=3);
 void string_replaceall(std::string& source, const std::string& from, const std::string& to);
+// Escapes text for a JSON string literal. Text without anything to escape
+// comes back as is, the rvalue overload then moves it instead of copying.
 std::string escape_json(const std::string &s);
+std::string escape_json(std::string &&s);
 std::string getCountryCodeFromName(const std::string& name);
 bool startsWithCountryCode(const std::string& str);
 std::string getFirstTwoChars(const std::string& str);
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "xml_reader.h"
+#include <charconv>
+#include <cstdint>
+
+void XmlReader::fail(const char *what) const {
+    throw std::runtime_error(what);
+}
+
+void XmlReader::skipPast(std::string_view token) {
+    std::string_view rest(p_, end_ - p_);
+    size_t pos = rest.find(token);
+    if (pos == std::string_view::npos) {
+        fail("unterminated markup");
+    }
+    p_ += pos + token.size();
+}
+
+void XmlReader::startTag(StartTag &tag) {
+    const char *name = ++p_;
+    while (p_ < end_ && !strchr(" \t\r\n/>", *p_)) {
+        ++p_;
+    }
+    if (p_ == name) {
+        fail("element name expected");
+    }
+    tag.name = std::string_view(name, p_ - name);
+    const char *attributes = p_;
+    char quote = 0;
+    for (; p_ < end_; ++p_) {
+        if (quote) {
+            if (*p_ == quote) quote = 0;
+        } else if (*p_ == '"' || *p_ == '\'') {
+            quote = *p_;
+        } else if (*p_ == '>') {
+            break;
+        }
+    }
+    if (p_ == end_) {
+        fail("unterminated start tag");
+    }
+    tag.empty = p_[-1] == '/' && p_ - 1 >= attributes;
+    tag.attributes = std::string_view(attributes, p_ - attributes - (tag.empty ? 1 : 0));
+    ++p_;
+}
+
+void XmlReader::root(StartTag &tag) {
+    while (!next(tag)) {
+    }
+}
+
+void XmlReader::skip(const StartTag &tag) {
+    if (tag.empty) {
+        return;
+    }
+    StartTag child;
+    size_t depth = 1;
+    while (depth) {
+        if (next(child)) {
+            depth += child.empty ? 0 : 1;
+        } else {
+            --depth;
+        }
+    }
+}
+
+bool XmlReader::attribute(const StartTag &tag, std::string_view name, std::string &value) {
+    std::string_view a = tag.attributes;
+    size_t i = 0;
+    while (i < a.size()) {
+        while (i < a.size() && strchr(" \t\r\n", a[i])) ++i;
+        size_t start = i;
+        while (i < a.size() && !strchr(" \t\r\n=", a[i])) ++i;
+        std::string_view attr = a.substr(start, i - start);
+        while (i < a.size() && a[i] != '"' && a[i] != '\'') ++i;
+        if (i >= a.size()) {
+            break;
+        }
+        size_t close = a.find(a[i], i + 1);
+        if (close == std::string_view::npos) {
+            break;
+        }
+        if (attr == name) {
+            value.clear();
+            decode(a.substr(i + 1, close - i - 1), [&value](std::string_view piece) { value.append(piece); });
+            return true;
+        }
+        i = close + 1;
+    }
+    return false;
+}
+
+size_t XmlReader::entity(std::string_view text, char *buf, size_t &len) {
+    size_t semi = text.find(';');
+    if (semi == std::string_view::npos || semi > 10) {
+        return 0;
+    }
+    std::string_view name = text.substr(1, semi - 1);
+    static const struct { std::string_view name; char c; } predefined[] = {
+        {"amp", '&'}, {"lt", '<'}, {"gt", '>'}, {"quot", '"'}, {"apos", '\''},
+    };
+    for (const auto &p : predefined) {
+        if (name == p.name) {
+            buf[0] = p.c;
+            len = 1;
+            return semi + 1;
+        }
+    }
+    if (name.size() < 2 || name[0] != '#') {
+        return 0;
+    }
+    bool hex = name[1] == 'x';
+    std::string_view digits = name.substr(hex ? 2 : 1);
+    uint32_t cp = 0;
+    auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), cp, hex ? 16 : 10);
+    if (ec != std::errc() || end != digits.data() + digits.size() || cp > 0x10FFFF) {
+        return 0;
+    }
+    if (cp < 0x80) {
+        buf[0] = char(cp);
+        len = 1;
+    } else if (cp < 0x800) {
+        buf[0] = char(0xC0 | (cp >> 6));
+        buf[1] = char(0x80 | (cp & 0x3F));
+        len = 2;
+    } else if (cp < 0x10000) {
+        buf[0] = char(0xE0 | (cp >> 12));
+        buf[1] = char(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = char(0x80 | (cp & 0x3F));
+        len = 3;
+    } else {
+        buf[0] = char(0xF0 | (cp >> 18));
+        buf[1] = char(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = char(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = char(0x80 | (cp & 0x3F));
+        len = 4;
+    }
+    return semi + 1;
+}
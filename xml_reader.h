@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025 @https://github.com/kdilayer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <stdexcept>
+
+// Pull parser over an XML document in memory, for documents too large to
+// build a rapidxml tree of. Nothing is allocated or written while reading:
+// names and attributes are views into the document, text is handed to a
+// callback piece by piece with the entities decoded. Namespaces, DTDs and
+// validation are not handled, malformed input throws std::runtime_error.
+class XmlReader {
+public:
+    struct StartTag {
+        std::string_view name;
+        std::string_view attributes; // raw text between the name and '>'
+        bool empty = false;          // <name/>, there is no content or end tag
+    };
+
+    explicit XmlReader(std::string_view xml) : p_(xml.data()), end_(xml.data() + xml.size()) {}
+
+    // Skips the prolog (declaration, processing instructions, comments,
+    // DOCTYPE) and reads the start tag of the root element
+    void root(StartTag &tag);
+
+    // Reads on to the next child element of the current element. Text and
+    // CDATA met on the way go to text(std::string_view). Returns false
+    // when the end tag of the current element was read instead.
+    template <typename Text>
+    bool next(StartTag &tag, Text &&text);
+    bool next(StartTag &tag) {
+        return next(tag, [](std::string_view) {});
+    }
+    // Skips the content and end tag of an element whose start tag was read
+    void skip(const StartTag &tag);
+
+    // Value of attribute name of a start tag, entities decoded
+    static bool attribute(const StartTag &tag, std::string_view name, std::string &value);
+
+    // Feeds text to out with the predefined and numeric entities decoded
+    template <typename Text>
+    static void decode(std::string_view text, Text &&out);
+private:
+    // Decodes the entity at text[0] == '&' into buf, returns its length in
+    // text, 0 for an unknown entity that is passed on as is
+    static size_t entity(std::string_view text, char *buf, size_t &len);
+    [[noreturn]] void fail(const char *what) const;
+    // Moves past the next occurrence of token, throws when there is none
+    void skipPast(std::string_view token);
+    void startTag(StartTag &tag);
+
+    const char *p_;
+    const char *end_;
+};
+
+template <typename Text>
+void XmlReader::decode(std::string_view text, Text &&out) {
+    size_t start = 0;
+    for (size_t amp = text.find('&'); amp != std::string_view::npos; amp = text.find('&', amp)) {
+        char buf[4];
+        size_t len = 0;
+        size_t used = entity(text.substr(amp), buf, len);
+        if (used == 0) {
+            ++amp;
+            continue;
+        }
+        if (amp > start) {
+            out(text.substr(start, amp - start));
+        }
+        out(std::string_view(buf, len));
+        amp += used;
+        start = amp;
+    }
+    if (start < text.size()) {
+        out(text.substr(start));
+    }
+}
+
+template <typename Text>
+bool XmlReader::next(StartTag &tag, Text &&text) {
+    for (;;) {
+        const char *lt = static_cast<const char *>(memchr(p_, '<', end_ - p_));
+        if (!lt) {
+            fail("unexpected end of document");
+        }
+        if (lt > p_) {
+            decode(std::string_view(p_, lt - p_), text);
+        }
+        p_ = lt;
+        std::string_view rest(p_, end_ - p_);
+        if (rest.starts_with("</")) {
+            skipPast(">");
+            return false;
+        } else if (rest.starts_with("<![CDATA[")) {
+            p_ += 9;
+            const char *start = p_;
+            skipPast("]]>");
+            text(std::string_view(start, p_ - 3 - start));
+        } else if (rest.starts_with("<!--")) {
+            skipPast("-->");
+        } else if (rest.starts_with("<?")) {
+            skipPast("?>");
+        } else if (rest.starts_with("<!")) {
+            skipPast(">");
+        } else {
+            startTag(tag);
+            return true;
+        }
+    }
+}
@@ -11,7 +11,10 @@
 
 #include <fstream>
 #include <stdexcept>
+#include <algorithm>
 #include <stdio.h>
+#include <cstring>
+#include <cctype>
 
 #include "util.h"
 #ifndef ZIPPER_WRITE_BUFFER_SIZE
@@ -83,6 +86,36 @@ static std::error_code make_error_code(zipper_error e, std::string const& messag
     return { static_cast<int>(e), theZipperErrorCategory };
 }
 
+// -----------------------------------------------------------------------------
+// zlib level of the compression flags, -1 when unknown
+static int compressLevel(int flags)
+{
+    flags = flags & ~int(Zipper::zipFlags::SaveHierarchy);
+    if (flags == Zipper::zipFlags::Store)
+        return 0;
+    else if (flags == Zipper::zipFlags::Faster)
+        return 1;
+    else if (flags == Zipper::zipFlags::Medium)
+        return 5;
+    else if (flags == Zipper::zipFlags::Better)
+        return 9;
+    return -1;
+}
+
+// -----------------------------------------------------------------------------
+// crc32 of a buffer larger than the uInt length of zlib
+static uint32_t crc32Of(uint32_t crc, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        uInt len = static_cast<uInt>(std::min<size_t>(size, 0x40000000u));
+        crc = static_cast<uint32_t>(crc32(crc, reinterpret_cast<const Bytef*>(data), len));
+        data += len;
+        size -= len;
+    }
+    return crc;
+}
+
 // -----------------------------------------------------------------------------
 // Calculate the CRC32 of a file because to encrypt a file, we need known the
 // CRC32 of the file before.
@@ -109,6 +142,88 @@ static void getFileCrc(std::istream& input_stream, std::vector<char>& buff, uint
     result_crc = static_cast<uint32_t>(calculate_crc); // FIXME
 }
 
+// -----------------------------------------------------------------------------
+// Archive written into one std::string, whose size is the end of the archive.
+// Reserved up front by Zipper(capacity), grown geometrically when the estimate
+// was short, and moved out on close.
+struct StringSink
+{
+    std::string data;
+    uint64_t pos = 0;
+};
+
+static voidpf ZCALLBACK sinkOpen(voidpf opaque, const void* /*filename*/, int /*mode*/)
+{
+    static_cast<StringSink*>(opaque)->pos = 0;
+    return opaque;
+}
+
+static voidpf ZCALLBACK sinkOpenDisk(voidpf /*opaque*/, voidpf /*stream*/, uint32_t /*number_disk*/, int /*mode*/)
+{
+    return nullptr; // no spanned archives in memory
+}
+
+static uint32_t ZCALLBACK sinkRead(voidpf /*opaque*/, voidpf stream, void* buf, uint32_t size)
+{
+    StringSink* sink = static_cast<StringSink*>(stream);
+    if (sink->pos >= sink->data.size())
+        return 0;
+    size = static_cast<uint32_t>(std::min<uint64_t>(size, sink->data.size() - sink->pos));
+    memcpy(buf, sink->data.data() + sink->pos, size);
+    sink->pos += size;
+    return size;
+}
+
+static uint32_t ZCALLBACK sinkWrite(voidpf /*opaque*/, voidpf stream, const void* buf, uint32_t size)
+{
+    StringSink* sink = static_cast<StringSink*>(stream);
+    uint64_t end = sink->pos + size;
+    if (end > sink->data.size())
+        sink->data.resize(end);
+    memcpy(&sink->data[sink->pos], buf, size);
+    sink->pos = end;
+    return size;
+}
+
+static uint64_t ZCALLBACK sinkTell(voidpf /*opaque*/, voidpf stream)
+{
+    return static_cast<StringSink*>(stream)->pos;
+}
+
+static long ZCALLBACK sinkSeek(voidpf /*opaque*/, voidpf stream, uint64_t offset, int origin)
+{
+    StringSink* sink = static_cast<StringSink*>(stream);
+    uint64_t pos = 0;
+    switch (origin)
+    {
+    case ZLIB_FILEFUNC_SEEK_CUR:
+        pos = sink->pos + offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_END:
+        pos = sink->data.size() + offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_SET:
+        pos = offset;
+        break;
+    default:
+        return -1;
+    }
+    if (pos > sink->data.size())
+        return -1;
+    sink->pos = pos;
+    return 0;
+}
+
+static int ZCALLBACK sinkClose(voidpf /*opaque*/, voidpf /*stream*/)
+{
+    return 0;
+}
+
+static int ZCALLBACK sinkError(voidpf /*opaque*/, voidpf /*stream*/)
+{
+    return 0;
+}
+
 // *************************************************************************
 //! \brief PIMPL implementation
 // *************************************************************************
@@ -118,6 +233,8 @@ struct Zipper::Impl
     zipFile m_zf;
     ourmemory_t m_zipmem;
     zlib_filefunc_def m_filefunc;
+    StringSink m_sink;
+    size_t m_capacity = 0;
     std::error_code& m_error_code;
 
     // -------------------------------------------------------------------------
@@ -229,6 +346,31 @@ struct Zipper::Impl
         return initMemory(buffer.empty() ? APPEND_STATUS_CREATE : APPEND_STATUS_ADDINZIP, m_filefunc);
     }
 
+    // -------------------------------------------------------------------------
+    bool initWithString(size_t capacity)
+    {
+        m_capacity = capacity;
+        m_sink.data.clear();
+        m_sink.data.reserve(capacity);
+
+        zlib_filefunc64_def filefunc;
+        filefunc.zopen64_file = sinkOpen;
+        filefunc.zopendisk64_file = sinkOpenDisk;
+        filefunc.zread_file = sinkRead;
+        filefunc.zwrite_file = sinkWrite;
+        filefunc.ztell64_file = sinkTell;
+        filefunc.zseek64_file = sinkSeek;
+        filefunc.zclose_file = sinkClose;
+        filefunc.zerror_file = sinkError;
+        filefunc.opaque = &m_sink;
+
+        m_zf = zipOpen3_64("__notused__", APPEND_STATUS_CREATE, 0, nullptr, &filefunc);
+        if (m_zf != nullptr)
+            return true;
+        m_error_code = make_error_code(zipper_error::INTERNAL_ERROR);
+        return false;
+    }
+
     // -------------------------------------------------------------------------
     bool initMemory(int mode, zlib_filefunc_def& filefunc)
     {
@@ -242,6 +384,52 @@ struct Zipper::Impl
     // -------------------------------------------------------------------------
     bool add(std::istream& input_stream, const std::tm& timestamp,
              const std::string& nameInZip, const std::string& password, int flags)
+    {
+        size_t size_buf = ZIPPER_WRITE_BUFFER_SIZE;
+        int err = ZIP_OK;
+        uint32_t crcFile = 0;
+        size_t size_read;
+
+        std::vector<char> buff;
+        buff.resize(size_buf);
+
+        if (!password.empty())
+        {
+            getFileCrc(input_stream, buff, crcFile);
+        }
+        if (!openEntry(timestamp, nameInZip, password, crcFile, flags))
+        {
+            return false;
+        }
+
+        do
+        {
+            err = ZIP_OK;
+            input_stream.read(buff.data(), std::streamsize(buff.size()));
+            size_read = static_cast<size_t>(input_stream.gcount());
+            if (size_read < buff.size() && !input_stream.eof() && !input_stream.good())
+            {
+                err = ZIP_ERRNO;
+            }
+
+            if (size_read > 0)
+            {
+                err = zipWriteInFileInZip(this->m_zf, buff.data(),
+                                          static_cast<unsigned int>(size_read));
+            }
+        } while ((err == ZIP_OK) && (size_read > 0));
+
+        if (ZIP_OK != err)
+        {
+            zipCloseFileInZip(this->m_zf);
+            return false;
+        }
+        return closeEntry();
+    }
+
+    // -------------------------------------------------------------------------
+    bool openEntry(const std::tm& timestamp, const std::string& nameInZip,
+                   const std::string& password, uint32_t crcFile, int flags, bool raw = false)
     {
         if (!m_zf)
         {
@@ -251,9 +439,7 @@ struct Zipper::Impl
 
         int compressLevel = 5; // Zipper::zipFlags::Medium
         bool zip64 = false;
-        size_t size_buf = ZIPPER_WRITE_BUFFER_SIZE;
         int err = ZIP_OK;
-        uint32_t crcFile = 0;
 
         zip_fileinfo zi;
         zi.dos_date = 0; // if dos_date == 0, tmz_date is used
@@ -266,11 +452,6 @@ struct Zipper::Impl
         zi.tmz_date.tm_mon = uInt(timestamp.tm_mon);
         zi.tmz_date.tm_year = uInt(timestamp.tm_year);
 
-        size_t size_read;
-
-        std::vector<char> buff;
-        buff.resize(size_buf);
-
         if (nameInZip.empty())
         {
             m_error_code = make_error_code(zipper_error::NO_ENTRY);
@@ -291,14 +472,8 @@ struct Zipper::Impl
             return false;
         }
 
-        flags = flags & ~int(Zipper::zipFlags::SaveHierarchy);
-        if (flags == Zipper::zipFlags::Store)
-            compressLevel = 0;
-        else if (flags == Zipper::zipFlags::Faster)
-            compressLevel = 1;
-        else if (flags == Zipper::zipFlags::Better)
-            compressLevel = 9;
-        else
+        compressLevel = zipper::compressLevel(flags);
+        if (compressLevel < 0)
         {
             std::stringstream str;
             str << "Unknown compression level: " << flags;
@@ -307,7 +482,29 @@ struct Zipper::Impl
         }
 
         zip64 = true; //Path::isLargeFile(input_stream);
-        if (password.empty())
+        if (raw)
+        {
+            // data is deflated already, crc and size are given on close
+            err = zipOpenNewFileInZip4_64(
+                m_zf,
+                canonNameInZip.c_str(),
+                &zi,
+                nullptr,
+                0,
+                nullptr,
+                0,
+                nullptr /* comment*/,
+                (compressLevel != 0) ? Z_DEFLATED : 0,
+                compressLevel,
+                1,
+                -MAX_WBITS, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY,
+                nullptr,
+                0,
+                0 /* version made by */,
+                0 /* flag base */,
+                zip64);
+        }
+        else if (password.empty())
         {
             err = zipOpenNewFileInZip64(
                 m_zf,
@@ -324,7 +521,6 @@ struct Zipper::Impl
         }
         else
         {
-            getFileCrc(input_stream, buff, crcFile);
             err = zipOpenNewFileInZip3_64(
                 m_zf,
                 canonNameInZip.c_str(),
@@ -344,44 +540,56 @@ struct Zipper::Impl
                 zip64);
         }
 
-        if (ZIP_OK == err)
-        {
-            do
-            {
-                err = ZIP_OK;
-                input_stream.read(buff.data(), std::streamsize(buff.size()));
-                size_read = static_cast<size_t>(input_stream.gcount());
-                if (size_read < buff.size() && !input_stream.eof() && !input_stream.good())
-                {
-                    err = ZIP_ERRNO;
-                }
-
-                if (size_read > 0)
-                {
-                    err = zipWriteInFileInZip(this->m_zf, buff.data(),
-                                              static_cast<unsigned int>(size_read));
-                }
-            } while ((err == ZIP_OK) && (size_read > 0));
-        }
-        else
+        if (ZIP_OK != err)
         {
             std::stringstream str;
             str << "Error when adding " << nameInZip << " to zip";
             m_error_code = make_error_code(zipper_error::INTERNAL_ERROR, str.str());
             return false;
         }
+        return true;
+    }
 
-        if (ZIP_OK == err)
+    // -------------------------------------------------------------------------
+    bool writeEntry(const char* data, size_t size)
+    {
+        // zipWriteInFileInZip takes an unsigned length, feed huge buffers in slices
+        while (size > 0)
         {
-            err = zipCloseFileInZip(this->m_zf);
-            if (ZIP_OK != err)
+            unsigned int len = static_cast<unsigned int>(std::min<size_t>(size, 0x40000000u));
+            if (zipWriteInFileInZip(this->m_zf, data, len) != ZIP_OK)
             {
-                std::stringstream str;
-                str << "Error when closing zip";
-                m_error_code = make_error_code(zipper_error::INTERNAL_ERROR, str.str());
+                m_error_code = make_error_code(zipper_error::INTERNAL_ERROR, "Error when writing to zip");
+                zipCloseFileInZip(this->m_zf);
+                return false;
             }
+            data += len;
+            size -= len;
         }
+        return true;
+    }
 
+    // -------------------------------------------------------------------------
+    bool closeEntry()
+    {
+        int err = zipCloseFileInZip(this->m_zf);
+        if (ZIP_OK != err)
+        {
+            std::stringstream str;
+            str << "Error when closing zip";
+            m_error_code = make_error_code(zipper_error::INTERNAL_ERROR, str.str());
+        }
+        return ZIP_OK == err;
+    }
+
+    // -------------------------------------------------------------------------
+    bool closeRawEntry(uint64_t size, uint32_t crc)
+    {
+        int err = zipCloseFileInZipRaw64(this->m_zf, size, crc);
+        if (ZIP_OK != err)
+        {
+            m_error_code = make_error_code(zipper_error::INTERNAL_ERROR, "Error when closing zip");
+        }
         return ZIP_OK == err;
     }
 
@@ -392,6 +600,11 @@ struct Zipper::Impl
             zipClose(m_zf, nullptr);
             m_zf = nullptr;
         }
+        if (m_outer.m_usingString) {
+            out = std::move(m_sink.data);
+            m_sink.data = std::string();
+            return;
+        }
         if (m_zipmem.base && m_zipmem.limit > 0) {
             out.resize(m_zipmem.limit);
             out.assign(m_zipmem.base, m_zipmem.base + m_zipmem.limit);
@@ -409,6 +622,8 @@ struct Zipper::Impl
             zipClose(m_zf, nullptr);
             m_zf = nullptr;
         }
+        // an archive nobody asked for with close(out)
+        m_sink.data = std::string();
 
         if (m_zipmem.base && m_zipmem.limit > 0)
         {
@@ -439,6 +654,7 @@ Zipper::Zipper(const std::string& zipname, const std::string& password, Zipper::
     , m_password(password)
     , m_usingMemoryVector(false)
     , m_usingStream(false)
+    , m_usingString(false)
     , m_impl(new Impl(*this, m_error_code))
 {
     if (m_impl->initFile(zipname, flags))
@@ -466,6 +682,7 @@ Zipper::Zipper(std::iostream& buffer, const std::string& password)
     , m_password(password)
     , m_usingMemoryVector(false)
     , m_usingStream(true)
+    , m_usingString(false)
     , m_impl(new Impl(*this, m_error_code))
 {
     if (!m_impl->initWithStream(m_obuffer))
@@ -484,6 +701,7 @@ Zipper::Zipper(std::vector<unsigned char>& buffer, const std::string& password)
     , m_password(password)
     , m_usingMemoryVector(true)
     , m_usingStream(false)
+    , m_usingString(false)
     , m_impl(new Impl(*this, m_error_code))
 {
     if (!m_impl->initWithVector(m_vecbuffer))
@@ -495,6 +713,36 @@ Zipper::Zipper(std::vector<unsigned char>& buffer, const std::string& password)
     m_open = true;
 }
 
+// -------------------------------------------------------------------------
+Zipper::Zipper(size_t capacity, const std::string& password)
+    : m_obuffer(*(new std::stringstream())) //not used but using local variable throws exception
+    , m_vecbuffer(*(new std::vector<unsigned char>())) //not used but using local variable throws exception
+    , m_password(password)
+    , m_usingMemoryVector(false)
+    , m_usingStream(false)
+    , m_usingString(true)
+    , m_impl(new Impl(*this, m_error_code))
+{
+    if (!m_impl->initWithString(capacity))
+    {
+        std::runtime_error exception(m_impl->m_error_code.message());
+        release();
+        throw exception;
+    }
+    m_open = true;
+}
+
+// -------------------------------------------------------------------------
+size_t Zipper::archiveSize(size_t contentSize, size_t entries)
+{
+    // local header, zip64 extra field and data descriptor, the central
+    // directory record of the entry, both with names up to ~200 bytes
+    const size_t entryOverhead = 640;
+    // zip64 end of central directory, its locator and the classic record
+    const size_t endOverhead = 128;
+    return contentSize + entries * entryOverhead + endOverhead;
+}
+
 // -------------------------------------------------------------------------
 Zipper::~Zipper()
 {
@@ -543,7 +791,169 @@ bool Zipper::add(std::istream& source, const std::tm& timestamp, const std::stri
 }
 
 // -------------------------------------------------------------------------
-bool Zipper::add(std::istream& source, const std::string& nameInZip, zipFlags flags)
+bool Zipper::add(const char* data, size_t size, const std::tm& timestamp, const std::string& nameInZip, zipFlags flags)
+{
+    return openEntry(timestamp, nameInZip, flags) && writeEntry(data, size) && closeEntry();
+}
+
+// -------------------------------------------------------------------------
+bool Zipper::openEntry(const std::tm& timestamp, const std::string& nameInZip, zipFlags flags)
+{
+    if (!m_password.empty())
+    {
+        // encryption needs the crc of the whole entry before the first byte
+        m_error_code = make_error_code(zipper_error::INTERNAL_ERROR, "Entries written in parts cannot be encrypted");
+        return false;
+    }
+    return m_impl->openEntry(timestamp, nameInZip, m_password, 0, flags);
+}
+
+// -------------------------------------------------------------------------
+bool Zipper::writeEntry(const char* data, size_t size)
+{
+    return m_impl->writeEntry(data, size);
+}
+
+// -------------------------------------------------------------------------
+bool Zipper::closeEntry()
+{
+    return m_impl->closeEntry();
+}
+
+// -------------------------------------------------------------------------
+Zipper::zipFlags Zipper::compressionFor(const std::string& mimeType, const char* sample, size_t size)
+{
+    // formats whose content is compressed, deflate gains next to nothing
+    static const char* const compressed[] = {
+        "application/pdf", "application/zip", "application/gzip", "application/x-gzip",
+        "application/x-7z-compressed", "application/x-rar-compressed", "application/x-bzip2",
+        "application/vnd.openxmlformats-officedocument.", "application/vnd.oasis.opendocument.",
+        "image/jpeg", "image/jpg", "image/png", "image/gif", "image/webp", "image/heic",
+        "video/", "audio/",
+    };
+    std::string type = mimeType.substr(0, mimeType.find(';'));
+    std::transform(type.begin(), type.end(), type.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+    for (const char* prefix : compressed)
+    {
+        if (type.compare(0, strlen(prefix), prefix) == 0)
+            return Zipper::zipFlags::Store;
+    }
+    if (size == 0)
+        return Zipper::zipFlags::Medium;
+
+    // deflate a sample at the fastest level and look at what is left of it
+    const size_t sampleSize = 16 * 1024;
+    size = std::min(size, sampleSize);
+    uLongf out_size = compressBound(static_cast<uLong>(size));
+    std::vector<Bytef> out(out_size);
+    if (compress2(out.data(), &out_size, reinterpret_cast<const Bytef*>(sample), static_cast<uLong>(size), 1) != Z_OK)
+        return Zipper::zipFlags::Medium;
+    double ratio = double(out_size) / double(size);
+    if (ratio > 0.9)
+        return Zipper::zipFlags::Store;
+    if (ratio > 0.6)
+        return Zipper::zipFlags::Faster;
+    // level 9 costs about twice level 5 for a percent or two on such content
+    return Zipper::zipFlags::Medium;
+}
+
+// -------------------------------------------------------------------------
+struct Zipper::Deflater::Stream
+{
+    z_stream z{};
+    bool initialized = false;
+};
+
+// -------------------------------------------------------------------------
+Zipper::Deflater::Deflater(DeflatedEntry& entry, Zipper::zipFlags flags)
+    : m_entry(entry), m_stream(new Stream())
+{
+    int level = compressLevel(flags);
+    m_entry.level = level < 0 ? 5 : level;
+    m_entry.data.clear();
+    m_entry.size = 0;
+    m_entry.crc = 0;
+    if (m_entry.level != 0)
+    {
+        // raw deflate, as zip entries are stored
+        m_stream->initialized = deflateInit2(&m_stream->z, m_entry.level, Z_DEFLATED, -MAX_WBITS,
+                                             DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+}
+
+// -------------------------------------------------------------------------
+Zipper::Deflater::~Deflater()
+{
+    if (m_stream->initialized)
+        deflateEnd(&m_stream->z);
+}
+
+// -------------------------------------------------------------------------
+bool Zipper::Deflater::write(const char* data, size_t size)
+{
+    m_entry.crc = crc32Of(m_entry.crc, data, size);
+    m_entry.size += size;
+    if (m_entry.level == 0)
+    {
+        m_entry.data.append(data, size);
+        return true;
+    }
+    return deflate(data, size, Z_NO_FLUSH);
+}
+
+// -------------------------------------------------------------------------
+bool Zipper::Deflater::finish()
+{
+    if (m_entry.level == 0)
+        return true;
+    return deflate(nullptr, 0, Z_FINISH);
+}
+
+// -------------------------------------------------------------------------
+bool Zipper::Deflater::deflate(const char* data, size_t size, int flush)
+{
+    if (!m_stream->initialized)
+        return false;
+    z_stream& z = m_stream->z;
+    const size_t chunk = 64 * 1024;
+    do
+    {
+        uInt len = static_cast<uInt>(std::min<size_t>(size, 0x40000000u));
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        z.avail_in = len;
+        int last = len == size ? flush : Z_NO_FLUSH;
+        do
+        {
+            size_t used = m_entry.data.size();
+            m_entry.data.resize(used + chunk);
+            z.next_out = reinterpret_cast<Bytef*>(&m_entry.data[used]);
+            z.avail_out = static_cast<uInt>(chunk);
+            int err = ::deflate(&z, last);
+            m_entry.data.resize(used + chunk - z.avail_out);
+            if (err == Z_STREAM_ERROR)
+                return false;
+        } while (z.avail_out == 0);
+        data += len;
+        size -= len;
+    } while (size > 0);
+    return true;
+}
+
+// -------------------------------------------------------------------------
+bool Zipper::addDeflated(const DeflatedEntry& entry)
+{
+    if (!m_password.empty())
+    {
+        m_error_code = make_error_code(zipper_error::INTERNAL_ERROR, "Deflated entries cannot be encrypted");
+        return false;
+    }
+    return m_impl->openEntry(entry.timestamp, entry.nameInZip, m_password, 0, entry.level, true) &&
+           m_impl->writeEntry(entry.data.data(), entry.data.size()) &&
+           m_impl->closeRawEntry(entry.size, entry.crc);
+}
+
+// -------------------------------------------------------------------------
+bool Zipper::add([[maybe_unused]] std::istream& source, [[maybe_unused]] const std::string& nameInZip, [[maybe_unused]] zipFlags flags)
 {
     return false;
     #if 0
@@ -553,7 +963,7 @@ bool Zipper::add(std::istream& source, const std::string& nameInZip, zipFlags fl
 }
 
 // -------------------------------------------------------------------------
-bool Zipper::add(const std::string& fileOrFolderPath, Zipper::zipFlags flags)
+bool Zipper::add([[maybe_unused]] const std::string& fileOrFolderPath, [[maybe_unused]] Zipper::zipFlags flags)
 {
     bool res = true;
     return res;
@@ -619,6 +1029,11 @@ bool Zipper::open(Zipper::openFlags flags)
         if (!m_impl->initWithVector(m_vecbuffer))
             return false;
     }
+    else if (m_usingString)
+    {
+        if (!m_impl->initWithString(m_impl->m_capacity))
+            return false;
+    }
     else if (m_usingStream)
     {
         if (!m_impl->initWithStream(m_obuffer))
@@ -15,6 +15,7 @@
 #include <memory>
 #include <ctime>
 #include <system_error>
+#include <cstdint>
 
 namespace zipper {
 
@@ -96,6 +97,24 @@ public:
     Zipper(std::vector<unsigned char>& buffer,
            const std::string& password = std::string());
 
+    // -------------------------------------------------------------------------
+    //! \brief In-memory zip compression into a single buffer reserved for
+    //! \c capacity bytes (see archiveSize()). The buffer only grows when the
+    //! estimate was short, close(std::string&) moves it out without a copy.
+    //!
+    //! \param[in] capacity: expected size of the archive.
+    //! \param[in] password: optional password (set empty for not using password).
+    //! \throw std::runtime_error if something odd happened.
+    // -------------------------------------------------------------------------
+    explicit Zipper(size_t capacity, const std::string& password = std::string());
+
+    // -------------------------------------------------------------------------
+    //! \brief Size of an archive of \c entries entries holding \c contentSize
+    //! bytes of (compressed) content: the content plus headers and the
+    //! central directory.
+    // -------------------------------------------------------------------------
+    static size_t archiveSize(size_t contentSize, size_t entries);
+
     // -------------------------------------------------------------------------
     //! \brief Call close().
     // -------------------------------------------------------------------------
@@ -115,6 +134,95 @@ public:
     bool add(std::istream& source, const std::tm& timestamp, const std::string& nameInZip,
              Zipper::zipFlags flags = Zipper::zipFlags::Better);
 
+    // -------------------------------------------------------------------------
+    //! \brief Compress \c size bytes from memory at \c data with a given
+    //! timestamp in the archive with the given name \c nameInZip.
+    //!
+    //! \param[in] data: data to compress, not copied.
+    //! \param[in] size: number of bytes in \c data.
+    //! \param[in] timestamp: the desired timestamp.
+    //! \param[in] nameInZip: the desired name for \c data inside the archive.
+    //! \param[in] flags: compression options (faster, better ...).
+    //! \return true on success, else return false.
+    // -------------------------------------------------------------------------
+    bool add(const char* data, size_t size, const std::tm& timestamp, const std::string& nameInZip,
+             Zipper::zipFlags flags = Zipper::zipFlags::Better);
+
+    // -------------------------------------------------------------------------
+    //! \brief Start a new entry whose content is given in parts with
+    //! writeEntry() and finished with closeEntry(). Lets the caller produce the
+    //! content piecewise (e.g. while decoding) without a full intermediate copy.
+    //! Not available for password protected archives.
+    //!
+    //! \param[in] timestamp: the desired timestamp.
+    //! \param[in] nameInZip: the desired name of the entry inside the archive.
+    //! \param[in] flags: compression options (faster, better ...).
+    //! \return true on success, else return false.
+    // -------------------------------------------------------------------------
+    bool openEntry(const std::tm& timestamp, const std::string& nameInZip,
+                   Zipper::zipFlags flags = Zipper::zipFlags::Better);
+    bool writeEntry(const char* data, size_t size);
+    bool closeEntry();
+
+    // -------------------------------------------------------------------------
+    //! \brief Compression worth spending on an entry: Store for formats that
+    //! are compressed already (pdf, images, archives, office documents ...),
+    //! else chosen from how well a sample of the content deflates.
+    //!
+    //! \param[in] mimeType: MIME type of the entry, may be empty.
+    //! \param[in] sample: the first bytes of the content.
+    //! \param[in] size: number of bytes in \c sample.
+    // -------------------------------------------------------------------------
+    static Zipper::zipFlags compressionFor(const std::string& mimeType, const char* sample, size_t size);
+
+    // -------------------------------------------------------------------------
+    //! \brief Entry compressed apart from the archive by a Deflater, so that
+    //! independent entries can be compressed on several threads, and added to
+    //! the archive as it is by addDeflated().
+    // -------------------------------------------------------------------------
+    struct DeflatedEntry
+    {
+        std::string nameInZip;
+        std::tm timestamp{};
+        int level = 0;      //!< 0: stored as it is
+        std::string data;   //!< raw deflate stream, or the content when stored
+        uint64_t size = 0;  //!< uncompressed size
+        uint32_t crc = 0;   //!< crc32 of the uncompressed content
+    };
+
+    // -------------------------------------------------------------------------
+    //! \brief Compresses content given in parts into a DeflatedEntry. Touches
+    //! no archive, any number of them can run concurrently.
+    // -------------------------------------------------------------------------
+    class Deflater
+    {
+    public:
+        Deflater(DeflatedEntry& entry, Zipper::zipFlags flags);
+        ~Deflater();
+        Deflater(const Deflater&) = delete;
+        Deflater& operator=(const Deflater&) = delete;
+
+        bool write(const char* data, size_t size);
+        //! \brief Flushes the stream, the entry is complete on success.
+        bool finish();
+
+    private:
+        bool deflate(const char* data, size_t size, int flush);
+
+        struct Stream;
+        DeflatedEntry& m_entry;
+        std::unique_ptr<Stream> m_stream;
+    };
+
+    // -------------------------------------------------------------------------
+    //! \brief Add an entry compressed by a Deflater, the data is copied into
+    //! the archive without being compressed again.
+    //! Not available for password protected archives.
+    //!
+    //! \return true on success, else return false.
+    // -------------------------------------------------------------------------
+    bool addDeflated(const DeflatedEntry& entry);
+
     // -------------------------------------------------------------------------
     //! \brief Compress data \c source in the archive with the given name \c
     //! nameInZip. No timestamp will be stored.
@@ -159,6 +267,8 @@ public:
     //! \note this method is called by the destructor.
     // -------------------------------------------------------------------------
     void close();
+    //! \brief Closes and hands out the archive: moved out of the single
+    //! buffer of Zipper(capacity), copied for the other in-memory archives.
     void close(std::string &out);
 
     // -------------------------------------------------------------------------
@@ -187,6 +297,7 @@ private:
     std::string m_password;
     bool m_usingMemoryVector;
     bool m_usingStream;
+    bool m_usingString;
     bool m_open;
     std::error_code m_error_code;
 